@@ -9,7 +9,6 @@
 #include "esp_check.h"
 #include "onewire_bus.h"
 #include "onewire_cmd.h"
-#include "onewire_crc.h"
 #include "ds18b20.h"
 
 static const char *TAG = "ds18b20";
@@ -149,10 +148,9 @@ esp_err_t ds18b20_get_temperature(ds18b20_device_handle_t ds18b20, float *ret_te
 
     // read scratchpad data
     ds18b20_scratchpad_t scratchpad;
-    ESP_RETURN_ON_ERROR(onewire_bus_read_bytes(ds18b20->bus, (uint8_t *)&scratchpad, sizeof(scratchpad)),
+    // checked against its crc while it is received
+    ESP_RETURN_ON_ERROR(onewire_bus_read_bytes_crc(ds18b20->bus, (uint8_t *)&scratchpad, sizeof(scratchpad)),
                         TAG, "error while reading scratchpad data");
-    // check crc
-    ESP_RETURN_ON_FALSE(onewire_crc8(0, (uint8_t *)&scratchpad, 8) == scratchpad.crc_value, ESP_ERR_INVALID_CRC, TAG, "scratchpad crc error");
 
     const uint8_t lsb_mask[4] = {0x07, 0x03, 0x01, 0x00}; // mask bits not used in low resolution
     uint8_t lsb_masked = scratchpad.temp_lsb & (~lsb_mask[scratchpad.configuration >> 5]);
@@ -40,6 +40,22 @@ esp_err_t onewire_bus_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_da
  */
 esp_err_t onewire_bus_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size);
 
+/**
+ * @brief Read bytes from 1-wire bus and check them against the CRC8 in their last byte
+ *
+ * @note With the RMT backend the CRC is computed while the data is decoded, in the receive callback
+ *
+ * @param[in] bus 1-Wire bus handle
+ * @param[out] rx_buf pointer to buffer to store received data, ending with the CRC8 of the bytes before it
+ * @param[in] rx_buf_size size of buffer to store received data, in bytes
+ * @return
+ *      - ESP_OK: Read bytes from 1-Wire bus successfully and the CRC matches
+ *      - ESP_ERR_INVALID_CRC: Read bytes from 1-Wire bus successfully but the CRC does not match
+ *      - ESP_ERR_INVALID_ARG: Read bytes from 1-Wire bus failed because of invalid argument
+ *      - ESP_FAIL: Read bytes from 1-Wire bus failed because of other errors
+ */
+esp_err_t onewire_bus_read_bytes_crc(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size);
+
 /**
  * @brief Write a bit to 1-wire bus, this is a blocking function
  *
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Calculate Dallas CRC8 value of a given buffer
+ *
+ * @param[in] init_crc Initial CRC value
+ * @param[in] input Input buffer to calculate CRC value
+ * @param[in] input_size Size of input buffer, in bytes
+ * @return CRC8 result of the input buffer
+ */
+uint8_t onewire_crc8(uint8_t init_crc, uint8_t *input, size_t input_size);
+
+/**
+ * @brief Add one byte to a running CRC8, e.g. while bytes are decoded
+ *
+ * Same result as onewire_crc8() over the bytes fed so far. Placed in IRAM, with its table in DRAM, so it
+ * can be called from an ISR.
+ *
+ * @param[in] crc CRC so far, or the initial value
+ * @param[in] byte Next input byte
+ * @return CRC8 including the byte
+ */
+uint8_t onewire_crc8_update(uint8_t crc, uint8_t byte);
+
+/**
+ * @brief Check every CRC8 variant against the bit-by-bit reference and its known check value
+ *
+ * Only built with CONFIG_ONEWIRE_CRC8_SELF_TEST, as it keeps every variant in the image.
+ *
+ * @return true if all variants agree
+ */
+bool onewire_crc8_self_test(void);
+
+/**
+ * Variants of onewire_crc8(), selected with ONEWIRE_CRC8_IMPL when building onewire_crc.c. Memory per
+ * variant: bitwise none, nibble 16 bytes, table 256, slice4 1024, slice8 2048.
+ */
+#define ONEWIRE_CRC8_BITWISE 0
+#define ONEWIRE_CRC8_TABLE   1
+#define ONEWIRE_CRC8_NIBBLE  2
+#define ONEWIRE_CRC8_SLICE4  3
+#define ONEWIRE_CRC8_SLICE8  4
+
+uint8_t onewire_crc8_bitwise(uint8_t init_crc, const uint8_t *input, size_t input_size);
+uint8_t onewire_crc8_table(uint8_t init_crc, const uint8_t *input, size_t input_size);
+uint8_t onewire_crc8_nibble(uint8_t init_crc, const uint8_t *input, size_t input_size);
+uint8_t onewire_crc8_slice4(uint8_t init_crc, const uint8_t *input, size_t input_size);
+uint8_t onewire_crc8_slice8(uint8_t init_crc, const uint8_t *input, size_t input_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/rmt_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decode the RMT symbols of 1-Wire read slots into bytes, LSB first, and CRC8 them on the way
+ *
+ * One symbol per read slot: the bit is 1 when the bus went high again before the sample time. Every byte of
+ * rx_buf is written; bits with no symbol are 0. Placed in IRAM and only touching DRAM, so it can run in the
+ * RMT receive callback.
+ *
+ * @param[in] rmt_symbols Received symbols
+ * @param[in] symbol_num Number of received symbols
+ * @param[out] rx_buf Buffer for the decoded bytes
+ * @param[in] rx_buf_size Size of rx_buf, in bytes
+ * @param[in] init_crc Initial CRC value
+ * @return CRC8 of the decoded bytes, 0 when they end with their own valid CRC
+ */
+uint8_t onewire_rmt_decode_bytes(const rmt_symbol_word_t *rmt_symbols, size_t symbol_num, uint8_t *rx_buf, size_t rx_buf_size, uint8_t init_crc);
+
+#ifdef __cplusplus
+}
+#endif
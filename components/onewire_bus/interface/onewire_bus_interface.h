@@ -46,6 +46,22 @@ struct onewire_bus_t {
      */
     esp_err_t (*read_bytes)(onewire_bus_t *bus, uint8_t *rx_buf, size_t rx_buf_size);
 
+    /**
+     * @brief Read bytes from 1-wire bus and return their CRC8, computed while they are received
+     *
+     * @note Optional, onewire_bus_read_bytes_crc() falls back to read_bytes and onewire_crc8() when NULL
+     *
+     * @param[in] bus 1-wire bus handle
+     * @param[out] rx_buf pointer to buffer to store received data
+     * @param[in] rx_buf_size size of buffer to store received data, in bytes
+     * @param[out] ret_crc CRC8 of the received bytes
+     * @return
+     *      - ESP_OK: Read bytes from 1-Wire bus successfully
+     *      - ESP_ERR_INVALID_ARG: Read bytes from 1-Wire bus failed because of invalid argument
+     *      - ESP_FAIL: Read bytes from 1-Wire bus failed because of other errors
+     */
+    esp_err_t (*read_bytes_crc)(onewire_bus_t *bus, uint8_t *rx_buf, size_t rx_buf_size, uint8_t *ret_crc);
+
     /**
      * @brief Write a bit to 1-wire bus, this is a blocking function
      *
@@ -7,6 +7,7 @@
 #include "esp_check.h"
 #include "onewire_types.h"
 #include "onewire_bus_interface.h"
+#include "onewire_crc.h"
 
 static const char *TAG = "1-wire";
 
@@ -28,6 +29,20 @@ esp_err_t onewire_bus_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size
     return bus->read_bytes(bus, rx_buf, rx_buf_size);
 }
 
+esp_err_t onewire_bus_read_bytes_crc(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size)
+{
+    ESP_RETURN_ON_FALSE(bus && rx_buf && rx_buf_size, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    uint8_t crc;
+    if (bus->read_bytes_crc) {
+        ESP_RETURN_ON_ERROR(bus->read_bytes_crc(bus, rx_buf, rx_buf_size, &crc), TAG, "read bytes failed");
+    } else {
+        ESP_RETURN_ON_ERROR(bus->read_bytes(bus, rx_buf, rx_buf_size), TAG, "read bytes failed");
+        crc = onewire_crc8(0, rx_buf, rx_buf_size);
+    }
+    // the CRC8 over data followed by its own CRC8 is 0
+    return crc == 0 ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
 esp_err_t onewire_bus_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit)
 {
     ESP_RETURN_ON_FALSE(bus, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
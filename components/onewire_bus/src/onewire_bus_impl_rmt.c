@@ -10,10 +10,12 @@
 #include "freertos/semphr.h"
 #include "esp_check.h"
 #include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "driver/rmt_tx.h"
 #include "driver/rmt_rx.h"
 #include "onewire_bus_impl_rmt.h"
 #include "onewire_bus_interface.h"
+#include "onewire_rmt_decode.h"
 
 static const char *TAG = "1-wire.rmt";
 
@@ -107,7 +109,7 @@ Read 0 bit:
 #define ONEWIRE_SLOT_BIT_DURATION               60 // duration for each bit to transmit
 // refer to https://www.maximintegrated.com/en/design/technical-documents/app-notes/3/3829.html for more information
 #define ONEWIRE_SLOT_RECOVERY_DURATION          5  // recovery time between each bit, should be longer in parasite power mode
-#define ONEWIRE_SLOT_BIT_SAMPLE_TIME            15 // how long after bit start pulse should the master sample from the bus
+// the master samples the bus 15us after bit start pulse, ONEWIRE_SLOT_BIT_SAMPLE_TIME in onewire_rmt_decode.c
 
 typedef struct {
     onewire_bus_t base; /*!< base class */
@@ -118,6 +120,9 @@ typedef struct {
     rmt_encoder_handle_t tx_copy_encoder; /*!< used to encode reset pulse and bits */
 
     rmt_symbol_word_t *rx_symbols_buf; /*!< hold rmt raw symbols */
+    uint8_t *rx_bytes_buf; /*!< bytes decoded by the rx done callback */
+    size_t rx_bytes_num; /*!< bytes the rx done callback should decode, 0 for a reset pulse */
+    uint8_t rx_crc; /*!< CRC8 of the decoded bytes */
 
     size_t max_rx_bytes; /*!< buffer size in byte for single receive transaction */
 
@@ -159,6 +164,7 @@ const static rmt_receive_config_t onewire_rmt_rx_config = {
 static esp_err_t onewire_bus_rmt_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit);
 static esp_err_t onewire_bus_rmt_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit);
 static esp_err_t onewire_bus_rmt_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size);
+static esp_err_t onewire_bus_rmt_read_bytes_crc(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size, uint8_t *ret_crc);
 static esp_err_t onewire_bus_rmt_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size);
 static esp_err_t onewire_bus_rmt_reset(onewire_bus_handle_t bus);
 static esp_err_t onewire_bus_rmt_del(onewire_bus_handle_t bus);
@@ -170,6 +176,11 @@ bool onewire_rmt_rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_don
     BaseType_t task_woken = pdFALSE;
     onewire_bus_rmt_obj_t *bus_rmt = (onewire_bus_rmt_obj_t *)user_data;
 
+    // decode and check the data here, so it is ready when the task wakes up
+    if (bus_rmt->rx_bytes_num) {
+        bus_rmt->rx_crc = onewire_rmt_decode_bytes(edata->received_symbols, edata->num_symbols,
+                                                   bus_rmt->rx_bytes_buf, bus_rmt->rx_bytes_num, 0);
+    }
     xQueueSendFromISR(bus_rmt->receive_queue, edata, &task_woken);
 
     return task_woken;
@@ -224,27 +235,6 @@ static bool onewire_rmt_check_presence_pulse(rmt_symbol_word_t *rmt_symbols, siz
     return ret;
 }
 
-static void onewire_rmt_decode_data(rmt_symbol_word_t *rmt_symbols, size_t symbol_num, uint8_t *rx_buf, size_t rx_buf_size)
-{
-    size_t byte_pos = 0;
-    size_t bit_pos = 0;
-    for (size_t i = 0; i < symbol_num; i ++) {
-        if (rmt_symbols[i].duration0 > ONEWIRE_SLOT_BIT_SAMPLE_TIME) { // 0 bit
-            rx_buf[byte_pos] &= ~(1 << bit_pos); // LSB first
-        } else { // 1 bit
-            rx_buf[byte_pos] |= 1 << bit_pos;
-        }
-        bit_pos ++;
-        if (bit_pos >= 8) {
-            bit_pos = 0;
-            byte_pos ++;
-            if (byte_pos >= rx_buf_size) {
-                break;
-            }
-        }
-    }
-}
-
 esp_err_t onewire_new_bus_rmt(const onewire_bus_config_t *bus_config, const onewire_bus_rmt_config_t *rmt_config, onewire_bus_handle_t *ret_bus)
 {
     esp_err_t ret = ESP_OK;
@@ -296,6 +286,10 @@ esp_err_t onewire_new_bus_rmt(const onewire_bus_config_t *bus_config, const onew
     ESP_GOTO_ON_FALSE(bus_rmt->rx_symbols_buf, ESP_ERR_NO_MEM, err, TAG, "no mem to store received RMT symbols");
     bus_rmt->max_rx_bytes = rmt_config->max_rx_bytes;
 
+    // decoded in the rx done callback, so it must be in internal RAM
+    bus_rmt->rx_bytes_buf = heap_caps_malloc(rmt_config->max_rx_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ESP_GOTO_ON_FALSE(bus_rmt->rx_bytes_buf, ESP_ERR_NO_MEM, err, TAG, "no mem to store received bytes");
+
     bus_rmt->receive_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
     ESP_GOTO_ON_FALSE(bus_rmt->receive_queue, ESP_ERR_NO_MEM, err, TAG, "receive queue creation failed");
 
@@ -329,6 +323,7 @@ esp_err_t onewire_new_bus_rmt(const onewire_bus_config_t *bus_config, const onew
     bus_rmt->base.write_bytes = onewire_bus_rmt_write_bytes;
     bus_rmt->base.read_bit = onewire_bus_rmt_read_bit;
     bus_rmt->base.read_bytes = onewire_bus_rmt_read_bytes;
+    bus_rmt->base.read_bytes_crc = onewire_bus_rmt_read_bytes_crc;
     *ret_bus = &bus_rmt->base;
 
     return ret;
@@ -366,6 +361,9 @@ static esp_err_t onewire_bus_rmt_destroy(onewire_bus_rmt_obj_t *bus_rmt)
     if (bus_rmt->rx_symbols_buf) {
         free(bus_rmt->rx_symbols_buf);
     }
+    if (bus_rmt->rx_bytes_buf) {
+        free(bus_rmt->rx_bytes_buf);
+    }
     free(bus_rmt);
     return ESP_OK;
 }
@@ -382,6 +380,7 @@ static esp_err_t onewire_bus_rmt_reset(onewire_bus_handle_t bus)
     esp_err_t ret = ESP_OK;
 
     xSemaphoreTake(bus_rmt->bus_mutex, portMAX_DELAY);
+    bus_rmt->rx_bytes_num = 0;
     // send reset pulse while receive presence pulse
     ESP_GOTO_ON_ERROR(rmt_receive(bus_rmt->rx_channel, bus_rmt->rx_symbols_buf, sizeof(rmt_symbol_word_t) * 2, &onewire_rmt_rx_config),
                       err, TAG, "1-wire reset pulse receive failed");
@@ -420,14 +419,14 @@ err:
 
 // While receiving data, we use rmt transmit channel to send 0xFF to generate read pulse,
 // at the same time, receive channel is used to record weather the bus is pulled down by device.
-static esp_err_t onewire_bus_rmt_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size)
+static esp_err_t onewire_bus_rmt_read_bytes_crc(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size, uint8_t *ret_crc)
 {
     onewire_bus_rmt_obj_t *bus_rmt = __containerof(bus, onewire_bus_rmt_obj_t, base);
     esp_err_t ret = ESP_OK;
     ESP_RETURN_ON_FALSE(rx_buf_size <= bus_rmt->max_rx_bytes, ESP_ERR_INVALID_ARG, TAG, "rx_buf_size too large for buffer to hold");
-    memset(rx_buf, 0, rx_buf_size);
 
     xSemaphoreTake(bus_rmt->bus_mutex, portMAX_DELAY);
+    bus_rmt->rx_bytes_num = rx_buf_size;
 
     // transmit one bits to generate read clock
     uint8_t tx_buffer[rx_buf_size];
@@ -438,17 +437,25 @@ static esp_err_t onewire_bus_rmt_read_bytes(onewire_bus_handle_t bus, uint8_t *r
     ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_bytes_encoder, tx_buffer, sizeof(tx_buffer), &onewire_rmt_tx_config),
                       err, TAG, "1-wire data transmit failed");
 
-    // wait the transmission finishes and decode data
+    // wait the transmission finishes, the rx done callback has decoded the data
     rmt_rx_done_event_data_t rmt_rx_evt_data;
     ESP_GOTO_ON_FALSE(xQueueReceive(bus_rmt->receive_queue, &rmt_rx_evt_data, pdMS_TO_TICKS(1000)) == pdPASS, ESP_ERR_TIMEOUT,
                       err, TAG, "1-wire data receive timeout");
-    onewire_rmt_decode_data(rmt_rx_evt_data.received_symbols, rmt_rx_evt_data.num_symbols, rx_buf, rx_buf_size);
+    memcpy(rx_buf, bus_rmt->rx_bytes_buf, rx_buf_size);
+    if (ret_crc) {
+        *ret_crc = bus_rmt->rx_crc;
+    }
 
 err:
     xSemaphoreGive(bus_rmt->bus_mutex);
     return ret;
 }
 
+static esp_err_t onewire_bus_rmt_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size)
+{
+    return onewire_bus_rmt_read_bytes_crc(bus, rx_buf, rx_buf_size, NULL);
+}
+
 static esp_err_t onewire_bus_rmt_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit)
 {
     onewire_bus_rmt_obj_t *bus_rmt = __containerof(bus, onewire_bus_rmt_obj_t, base);
@@ -474,6 +481,7 @@ static esp_err_t onewire_bus_rmt_read_bit(onewire_bus_handle_t bus, uint8_t *rx_
     esp_err_t ret = ESP_OK;
 
     xSemaphoreTake(bus_rmt->bus_mutex, portMAX_DELAY);
+    bus_rmt->rx_bytes_num = 1;
 
     // transmit 1 bit while receiving
     ESP_GOTO_ON_ERROR(rmt_receive(bus_rmt->rx_channel, bus_rmt->rx_symbols_buf, sizeof(rmt_symbol_word_t), &onewire_rmt_rx_config),
@@ -481,13 +489,11 @@ static esp_err_t onewire_bus_rmt_read_bit(onewire_bus_handle_t bus, uint8_t *rx_
     ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_copy_encoder, &onewire_bit1_symbol, sizeof(rmt_symbol_word_t), &onewire_rmt_tx_config),
                       err, TAG, "1-wire bit transmit failed");
 
-    // wait the transmission finishes and decode data
+    // wait the transmission finishes, the rx done callback has decoded the bit
     rmt_rx_done_event_data_t rmt_rx_evt_data;
     ESP_GOTO_ON_FALSE(xQueueReceive(bus_rmt->receive_queue, &rmt_rx_evt_data, pdMS_TO_TICKS(1000)) == pdPASS, ESP_ERR_TIMEOUT,
                       err, TAG, "1-wire bit receive timeout");
-    uint8_t rx_buffer = 0;
-    onewire_rmt_decode_data(rmt_rx_evt_data.received_symbols, rmt_rx_evt_data.num_symbols, &rx_buffer, sizeof(rx_buffer));
-    *rx_bit = rx_buffer & 0x01;
+    *rx_bit = bus_rmt->rx_bytes_buf[0] & 0x01;
 
 err:
     xSemaphoreGive(bus_rmt->bus_mutex);
@@ -0,0 +1,314 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "onewire_crc.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#else
+#define DRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+/*
+ * Dallas/Maxim CRC-8, polynomial x^8 + x^5 + x^4 + 1, reflected (0x8C), in
+ * five variants. ONEWIRE_CRC8_IMPL picks the one behind onewire_crc8() and
+ * onewire_crc8_update(). The others are built for the benchmarks and the
+ * self-test; the linker drops them only when CONFIG_ONEWIRE_CRC8_SELF_TEST
+ * is off, since the self-test references every variant.
+ *
+ * The tables used by onewire_crc8_update() live in DRAM, so the update can
+ * run from an ISR while the flash cache is off: 256 bytes for the table,
+ * 16 for the nibble variant. The slice tables (T1..T7, 1792 bytes) stay in
+ * flash; slicing only pays off on whole 4- or 8-byte blocks, which only the
+ * bulk function sees.
+ */
+#ifndef ONEWIRE_CRC8_IMPL
+#define ONEWIRE_CRC8_IMPL ONEWIRE_CRC8_TABLE
+#endif
+
+// T0[x]: CRC of the byte x from a zero CRC
+static const DRAM_ATTR uint8_t dallas_crc8_table[256] = {
+    0x00, 0x5e, 0xbc, 0xe2, 0x61, 0x3f, 0xdd, 0x83, 0xc2, 0x9c, 0x7e, 0x20, 0xa3, 0xfd, 0x1f, 0x41,
+    0x9d, 0xc3, 0x21, 0x7f, 0xfc, 0xa2, 0x40, 0x1e, 0x5f, 0x01, 0xe3, 0xbd, 0x3e, 0x60, 0x82, 0xdc,
+    0x23, 0x7d, 0x9f, 0xc1, 0x42, 0x1c, 0xfe, 0xa0, 0xe1, 0xbf, 0x5d, 0x03, 0x80, 0xde, 0x3c, 0x62,
+    0xbe, 0xe0, 0x02, 0x5c, 0xdf, 0x81, 0x63, 0x3d, 0x7c, 0x22, 0xc0, 0x9e, 0x1d, 0x43, 0xa1, 0xff,
+    0x46, 0x18, 0xfa, 0xa4, 0x27, 0x79, 0x9b, 0xc5, 0x84, 0xda, 0x38, 0x66, 0xe5, 0xbb, 0x59, 0x07,
+    0xdb, 0x85, 0x67, 0x39, 0xba, 0xe4, 0x06, 0x58, 0x19, 0x47, 0xa5, 0xfb, 0x78, 0x26, 0xc4, 0x9a,
+    0x65, 0x3b, 0xd9, 0x87, 0x04, 0x5a, 0xb8, 0xe6, 0xa7, 0xf9, 0x1b, 0x45, 0xc6, 0x98, 0x7a, 0x24,
+    0xf8, 0xa6, 0x44, 0x1a, 0x99, 0xc7, 0x25, 0x7b, 0x3a, 0x64, 0x86, 0xd8, 0x5b, 0x05, 0xe7, 0xb9,
+    0x8c, 0xd2, 0x30, 0x6e, 0xed, 0xb3, 0x51, 0x0f, 0x4e, 0x10, 0xf2, 0xac, 0x2f, 0x71, 0x93, 0xcd,
+    0x11, 0x4f, 0xad, 0xf3, 0x70, 0x2e, 0xcc, 0x92, 0xd3, 0x8d, 0x6f, 0x31, 0xb2, 0xec, 0x0e, 0x50,
+    0xaf, 0xf1, 0x13, 0x4d, 0xce, 0x90, 0x72, 0x2c, 0x6d, 0x33, 0xd1, 0x8f, 0x0c, 0x52, 0xb0, 0xee,
+    0x32, 0x6c, 0x8e, 0xd0, 0x53, 0x0d, 0xef, 0xb1, 0xf0, 0xae, 0x4c, 0x12, 0x91, 0xcf, 0x2d, 0x73,
+    0xca, 0x94, 0x76, 0x28, 0xab, 0xf5, 0x17, 0x49, 0x08, 0x56, 0xb4, 0xea, 0x69, 0x37, 0xd5, 0x8b,
+    0x57, 0x09, 0xeb, 0xb5, 0x36, 0x68, 0x8a, 0xd4, 0x95, 0xcb, 0x29, 0x77, 0xf4, 0xaa, 0x48, 0x16,
+    0xe9, 0xb7, 0x55, 0x0b, 0x88, 0xd6, 0x34, 0x6a, 0x2b, 0x75, 0x97, 0xc9, 0x4a, 0x14, 0xf6, 0xa8,
+    0x74, 0x2a, 0xc8, 0x96, 0x15, 0x4b, 0xa9, 0xf7, 0xb6, 0xe8, 0x0a, 0x54, 0xd7, 0x89, 0x6b, 0x35,
+};
+
+// Tk[x] = T0[T(k-1)[x]]: x followed by k zero bytes
+static const uint8_t dallas_crc8_slice[7][256] = {
+    {
+        0x00, 0xc4, 0x91, 0x55, 0x3b, 0xff, 0xaa, 0x6e, 0x76, 0xb2, 0xe7, 0x23, 0x4d, 0x89, 0xdc, 0x18,
+        0xec, 0x28, 0x7d, 0xb9, 0xd7, 0x13, 0x46, 0x82, 0x9a, 0x5e, 0x0b, 0xcf, 0xa1, 0x65, 0x30, 0xf4,
+        0xc1, 0x05, 0x50, 0x94, 0xfa, 0x3e, 0x6b, 0xaf, 0xb7, 0x73, 0x26, 0xe2, 0x8c, 0x48, 0x1d, 0xd9,
+        0x2d, 0xe9, 0xbc, 0x78, 0x16, 0xd2, 0x87, 0x43, 0x5b, 0x9f, 0xca, 0x0e, 0x60, 0xa4, 0xf1, 0x35,
+        0x9b, 0x5f, 0x0a, 0xce, 0xa0, 0x64, 0x31, 0xf5, 0xed, 0x29, 0x7c, 0xb8, 0xd6, 0x12, 0x47, 0x83,
+        0x77, 0xb3, 0xe6, 0x22, 0x4c, 0x88, 0xdd, 0x19, 0x01, 0xc5, 0x90, 0x54, 0x3a, 0xfe, 0xab, 0x6f,
+        0x5a, 0x9e, 0xcb, 0x0f, 0x61, 0xa5, 0xf0, 0x34, 0x2c, 0xe8, 0xbd, 0x79, 0x17, 0xd3, 0x86, 0x42,
+        0xb6, 0x72, 0x27, 0xe3, 0x8d, 0x49, 0x1c, 0xd8, 0xc0, 0x04, 0x51, 0x95, 0xfb, 0x3f, 0x6a, 0xae,
+        0x2f, 0xeb, 0xbe, 0x7a, 0x14, 0xd0, 0x85, 0x41, 0x59, 0x9d, 0xc8, 0x0c, 0x62, 0xa6, 0xf3, 0x37,
+        0xc3, 0x07, 0x52, 0x96, 0xf8, 0x3c, 0x69, 0xad, 0xb5, 0x71, 0x24, 0xe0, 0x8e, 0x4a, 0x1f, 0xdb,
+        0xee, 0x2a, 0x7f, 0xbb, 0xd5, 0x11, 0x44, 0x80, 0x98, 0x5c, 0x09, 0xcd, 0xa3, 0x67, 0x32, 0xf6,
+        0x02, 0xc6, 0x93, 0x57, 0x39, 0xfd, 0xa8, 0x6c, 0x74, 0xb0, 0xe5, 0x21, 0x4f, 0x8b, 0xde, 0x1a,
+        0xb4, 0x70, 0x25, 0xe1, 0x8f, 0x4b, 0x1e, 0xda, 0xc2, 0x06, 0x53, 0x97, 0xf9, 0x3d, 0x68, 0xac,
+        0x58, 0x9c, 0xc9, 0x0d, 0x63, 0xa7, 0xf2, 0x36, 0x2e, 0xea, 0xbf, 0x7b, 0x15, 0xd1, 0x84, 0x40,
+        0x75, 0xb1, 0xe4, 0x20, 0x4e, 0x8a, 0xdf, 0x1b, 0x03, 0xc7, 0x92, 0x56, 0x38, 0xfc, 0xa9, 0x6d,
+        0x99, 0x5d, 0x08, 0xcc, 0xa2, 0x66, 0x33, 0xf7, 0xef, 0x2b, 0x7e, 0xba, 0xd4, 0x10, 0x45, 0x81,
+    },
+    {
+        0x00, 0xab, 0x4f, 0xe4, 0x9e, 0x35, 0xd1, 0x7a, 0x25, 0x8e, 0x6a, 0xc1, 0xbb, 0x10, 0xf4, 0x5f,
+        0x4a, 0xe1, 0x05, 0xae, 0xd4, 0x7f, 0x9b, 0x30, 0x6f, 0xc4, 0x20, 0x8b, 0xf1, 0x5a, 0xbe, 0x15,
+        0x94, 0x3f, 0xdb, 0x70, 0x0a, 0xa1, 0x45, 0xee, 0xb1, 0x1a, 0xfe, 0x55, 0x2f, 0x84, 0x60, 0xcb,
+        0xde, 0x75, 0x91, 0x3a, 0x40, 0xeb, 0x0f, 0xa4, 0xfb, 0x50, 0xb4, 0x1f, 0x65, 0xce, 0x2a, 0x81,
+        0x31, 0x9a, 0x7e, 0xd5, 0xaf, 0x04, 0xe0, 0x4b, 0x14, 0xbf, 0x5b, 0xf0, 0x8a, 0x21, 0xc5, 0x6e,
+        0x7b, 0xd0, 0x34, 0x9f, 0xe5, 0x4e, 0xaa, 0x01, 0x5e, 0xf5, 0x11, 0xba, 0xc0, 0x6b, 0x8f, 0x24,
+        0xa5, 0x0e, 0xea, 0x41, 0x3b, 0x90, 0x74, 0xdf, 0x80, 0x2b, 0xcf, 0x64, 0x1e, 0xb5, 0x51, 0xfa,
+        0xef, 0x44, 0xa0, 0x0b, 0x71, 0xda, 0x3e, 0x95, 0xca, 0x61, 0x85, 0x2e, 0x54, 0xff, 0x1b, 0xb0,
+        0x62, 0xc9, 0x2d, 0x86, 0xfc, 0x57, 0xb3, 0x18, 0x47, 0xec, 0x08, 0xa3, 0xd9, 0x72, 0x96, 0x3d,
+        0x28, 0x83, 0x67, 0xcc, 0xb6, 0x1d, 0xf9, 0x52, 0x0d, 0xa6, 0x42, 0xe9, 0x93, 0x38, 0xdc, 0x77,
+        0xf6, 0x5d, 0xb9, 0x12, 0x68, 0xc3, 0x27, 0x8c, 0xd3, 0x78, 0x9c, 0x37, 0x4d, 0xe6, 0x02, 0xa9,
+        0xbc, 0x17, 0xf3, 0x58, 0x22, 0x89, 0x6d, 0xc6, 0x99, 0x32, 0xd6, 0x7d, 0x07, 0xac, 0x48, 0xe3,
+        0x53, 0xf8, 0x1c, 0xb7, 0xcd, 0x66, 0x82, 0x29, 0x76, 0xdd, 0x39, 0x92, 0xe8, 0x43, 0xa7, 0x0c,
+        0x19, 0xb2, 0x56, 0xfd, 0x87, 0x2c, 0xc8, 0x63, 0x3c, 0x97, 0x73, 0xd8, 0xa2, 0x09, 0xed, 0x46,
+        0xc7, 0x6c, 0x88, 0x23, 0x59, 0xf2, 0x16, 0xbd, 0xe2, 0x49, 0xad, 0x06, 0x7c, 0xd7, 0x33, 0x98,
+        0x8d, 0x26, 0xc2, 0x69, 0x13, 0xb8, 0x5c, 0xf7, 0xa8, 0x03, 0xe7, 0x4c, 0x36, 0x9d, 0x79, 0xd2,
+    },
+    {
+        0x00, 0x8f, 0x07, 0x88, 0x0e, 0x81, 0x09, 0x86, 0x1c, 0x93, 0x1b, 0x94, 0x12, 0x9d, 0x15, 0x9a,
+        0x38, 0xb7, 0x3f, 0xb0, 0x36, 0xb9, 0x31, 0xbe, 0x24, 0xab, 0x23, 0xac, 0x2a, 0xa5, 0x2d, 0xa2,
+        0x70, 0xff, 0x77, 0xf8, 0x7e, 0xf1, 0x79, 0xf6, 0x6c, 0xe3, 0x6b, 0xe4, 0x62, 0xed, 0x65, 0xea,
+        0x48, 0xc7, 0x4f, 0xc0, 0x46, 0xc9, 0x41, 0xce, 0x54, 0xdb, 0x53, 0xdc, 0x5a, 0xd5, 0x5d, 0xd2,
+        0xe0, 0x6f, 0xe7, 0x68, 0xee, 0x61, 0xe9, 0x66, 0xfc, 0x73, 0xfb, 0x74, 0xf2, 0x7d, 0xf5, 0x7a,
+        0xd8, 0x57, 0xdf, 0x50, 0xd6, 0x59, 0xd1, 0x5e, 0xc4, 0x4b, 0xc3, 0x4c, 0xca, 0x45, 0xcd, 0x42,
+        0x90, 0x1f, 0x97, 0x18, 0x9e, 0x11, 0x99, 0x16, 0x8c, 0x03, 0x8b, 0x04, 0x82, 0x0d, 0x85, 0x0a,
+        0xa8, 0x27, 0xaf, 0x20, 0xa6, 0x29, 0xa1, 0x2e, 0xb4, 0x3b, 0xb3, 0x3c, 0xba, 0x35, 0xbd, 0x32,
+        0xd9, 0x56, 0xde, 0x51, 0xd7, 0x58, 0xd0, 0x5f, 0xc5, 0x4a, 0xc2, 0x4d, 0xcb, 0x44, 0xcc, 0x43,
+        0xe1, 0x6e, 0xe6, 0x69, 0xef, 0x60, 0xe8, 0x67, 0xfd, 0x72, 0xfa, 0x75, 0xf3, 0x7c, 0xf4, 0x7b,
+        0xa9, 0x26, 0xae, 0x21, 0xa7, 0x28, 0xa0, 0x2f, 0xb5, 0x3a, 0xb2, 0x3d, 0xbb, 0x34, 0xbc, 0x33,
+        0x91, 0x1e, 0x96, 0x19, 0x9f, 0x10, 0x98, 0x17, 0x8d, 0x02, 0x8a, 0x05, 0x83, 0x0c, 0x84, 0x0b,
+        0x39, 0xb6, 0x3e, 0xb1, 0x37, 0xb8, 0x30, 0xbf, 0x25, 0xaa, 0x22, 0xad, 0x2b, 0xa4, 0x2c, 0xa3,
+        0x01, 0x8e, 0x06, 0x89, 0x0f, 0x80, 0x08, 0x87, 0x1d, 0x92, 0x1a, 0x95, 0x13, 0x9c, 0x14, 0x9b,
+        0x49, 0xc6, 0x4e, 0xc1, 0x47, 0xc8, 0x40, 0xcf, 0x55, 0xda, 0x52, 0xdd, 0x5b, 0xd4, 0x5c, 0xd3,
+        0x71, 0xfe, 0x76, 0xf9, 0x7f, 0xf0, 0x78, 0xf7, 0x6d, 0xe2, 0x6a, 0xe5, 0x63, 0xec, 0x64, 0xeb,
+    },
+    {
+        0x00, 0xcd, 0x83, 0x4e, 0x1f, 0xd2, 0x9c, 0x51, 0x3e, 0xf3, 0xbd, 0x70, 0x21, 0xec, 0xa2, 0x6f,
+        0x7c, 0xb1, 0xff, 0x32, 0x63, 0xae, 0xe0, 0x2d, 0x42, 0x8f, 0xc1, 0x0c, 0x5d, 0x90, 0xde, 0x13,
+        0xf8, 0x35, 0x7b, 0xb6, 0xe7, 0x2a, 0x64, 0xa9, 0xc6, 0x0b, 0x45, 0x88, 0xd9, 0x14, 0x5a, 0x97,
+        0x84, 0x49, 0x07, 0xca, 0x9b, 0x56, 0x18, 0xd5, 0xba, 0x77, 0x39, 0xf4, 0xa5, 0x68, 0x26, 0xeb,
+        0xe9, 0x24, 0x6a, 0xa7, 0xf6, 0x3b, 0x75, 0xb8, 0xd7, 0x1a, 0x54, 0x99, 0xc8, 0x05, 0x4b, 0x86,
+        0x95, 0x58, 0x16, 0xdb, 0x8a, 0x47, 0x09, 0xc4, 0xab, 0x66, 0x28, 0xe5, 0xb4, 0x79, 0x37, 0xfa,
+        0x11, 0xdc, 0x92, 0x5f, 0x0e, 0xc3, 0x8d, 0x40, 0x2f, 0xe2, 0xac, 0x61, 0x30, 0xfd, 0xb3, 0x7e,
+        0x6d, 0xa0, 0xee, 0x23, 0x72, 0xbf, 0xf1, 0x3c, 0x53, 0x9e, 0xd0, 0x1d, 0x4c, 0x81, 0xcf, 0x02,
+        0xcb, 0x06, 0x48, 0x85, 0xd4, 0x19, 0x57, 0x9a, 0xf5, 0x38, 0x76, 0xbb, 0xea, 0x27, 0x69, 0xa4,
+        0xb7, 0x7a, 0x34, 0xf9, 0xa8, 0x65, 0x2b, 0xe6, 0x89, 0x44, 0x0a, 0xc7, 0x96, 0x5b, 0x15, 0xd8,
+        0x33, 0xfe, 0xb0, 0x7d, 0x2c, 0xe1, 0xaf, 0x62, 0x0d, 0xc0, 0x8e, 0x43, 0x12, 0xdf, 0x91, 0x5c,
+        0x4f, 0x82, 0xcc, 0x01, 0x50, 0x9d, 0xd3, 0x1e, 0x71, 0xbc, 0xf2, 0x3f, 0x6e, 0xa3, 0xed, 0x20,
+        0x22, 0xef, 0xa1, 0x6c, 0x3d, 0xf0, 0xbe, 0x73, 0x1c, 0xd1, 0x9f, 0x52, 0x03, 0xce, 0x80, 0x4d,
+        0x5e, 0x93, 0xdd, 0x10, 0x41, 0x8c, 0xc2, 0x0f, 0x60, 0xad, 0xe3, 0x2e, 0x7f, 0xb2, 0xfc, 0x31,
+        0xda, 0x17, 0x59, 0x94, 0xc5, 0x08, 0x46, 0x8b, 0xe4, 0x29, 0x67, 0xaa, 0xfb, 0x36, 0x78, 0xb5,
+        0xa6, 0x6b, 0x25, 0xe8, 0xb9, 0x74, 0x3a, 0xf7, 0x98, 0x55, 0x1b, 0xd6, 0x87, 0x4a, 0x04, 0xc9,
+    },
+    {
+        0x00, 0x37, 0x6e, 0x59, 0xdc, 0xeb, 0xb2, 0x85, 0xa1, 0x96, 0xcf, 0xf8, 0x7d, 0x4a, 0x13, 0x24,
+        0x5b, 0x6c, 0x35, 0x02, 0x87, 0xb0, 0xe9, 0xde, 0xfa, 0xcd, 0x94, 0xa3, 0x26, 0x11, 0x48, 0x7f,
+        0xb6, 0x81, 0xd8, 0xef, 0x6a, 0x5d, 0x04, 0x33, 0x17, 0x20, 0x79, 0x4e, 0xcb, 0xfc, 0xa5, 0x92,
+        0xed, 0xda, 0x83, 0xb4, 0x31, 0x06, 0x5f, 0x68, 0x4c, 0x7b, 0x22, 0x15, 0x90, 0xa7, 0xfe, 0xc9,
+        0x75, 0x42, 0x1b, 0x2c, 0xa9, 0x9e, 0xc7, 0xf0, 0xd4, 0xe3, 0xba, 0x8d, 0x08, 0x3f, 0x66, 0x51,
+        0x2e, 0x19, 0x40, 0x77, 0xf2, 0xc5, 0x9c, 0xab, 0x8f, 0xb8, 0xe1, 0xd6, 0x53, 0x64, 0x3d, 0x0a,
+        0xc3, 0xf4, 0xad, 0x9a, 0x1f, 0x28, 0x71, 0x46, 0x62, 0x55, 0x0c, 0x3b, 0xbe, 0x89, 0xd0, 0xe7,
+        0x98, 0xaf, 0xf6, 0xc1, 0x44, 0x73, 0x2a, 0x1d, 0x39, 0x0e, 0x57, 0x60, 0xe5, 0xd2, 0x8b, 0xbc,
+        0xea, 0xdd, 0x84, 0xb3, 0x36, 0x01, 0x58, 0x6f, 0x4b, 0x7c, 0x25, 0x12, 0x97, 0xa0, 0xf9, 0xce,
+        0xb1, 0x86, 0xdf, 0xe8, 0x6d, 0x5a, 0x03, 0x34, 0x10, 0x27, 0x7e, 0x49, 0xcc, 0xfb, 0xa2, 0x95,
+        0x5c, 0x6b, 0x32, 0x05, 0x80, 0xb7, 0xee, 0xd9, 0xfd, 0xca, 0x93, 0xa4, 0x21, 0x16, 0x4f, 0x78,
+        0x07, 0x30, 0x69, 0x5e, 0xdb, 0xec, 0xb5, 0x82, 0xa6, 0x91, 0xc8, 0xff, 0x7a, 0x4d, 0x14, 0x23,
+        0x9f, 0xa8, 0xf1, 0xc6, 0x43, 0x74, 0x2d, 0x1a, 0x3e, 0x09, 0x50, 0x67, 0xe2, 0xd5, 0x8c, 0xbb,
+        0xc4, 0xf3, 0xaa, 0x9d, 0x18, 0x2f, 0x76, 0x41, 0x65, 0x52, 0x0b, 0x3c, 0xb9, 0x8e, 0xd7, 0xe0,
+        0x29, 0x1e, 0x47, 0x70, 0xf5, 0xc2, 0x9b, 0xac, 0x88, 0xbf, 0xe6, 0xd1, 0x54, 0x63, 0x3a, 0x0d,
+        0x72, 0x45, 0x1c, 0x2b, 0xae, 0x99, 0xc0, 0xf7, 0xd3, 0xe4, 0xbd, 0x8a, 0x0f, 0x38, 0x61, 0x56,
+    },
+    {
+        0x00, 0x3d, 0x7a, 0x47, 0xf4, 0xc9, 0x8e, 0xb3, 0xf1, 0xcc, 0x8b, 0xb6, 0x05, 0x38, 0x7f, 0x42,
+        0xfb, 0xc6, 0x81, 0xbc, 0x0f, 0x32, 0x75, 0x48, 0x0a, 0x37, 0x70, 0x4d, 0xfe, 0xc3, 0x84, 0xb9,
+        0xef, 0xd2, 0x95, 0xa8, 0x1b, 0x26, 0x61, 0x5c, 0x1e, 0x23, 0x64, 0x59, 0xea, 0xd7, 0x90, 0xad,
+        0x14, 0x29, 0x6e, 0x53, 0xe0, 0xdd, 0x9a, 0xa7, 0xe5, 0xd8, 0x9f, 0xa2, 0x11, 0x2c, 0x6b, 0x56,
+        0xc7, 0xfa, 0xbd, 0x80, 0x33, 0x0e, 0x49, 0x74, 0x36, 0x0b, 0x4c, 0x71, 0xc2, 0xff, 0xb8, 0x85,
+        0x3c, 0x01, 0x46, 0x7b, 0xc8, 0xf5, 0xb2, 0x8f, 0xcd, 0xf0, 0xb7, 0x8a, 0x39, 0x04, 0x43, 0x7e,
+        0x28, 0x15, 0x52, 0x6f, 0xdc, 0xe1, 0xa6, 0x9b, 0xd9, 0xe4, 0xa3, 0x9e, 0x2d, 0x10, 0x57, 0x6a,
+        0xd3, 0xee, 0xa9, 0x94, 0x27, 0x1a, 0x5d, 0x60, 0x22, 0x1f, 0x58, 0x65, 0xd6, 0xeb, 0xac, 0x91,
+        0x97, 0xaa, 0xed, 0xd0, 0x63, 0x5e, 0x19, 0x24, 0x66, 0x5b, 0x1c, 0x21, 0x92, 0xaf, 0xe8, 0xd5,
+        0x6c, 0x51, 0x16, 0x2b, 0x98, 0xa5, 0xe2, 0xdf, 0x9d, 0xa0, 0xe7, 0xda, 0x69, 0x54, 0x13, 0x2e,
+        0x78, 0x45, 0x02, 0x3f, 0x8c, 0xb1, 0xf6, 0xcb, 0x89, 0xb4, 0xf3, 0xce, 0x7d, 0x40, 0x07, 0x3a,
+        0x83, 0xbe, 0xf9, 0xc4, 0x77, 0x4a, 0x0d, 0x30, 0x72, 0x4f, 0x08, 0x35, 0x86, 0xbb, 0xfc, 0xc1,
+        0x50, 0x6d, 0x2a, 0x17, 0xa4, 0x99, 0xde, 0xe3, 0xa1, 0x9c, 0xdb, 0xe6, 0x55, 0x68, 0x2f, 0x12,
+        0xab, 0x96, 0xd1, 0xec, 0x5f, 0x62, 0x25, 0x18, 0x5a, 0x67, 0x20, 0x1d, 0xae, 0x93, 0xd4, 0xe9,
+        0xbf, 0x82, 0xc5, 0xf8, 0x4b, 0x76, 0x31, 0x0c, 0x4e, 0x73, 0x34, 0x09, 0xba, 0x87, 0xc0, 0xfd,
+        0x44, 0x79, 0x3e, 0x03, 0xb0, 0x8d, 0xca, 0xf7, 0xb5, 0x88, 0xcf, 0xf2, 0x41, 0x7c, 0x3b, 0x06,
+    },
+    {
+        0x00, 0x43, 0x86, 0xc5, 0x15, 0x56, 0x93, 0xd0, 0x2a, 0x69, 0xac, 0xef, 0x3f, 0x7c, 0xb9, 0xfa,
+        0x54, 0x17, 0xd2, 0x91, 0x41, 0x02, 0xc7, 0x84, 0x7e, 0x3d, 0xf8, 0xbb, 0x6b, 0x28, 0xed, 0xae,
+        0xa8, 0xeb, 0x2e, 0x6d, 0xbd, 0xfe, 0x3b, 0x78, 0x82, 0xc1, 0x04, 0x47, 0x97, 0xd4, 0x11, 0x52,
+        0xfc, 0xbf, 0x7a, 0x39, 0xe9, 0xaa, 0x6f, 0x2c, 0xd6, 0x95, 0x50, 0x13, 0xc3, 0x80, 0x45, 0x06,
+        0x49, 0x0a, 0xcf, 0x8c, 0x5c, 0x1f, 0xda, 0x99, 0x63, 0x20, 0xe5, 0xa6, 0x76, 0x35, 0xf0, 0xb3,
+        0x1d, 0x5e, 0x9b, 0xd8, 0x08, 0x4b, 0x8e, 0xcd, 0x37, 0x74, 0xb1, 0xf2, 0x22, 0x61, 0xa4, 0xe7,
+        0xe1, 0xa2, 0x67, 0x24, 0xf4, 0xb7, 0x72, 0x31, 0xcb, 0x88, 0x4d, 0x0e, 0xde, 0x9d, 0x58, 0x1b,
+        0xb5, 0xf6, 0x33, 0x70, 0xa0, 0xe3, 0x26, 0x65, 0x9f, 0xdc, 0x19, 0x5a, 0x8a, 0xc9, 0x0c, 0x4f,
+        0x92, 0xd1, 0x14, 0x57, 0x87, 0xc4, 0x01, 0x42, 0xb8, 0xfb, 0x3e, 0x7d, 0xad, 0xee, 0x2b, 0x68,
+        0xc6, 0x85, 0x40, 0x03, 0xd3, 0x90, 0x55, 0x16, 0xec, 0xaf, 0x6a, 0x29, 0xf9, 0xba, 0x7f, 0x3c,
+        0x3a, 0x79, 0xbc, 0xff, 0x2f, 0x6c, 0xa9, 0xea, 0x10, 0x53, 0x96, 0xd5, 0x05, 0x46, 0x83, 0xc0,
+        0x6e, 0x2d, 0xe8, 0xab, 0x7b, 0x38, 0xfd, 0xbe, 0x44, 0x07, 0xc2, 0x81, 0x51, 0x12, 0xd7, 0x94,
+        0xdb, 0x98, 0x5d, 0x1e, 0xce, 0x8d, 0x48, 0x0b, 0xf1, 0xb2, 0x77, 0x34, 0xe4, 0xa7, 0x62, 0x21,
+        0x8f, 0xcc, 0x09, 0x4a, 0x9a, 0xd9, 0x1c, 0x5f, 0xa5, 0xe6, 0x23, 0x60, 0xb0, 0xf3, 0x36, 0x75,
+        0x73, 0x30, 0xf5, 0xb6, 0x66, 0x25, 0xe0, 0xa3, 0x59, 0x1a, 0xdf, 0x9c, 0x4c, 0x0f, 0xca, 0x89,
+        0x27, 0x64, 0xa1, 0xe2, 0x32, 0x71, 0xb4, 0xf7, 0x0d, 0x4e, 0x8b, 0xc8, 0x18, 0x5b, 0x9e, 0xdd,
+    },
+};
+
+// N[x]: CRC of the low nibble x after four bit steps
+static const DRAM_ATTR uint8_t dallas_crc8_nibble[16] = {
+    0x00, 0x9d, 0x23, 0xbe, 0x46, 0xdb, 0x65, 0xf8, 0x8c, 0x11, 0xaf, 0x32, 0xca, 0x57, 0xe9, 0x74,
+};
+
+uint8_t onewire_crc8_bitwise(uint8_t init_crc, const uint8_t *input, size_t input_size)
+{
+    uint8_t crc = init_crc;
+    for (size_t i = 0; i < input_size; i++) {
+        uint8_t byte = input[i];
+        for (int j = 0; j < 8; j++) {
+            uint8_t x = (byte ^ crc) & 0x01;
+            crc >>= 1;
+            if (x != 0) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+uint8_t onewire_crc8_table(uint8_t init_crc, const uint8_t *input, size_t input_size)
+{
+    uint8_t crc = init_crc;
+    for (size_t i = 0; i < input_size; i ++) {
+        crc = dallas_crc8_table[crc ^ input[i]];
+    }
+    return crc;
+}
+
+uint8_t onewire_crc8_nibble(uint8_t init_crc, const uint8_t *input, size_t input_size)
+{
+    uint8_t crc = init_crc;
+    for (size_t i = 0; i < input_size; i++) {
+        crc ^= input[i];
+        crc = (crc >> 4) ^ dallas_crc8_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ dallas_crc8_nibble[crc & 0x0F];
+    }
+    return crc;
+}
+
+uint8_t onewire_crc8_slice4(uint8_t init_crc, const uint8_t *input, size_t input_size)
+{
+    uint8_t crc = init_crc;
+    size_t i = 0;
+    for (; i + 4 <= input_size; i += 4) {
+        crc = dallas_crc8_slice[2][crc ^ input[i]] ^ dallas_crc8_slice[1][input[i + 1]] ^
+              dallas_crc8_slice[0][input[i + 2]] ^ dallas_crc8_table[input[i + 3]];
+    }
+    for (; i < input_size; i++) {
+        crc = dallas_crc8_table[crc ^ input[i]];
+    }
+    return crc;
+}
+
+uint8_t onewire_crc8_slice8(uint8_t init_crc, const uint8_t *input, size_t input_size)
+{
+    uint8_t crc = init_crc;
+    size_t i = 0;
+    for (; i + 8 <= input_size; i += 8) {
+        crc = dallas_crc8_slice[6][crc ^ input[i]] ^ dallas_crc8_slice[5][input[i + 1]] ^
+              dallas_crc8_slice[4][input[i + 2]] ^ dallas_crc8_slice[3][input[i + 3]] ^
+              dallas_crc8_slice[2][input[i + 4]] ^ dallas_crc8_slice[1][input[i + 5]] ^
+              dallas_crc8_slice[0][input[i + 6]] ^ dallas_crc8_table[input[i + 7]];
+    }
+    return onewire_crc8_slice4(crc, input + i, input_size - i);
+}
+
+uint8_t onewire_crc8(uint8_t init_crc, uint8_t *input, size_t input_size)
+{
+#if ONEWIRE_CRC8_IMPL == ONEWIRE_CRC8_BITWISE
+    return onewire_crc8_bitwise(init_crc, input, input_size);
+#elif ONEWIRE_CRC8_IMPL == ONEWIRE_CRC8_NIBBLE
+    return onewire_crc8_nibble(init_crc, input, input_size);
+#elif ONEWIRE_CRC8_IMPL == ONEWIRE_CRC8_SLICE4
+    return onewire_crc8_slice4(init_crc, input, input_size);
+#elif ONEWIRE_CRC8_IMPL == ONEWIRE_CRC8_SLICE8
+    return onewire_crc8_slice8(init_crc, input, input_size);
+#else
+    return onewire_crc8_table(init_crc, input, input_size);
+#endif
+}
+
+IRAM_ATTR
+uint8_t onewire_crc8_update(uint8_t crc, uint8_t byte)
+{
+#if ONEWIRE_CRC8_IMPL == ONEWIRE_CRC8_BITWISE
+    return onewire_crc8_bitwise(crc, &byte, 1);
+#elif ONEWIRE_CRC8_IMPL == ONEWIRE_CRC8_NIBBLE
+    crc ^= byte;
+    crc = (crc >> 4) ^ dallas_crc8_nibble[crc & 0x0F];
+    return (crc >> 4) ^ dallas_crc8_nibble[crc & 0x0F];
+#else
+    return dallas_crc8_table[crc ^ byte];
+#endif
+}
+
+#if !defined(ESP_PLATFORM) || CONFIG_ONEWIRE_CRC8_SELF_TEST
+bool onewire_crc8_self_test(void)
+{
+    // Check value of CRC-8/MAXIM
+    static const uint8_t check[] = "123456789";
+    if (onewire_crc8_bitwise(0, check, 9) != 0xA1) {
+        return false;
+    }
+    uint8_t buf[24];
+    uint32_t seed = 1;
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = seed >> 16;
+    }
+    // Every variant and the streaming form against the bitwise reference,
+    // at every length and alignment the slicing loops distinguish
+    for (size_t len = 0; len <= 17; len++) {
+        for (size_t off = 0; off + len <= sizeof(buf); off += 7) {
+            uint8_t crc = onewire_crc8_bitwise(0x5A, buf + off, len);
+            uint8_t stream = 0x5A;
+            for (size_t i = 0; i < len; i++) {
+                stream = onewire_crc8_update(stream, buf[off + i]);
+            }
+            if (onewire_crc8_table(0x5A, buf + off, len) != crc || onewire_crc8_nibble(0x5A, buf + off, len) != crc ||
+                    onewire_crc8_slice4(0x5A, buf + off, len) != crc || onewire_crc8_slice8(0x5A, buf + off, len) != crc ||
+                    onewire_crc8(0x5A, buf + off, len) != crc || stream != crc) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#endif
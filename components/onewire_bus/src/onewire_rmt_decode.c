@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "onewire_rmt_decode.h"
+#include "onewire_crc.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#else
+#define IRAM_ATTR
+#endif
+
+#define ONEWIRE_SLOT_BIT_SAMPLE_TIME            15 // how long after bit start pulse should the master sample from the bus
+
+/*
+ * Bit of one read slot from the whole symbol word: duration0 is its low 15
+ * bits, and duration0 - (SAMPLE_TIME + 1) wraps around, setting bit 31,
+ * exactly when the device did not hold the bus past the sample time.
+ */
+#define ONEWIRE_RMT_SLOT_BIT(symbol) \
+    ((((symbol).val & 0x7FFF) - (ONEWIRE_SLOT_BIT_SAMPLE_TIME + 1)) >> 31)
+
+IRAM_ATTR
+uint8_t onewire_rmt_decode_bytes(const rmt_symbol_word_t *rmt_symbols, size_t symbol_num, uint8_t *rx_buf, size_t rx_buf_size, uint8_t init_crc)
+{
+    uint8_t crc = init_crc;
+    size_t whole = symbol_num / 8;
+    if (whole > rx_buf_size) {
+        whole = rx_buf_size;
+    }
+
+    // each byte is built in a register from 8 slots, then stored once
+    for (size_t i = 0; i < whole; i ++) {
+        const rmt_symbol_word_t *s = rmt_symbols + i * 8;
+        uint8_t byte = ONEWIRE_RMT_SLOT_BIT(s[0]) | ONEWIRE_RMT_SLOT_BIT(s[1]) << 1 |
+                       ONEWIRE_RMT_SLOT_BIT(s[2]) << 2 | ONEWIRE_RMT_SLOT_BIT(s[3]) << 3 |
+                       ONEWIRE_RMT_SLOT_BIT(s[4]) << 4 | ONEWIRE_RMT_SLOT_BIT(s[5]) << 5 |
+                       ONEWIRE_RMT_SLOT_BIT(s[6]) << 6 | ONEWIRE_RMT_SLOT_BIT(s[7]) << 7;
+        rx_buf[i] = byte;
+        crc = onewire_crc8_update(crc, byte);
+    }
+
+    // a short read: the remaining slots, then zeros
+    for (size_t i = whole; i < rx_buf_size; i ++) {
+        uint8_t byte = 0;
+        for (size_t bit = 0; bit < 8 && i * 8 + bit < symbol_num; bit ++) {
+            byte |= ONEWIRE_RMT_SLOT_BIT(rmt_symbols[i * 8 + bit]) << bit;
+        }
+        rx_buf[i] = byte;
+        crc = onewire_crc8_update(crc, byte);
+    }
+    return crc;
+}
@@ -0,0 +1,94 @@
+// Sends sequenced commands (main/cmd_proto.h) through the bridge, keeping
+// several in flight, and reports the round-trip times.
+//
+//   node dist/cmd-bench.js [count] [in flight] [request...]
+//
+// e.g. `npm run cmd -- 200 8 READ T0_PH`. The request defaults to PING;
+// BRIDGE overrides ws://localhost:8080.
+
+const WebSocket = require('ws');
+
+export {};
+
+const count = Number(process.argv[2] ?? 100);
+const inFlight = Number(process.argv[3] ?? 4);
+const request = process.argv.slice(4).join(' ') || 'PING';
+const url = process.env.BRIDGE ?? 'ws://localhost:8080';
+const TIMEOUT_MS = 2000;
+
+const sentAt = new Map<number, number>();
+const rtts: number[] = [];
+const results = new Map<string, number>();
+let nextSeq = 1;
+let pending = '';
+
+const ws = new WebSocket(url);
+
+function sendNext() {
+    if (nextSeq > count) {
+        return;
+    }
+    const seq = nextSeq++;
+    sentAt.set(seq, performance.now());
+    ws.send(`#${seq} ${request}\n`);
+    setTimeout(() => {
+        if (sentAt.delete(seq)) {
+            results.set('TIMEOUT', (results.get('TIMEOUT') ?? 0) + 1);
+            finishOrSend();
+        }
+    }, TIMEOUT_MS);
+}
+
+function finishOrSend() {
+    if (nextSeq <= count) {
+        sendNext();
+    } else if (sentAt.size === 0) {
+        report();
+    }
+}
+
+function percentile(sorted: number[], p: number): string {
+    if (sorted.length === 0) {
+        return '-';
+    }
+    return sorted[Math.min(sorted.length - 1, Math.floor((sorted.length * p) / 100))].toFixed(1);
+}
+
+function report() {
+    const sorted = [...rtts].sort((a, b) => a - b);
+    console.log(`${count} x "${request}", ${inFlight} in flight`);
+    console.log(
+        `rtt ms: min ${percentile(sorted, 0)} p50 ${percentile(sorted, 50)} ` +
+            `p99 ${percentile(sorted, 99)} max ${percentile(sorted, 100)}`
+    );
+    for (const [result, n] of results) {
+        console.log(`${result}: ${n}`);
+    }
+    ws.close();
+}
+
+ws.on('open', () => {
+    for (let i = 0; i < inFlight; i++) {
+        sendNext();
+    }
+});
+
+ws.on('message', (data: Buffer) => {
+    const lines = (pending + data.toString()).split('\n');
+    pending = lines.pop()!;
+    for (const line of lines) {
+        const match = /#(\d+) (OK|ERR)(?: (\S+))?/.exec(line);
+        if (!match) {
+            continue;
+        }
+        const start = sentAt.get(Number(match[1]));
+        if (start === undefined) {
+            continue;
+        }
+        sentAt.delete(Number(match[1]));
+        rtts.push(performance.now() - start);
+        const result = match[2] === 'OK' ? 'OK' : match[3];
+        results.set(result, (results.get(result) ?? 0) + 1);
+        finishOrSend();
+    }
+});
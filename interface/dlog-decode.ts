@@ -0,0 +1,83 @@
+// Decodes "G:" deferred log records sent by firmware built with
+// CONFIG_HYDRO_DLOG_HOST_DECODE.
+//
+//   node dist/dlog-decode.js < capture.txt
+//
+// Message formats are read from main/dlog_formats.h, so the decoder always
+// matches the table the firmware was built from.
+
+const fs = require('fs');
+const path = require('path');
+const readline = require('readline');
+
+export {};
+
+interface DlogFormat {
+    level: string;
+    tag: string;
+    format: string;
+}
+
+const formatsPath = process.argv[2] ?? path.join(__dirname, '..', '..', 'main', 'dlog_formats.h');
+
+function loadFormats(file: string): DlogFormat[] {
+    const source: string = fs.readFileSync(file, 'utf8');
+    const row = /X\(\s*\w+\s*,\s*ESP_LOG_(\w+)\s*,\s*"([^"]*)"\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)/g;
+    const formats: DlogFormat[] = [];
+    let match;
+    while ((match = row.exec(source)) !== null) {
+        formats.push({ level: match[1], tag: match[2], format: match[3] });
+    }
+    return formats;
+}
+
+// Expand one printf conversion with a raw 32-bit argument
+function convert(spec: string, raw: number): string {
+    const conv = spec[spec.length - 1];
+    const precision = /\.(\d+)/.exec(spec);
+    if ('feEgG'.includes(conv)) {
+        const view = new DataView(new ArrayBuffer(4));
+        view.setUint32(0, raw);
+        const value = view.getFloat32(0);
+        return precision ? value.toFixed(Number(precision[1])) : value.toFixed(6);
+    }
+    if (conv === 'x' || conv === 'X') {
+        const hex = raw.toString(16);
+        return conv === 'X' ? hex.toUpperCase() : hex;
+    }
+    if (conv === 'u') {
+        return String(raw >>> 0);
+    }
+    if (conv === 'c') {
+        return String.fromCharCode(raw & 0xff);
+    }
+    return String(raw | 0);
+}
+
+function decode(formats: DlogFormat[], line: string): string | null {
+    if (!line.startsWith('G:')) {
+        return null;
+    }
+    const fields = line.slice(2).trim().split(',');
+    const format = formats[Number(fields[0])];
+    if (!format) {
+        return `unknown dlog id ${fields[0]}`;
+    }
+    const timestamp = fields[1];
+    const args = fields.slice(2).map((hex) => parseInt(hex, 16));
+    let next = 0;
+    const text = format.format.replace(/%%|%[-+ 0#]*\d*(?:\.\d+)?[a-zA-Z]/g, (spec) =>
+        spec === '%%' ? '%' : convert(spec, args[next++] ?? 0)
+    );
+    return `${format.level[0]} [${timestamp}] ${format.tag}: ${text}`;
+}
+
+const formats = loadFormats(formatsPath);
+const rl = readline.createInterface({ input: process.stdin });
+
+rl.on('line', (line: string) => {
+    const decoded = decode(formats, line);
+    if (decoded !== null) {
+        console.log(decoded);
+    }
+});
@@ -0,0 +1,79 @@
+// Decoder for the compressed telemetry blocks of main/gorilla.c, sent by the
+// firmware as "Z:<tag>:<base64>" lines after the 'Z' command.
+
+export interface GorillaSample {
+    ms: number;
+    value: number;
+}
+
+const TS_WIDTHS = [3, 7, 12, 32];
+const VALUE_WIDTHS = [4, 8, 16, 32];
+const HEADER_BYTES = 11;
+
+class BitReader {
+    private bytes: Buffer;
+    private pos: number;
+
+    constructor(bytes: Buffer, start: number) {
+        this.bytes = bytes;
+        this.pos = start * 8;
+    }
+
+    bits(n: number): number {
+        let v = 0;
+        for (let i = 0; i < n; i++) {
+            const bit = (this.bytes[this.pos >> 3] >> (7 - (this.pos & 7))) & 1;
+            v = v * 2 + bit;
+            this.pos++;
+        }
+        return v;
+    }
+
+    code(widths: number[]): number {
+        let ones = 0;
+        while (ones < 4 && this.bits(1) === 1) {
+            ones++;
+        }
+        return ones === 0 ? 0 : this.bits(widths[ones - 1]);
+    }
+}
+
+function unzigzag(z: number): number {
+    return z % 2 ? -(z + 1) / 2 : z / 2;
+}
+
+export function decodeBlock(base64: string): { decimals: number; samples: GorillaSample[] } {
+    const bytes = Buffer.from(base64, 'base64');
+    const decimals = bytes.readUInt8(0);
+    let ms = bytes.readUInt32LE(1);
+    let value = bytes.readInt32LE(5);
+    const count = bytes.readUInt16LE(9);
+    const scale = 10 ** decimals;
+    const samples: GorillaSample[] = [{ ms, value: value / scale }];
+
+    const reader = new BitReader(bytes, HEADER_BYTES);
+    let delta = 0;
+    for (let i = 1; i < count; i++) {
+        delta += unzigzag(reader.code(TS_WIDTHS));
+        ms = (ms + delta) >>> 0;
+        value += unzigzag(reader.code(VALUE_WIDTHS));
+        samples.push({ ms, value: value / scale });
+    }
+    return { decimals, samples };
+}
+
+// Rebuild the text messages the firmware sends when not compressing
+export function expandLine(line: string): string[] {
+    const match = /^Z:(\w+):([A-Za-z0-9+/=]+)/.exec(line);
+    if (!match) {
+        return [];
+    }
+    const tag = match[1];
+    const { decimals, samples } = decodeBlock(match[2]);
+    return samples.map(({ value }) => {
+        if (tag.startsWith('WL')) {
+            return `${tag}:${value ? ' HIGH' : ' LOW'}`;
+        }
+        return `${tag}:${value.toFixed(decimals)}`;
+    });
+}
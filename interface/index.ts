@@ -3,6 +3,12 @@ const WebSocketServer = require('ws');
 
 const { SerialPort } = require('serialport');
 const readline = require('readline');
+const fs = require('fs');
+const net = require('net');
+const { expandLine } = require('./gorilla');
+const { startLink, stripLinkReplies } = require('./link');
+
+export {};
 
 interface WebSocketWithSerialPort extends WebSocket {
     send(data: string, cb?: (err?: Error) => void): void;
@@ -18,10 +24,128 @@ const rl = readline.createInterface({
 // Replace with your ESP32's serial port
 const portPath = '/dev/tty.usbserial-59170079241';
 
+// The ESP32 starts at CONFIG_EXAMPLE_UART_BAUD_RATE. LINK_BAUD=921600 asks
+// it to switch to a faster rate (up to CONFIG_HYDRO_UART_LINK_MAX_BAUD), and
+// RTSCTS=1 matches CONFIG_HYDRO_UART_FLOW_CTRL.
+const baseBaud = 115200;
+const linkBaud = Number(process.env.LINK_BAUD ?? baseBaud);
+
+// DEVICE=tcp://<host>:<port> connects to firmware built with
+// CONFIG_HYDRO_TRANSPORT_TCP, e.g. under the linux target, instead of the
+// serial port. The connection is retried until the firmware listens.
+const device = /^tcp:\/\/([^:/]+):(\d+)/.exec(process.env.DEVICE ?? '');
+
+function connectTcp(host: string, tcpPort: number) {
+    const socket = new net.Socket();
+    const connect = () => socket.connect(tcpPort, host);
+    socket.on('error', (err: Error) => console.error(`${host}:${tcpPort}:`, err.message));
+    socket.on('close', () => setTimeout(connect, 1000));
+    connect();
+    return socket;
+}
+
 // Create a new serial port instance
-const port = new SerialPort({
-    path: portPath,
-    baudRate: 115200, // Match the baud rate in your ESP32 code
+const port = device
+    ? connectTcp(device[1], Number(device[2]))
+    : new SerialPort({
+          path: portPath,
+          baudRate: baseBaud,
+          rtscts: process.env.RTSCTS === '1',
+      });
+
+// The flash log on the ESP32 is timestamped with its clock, which starts at
+// zero on every boot
+port.on(device ? 'connect' : 'open', () => {
+    const setClock = () => port.write(`C${Math.floor(Date.now() / 1000)}`);
+    if (device) {
+        setClock();
+    } else {
+        startLink(port, baseBaud, linkBaud, setClock);
+    }
+});
+
+// Split serial text into plain output and the messages of complete "Z:"
+// compressed blocks. A block still missing its newline is returned as rest
+// and must be prepended to the next read.
+function splitCompressed(text: string): { plain: string; messages: string[]; rest: string } {
+    let plain = '';
+    const messages: string[] = [];
+    let pos = 0;
+    for (;;) {
+        const start = text.indexOf('Z:', pos);
+        if (start < 0) {
+            return { plain: plain + text.slice(pos), messages, rest: '' };
+        }
+        const end = text.indexOf('\n', start);
+        if (end < 0) {
+            return { plain: plain + text.slice(pos, start), messages, rest: text.slice(start) };
+        }
+        plain += text.slice(pos, start);
+        messages.push(...expandLine(text.slice(start, end)));
+        pos = end + 1;
+    }
+}
+
+// RECORD=<file> appends every plain-text reading as "<ms>,<tag>,<value>",
+// the trace format of tools/gorilla_bench. Record with compression off:
+// readings unpacked from "Z:" blocks only carry the block's arrival time.
+const recordPath = process.env.RECORD;
+
+// A sensor reading: a tag of hydro_channel_tag() for a sensor role, then its
+// value. Readings are not newline-terminated, so one starts a line or
+// follows the end of another; "Y:", "U:", "B:" and the other replies do not
+// match.
+const reading = /(?<=^|\d|HIGH|LOW)((?:T|PH|WL|L)\d?):\s*(HIGH|LOW|-?\d+(?:\.\d+)?)/gm;
+
+function record(text: string) {
+    if (!recordPath) {
+        return;
+    }
+    const now = Date.now();
+    let rows = '';
+    text = text.replace(captureLine, '');
+    let m;
+    while ((m = reading.exec(text)) !== null) {
+        const value = m[2] === 'HIGH' ? '1' : m[2] === 'LOW' ? '0' : m[2];
+        rows += `${now},${m[1]},${value}\n`;
+    }
+    if (rows) {
+        fs.appendFileSync(recordPath, rows);
+    }
+}
+
+// CAPTURE=<file> appends the raw inputs sent as "W:<ms>,<channel>,<raw>"
+// after "#1 CAPTURE 1", as "<ms>,<channel>,<raw>" lines for tools/replay.
+const capturePath = process.env.CAPTURE;
+const captureLine = /^W:(\d+,\w+,-?\d+)\n/gm;
+
+function capture(text: string) {
+    if (!capturePath) {
+        return;
+    }
+    let rows = '';
+    let m;
+    while ((m = captureLine.exec(text)) !== null) {
+        rows += `${m[1]}\n`;
+    }
+    if (rows) {
+        fs.appendFileSync(capturePath, rows);
+    }
+}
+
+// Complete lines of text, and the unfinished last line to prepend to the
+// next read. "W:" lines are only told apart once whole.
+function splitLines(text: string): { lines: string; rest: string } {
+    const end = text.lastIndexOf('\n') + 1;
+    return { lines: text.slice(0, end), rest: text.slice(end) };
+}
+
+let lineRest = '';
+port.on('data', (data: Buffer) => {
+    const split = splitLines(lineRest + data.toString());
+    lineRest = split.rest;
+    record(split.lines);
+    capture(split.lines);
 });
 
 // Create a new HTTP server
@@ -65,9 +189,21 @@ wss.on('connection', (ws: WebSocketWithSerialPort) => {
     });
 
     // Handle serial port data and send it to WebSocket clients
+    let rest = '';
+    let plainRest = '';
     port.on('data', (data: Buffer) => {
         console.log(`Received from serial port: ${data.toString()}`);
-        ws.send(data.toString());
+        const split = splitCompressed(rest + stripLinkReplies(data.toString()));
+        rest = split.rest;
+        const lines = splitLines(plainRest + split.plain);
+        plainRest = lines.rest;
+        const plain = lines.lines.replace(captureLine, '');
+        if (plain) {
+            ws.send(plain);
+        }
+        for (const message of split.messages) {
+            ws.send(message);
+        }
     });
 
     ws.on('close', () => {
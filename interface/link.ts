@@ -0,0 +1,97 @@
+// Moves the serial link to a faster rate with the "B" command and keeps
+// checking that the ESP32 still answers at it.
+//
+// The ESP32 boots at the base rate. "B<baud>" is answered with "B:<baud>"
+// at the old rate, then both ends switch and the bridge sends "B" at the new
+// rate; the ESP32 falls back to the base rate if nothing arrives within two
+// seconds. When the ESP32 does not answer at the base rate it is assumed to
+// still be at the link rate from an earlier run of the bridge, so the two
+// rates are tried in turn.
+
+const PROBE_MS = 5000;
+const REPLY_MS = 1000;
+
+// Serial text without the "B:<baud>" replies
+export function stripLinkReplies(text: string): string {
+    return text.replace(/B:\d+\r?\n/g, '');
+}
+
+// onReady runs each time the link is (re)established, which is also after
+// the ESP32 rebooted
+export function startLink(port: any, baseBaud: number, linkBaud: number, onReady: () => void) {
+    if (linkBaud === baseBaud) {
+        onReady();
+        return;
+    }
+    let rate = baseBaud;
+    let ready = false;
+    let timer: ReturnType<typeof setTimeout> | undefined;
+    let pending = '';
+
+    const setRate = (baud: number, then: () => void) => {
+        if (baud === rate) {
+            then();
+            return;
+        }
+        port.update({ baudRate: baud }, (err?: Error) => {
+            if (err) {
+                console.error(`Cannot set ${baud} baud:`, err.message);
+                return;
+            }
+            rate = baud;
+            then();
+        });
+    };
+
+    const expectReply = (onTimeout: () => void) => {
+        clearTimeout(timer);
+        timer = setTimeout(onTimeout, REPLY_MS);
+    };
+
+    const negotiate = (from: number) => {
+        ready = false;
+        setRate(from, () => {
+            port.write(`B${linkBaud}`);
+            expectReply(() => negotiate(from === baseBaud ? linkBaud : baseBaud));
+        });
+    };
+
+    const probe = () => {
+        port.write('B');
+        expectReply(() => {
+            console.log('Serial link lost, renegotiating');
+            negotiate(baseBaud);
+        });
+    };
+
+    port.on('data', (data: Buffer) => {
+        // Readings are not newline-terminated, so only keep enough of the
+        // text for a reply split across reads
+        const lines = (pending + data.toString('latin1')).split('\n');
+        pending = lines.pop()!.slice(-16);
+        for (const line of lines) {
+            const match = /B:(\d+)\r?$/.exec(line);
+            if (!match) {
+                continue;
+            }
+            const baud = Number(match[1]);
+            if (baud !== rate) {
+                clearTimeout(timer);
+                setRate(baud, () => {
+                    port.write('B');
+                    expectReply(() => negotiate(baseBaud));
+                });
+                continue;
+            }
+            if (!ready) {
+                ready = true;
+                console.log(`Serial link at ${baud} baud`);
+                onReady();
+            }
+            clearTimeout(timer);
+            timer = setTimeout(probe, PROBE_MS);
+        }
+    });
+
+    negotiate(baseBaud);
+}
@@ -0,0 +1,84 @@
+// Converts a "T" trace dump from the firmware into Chrome trace event JSON,
+// which Perfetto and chrome://tracing can open.
+//
+//   node dist/trace2chrome.js < capture.txt > trace.json
+//
+// Dump lines look like "TR:<core>,<us>,<B|E>,<event>,<arg>,<task>".
+
+const readline = require('readline');
+
+export {};
+
+interface TraceEvent {
+    name: string;
+    ph: string;
+    ts: number;
+    pid: number;
+    tid: number;
+    args: { arg: number };
+}
+
+const events: TraceEvent[] = [];
+// The device sends the low 32 bits of its microsecond clock; count wraps per core
+const lastTs = new Map<number, number>();
+const wraps = new Map<number, number>();
+// Chrome trace tids must be integers: number the tasks in order of appearance
+const tids = new Map<string, number>();
+const tasks: string[] = [];
+
+function tid(task: string): number {
+    let id = tids.get(task);
+    if (id === undefined) {
+        id = tasks.push(task) - 1;
+        tids.set(task, id);
+    }
+    return id;
+}
+
+function parse(line: string): TraceEvent | null {
+    if (!line.startsWith('TR:') || line.startsWith('TR:end')) {
+        return null;
+    }
+    const fields = line.slice(3).trim().split(',');
+    if (fields.length < 6) {
+        return null;
+    }
+    const core = Number(fields[0]);
+    const raw = Number(fields[1]);
+    if ((lastTs.get(core) ?? 0) > raw) {
+        wraps.set(core, (wraps.get(core) ?? 0) + 1);
+    }
+    lastTs.set(core, raw);
+    return {
+        name: fields[3],
+        ph: fields[2],
+        ts: raw + (wraps.get(core) ?? 0) * 2 ** 32,
+        pid: core,
+        tid: tid(fields.slice(5).join(',')),
+        args: { arg: Number(fields[4]) },
+    };
+}
+
+const rl = readline.createInterface({ input: process.stdin });
+
+rl.on('line', (line: string) => {
+    const event = parse(line);
+    if (event !== null) {
+        events.push(event);
+    }
+});
+
+rl.on('close', () => {
+    const names = [...new Set(events.map((e) => e.pid))].map((pid) => ({
+        name: 'process_name',
+        ph: 'M',
+        pid,
+        args: { name: `core ${pid}` },
+    }));
+    // A task seen on both cores gets the same tid in each process
+    const threads = [...new Set(events.map((e) => `${e.pid},${e.tid}`))].map((key) => {
+        const [pid, id] = key.split(',').map(Number);
+        return { name: 'thread_name', ph: 'M', pid, tid: id, args: { name: tasks[id] } };
+    });
+    console.log(JSON.stringify({ traceEvents: [...names, ...threads, ...events], displayTimeUnit: 'ms' }));
+});
@@ -0,0 +1,128 @@
+// Decodes the flash log dump sent by the "X" command into CSV.
+//
+//   node dist/tsdb-export.js [from] [to] < capture.txt > samples.csv
+//
+// from and to are epoch seconds and trim the output to exact rows; the
+// device only selects whole pages. Channel names and decimals are read from
+// main/hydro_channels.h.
+
+const fs = require('fs');
+const path = require('path');
+const readline = require('readline');
+
+export {};
+
+interface Page {
+    seq: number;
+    startS: number;
+    channels: number;
+    periodS: number;
+    rows: Uint8Array;
+}
+
+const mainDir = path.join(__dirname, '..', '..', 'main');
+const from = Number(process.argv[2] ?? 0);
+const to = Number(process.argv[3] ?? Infinity);
+
+const ROW = 0;
+const RUN = 1;
+const GAP = 2;
+
+// Channel names and scales in table order
+function loadChannels(): { name: string; scale: number }[] {
+    const channels: string = fs.readFileSync(path.join(mainDir, 'hydro_channels.h'), 'utf8');
+    const scales = new Map<string, number>();
+    const decimals = /X\(\s*(HYDRO_ROLE_\w+)\s*,\s*(\d+)\s*\)/g;
+    let m;
+    while ((m = decimals.exec(channels)) !== null) {
+        scales.set(m[1], 10 ** Number(m[2]));
+    }
+    const result: { name: string; scale: number }[] = [];
+    const row = /X\(\s*(\w+)\s*,\s*\d+\s*,\s*(HYDRO_ROLE_\w+)\s*,\s*\d+\s*\)/g;
+    while ((m = row.exec(channels)) !== null) {
+        result.push({ name: m[1], scale: scales.get(m[2]) ?? 1 });
+    }
+    return result;
+}
+
+function parsePage(hex: string): Page {
+    const bytes = Uint8Array.from(hex.match(/../g)!.map((b) => parseInt(b, 16)));
+    const view = new DataView(bytes.buffer);
+    const used = view.getUint16(12, true);
+    return {
+        seq: view.getUint32(0, true),
+        startS: view.getUint32(4, true),
+        channels: view.getUint8(14),
+        periodS: view.getUint8(15),
+        rows: bytes.subarray(20, 20 + used),
+    };
+}
+
+function* decodePage(page: Page): Generator<[number, number[]]> {
+    const rows = page.rows;
+    let pos = 0;
+    const varint = (): number => {
+        let value = 0;
+        let shift = 0;
+        let byte;
+        do {
+            byte = rows[pos++];
+            value += (byte & 0x7f) * 2 ** shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    };
+    const values = new Array(page.channels).fill(0);
+    let t = page.startS;
+    while (pos < rows.length) {
+        const h = varint();
+        const kind = h % 4;
+        const arg = Math.floor(h / 4);
+        if (kind === ROW) {
+            for (let ch = 0; ch < page.channels; ch++) {
+                if (arg & (1 << ch)) {
+                    const z = varint();
+                    values[ch] += z % 2 ? -(z + 1) / 2 : z / 2;
+                }
+            }
+            yield [t, [...values]];
+            t += page.periodS;
+        } else if (kind === RUN) {
+            for (let i = 0; i < arg; i++) {
+                yield [t, [...values]];
+                t += page.periodS;
+            }
+        } else if (kind === GAP) {
+            t += arg;
+        } else {
+            throw new Error(`page ${page.seq}: bad row kind ${kind}`);
+        }
+    }
+}
+
+const channels = loadChannels();
+const pages: Page[] = [];
+const rl = readline.createInterface({ input: process.stdin });
+
+rl.on('line', (line: string) => {
+    const match = /^X:([0-9a-f]+)\s*$/.exec(line);
+    if (match) {
+        pages.push(parsePage(match[1]));
+    }
+});
+
+rl.on('close', () => {
+    pages.sort((a, b) => a.seq - b.seq);
+    const count = pages.reduce((n, p) => Math.max(n, p.channels), 0);
+    const names = channels.slice(0, count).map((c) => c.name);
+    console.log(['time', ...names].join(','));
+    for (const page of pages) {
+        for (const [t, values] of decodePage(page)) {
+            if (t < from || t > to) {
+                continue;
+            }
+            const scaled = values.map((v, ch) => v / (channels[ch]?.scale ?? 1));
+            console.log([new Date(t * 1000).toISOString(), ...scaled].join(','));
+        }
+    }
+});
@@ -0,0 +1,108 @@
+#include "anomaly.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include "hydro_channels.h"
+
+typedef struct
+{
+    bool enabled;
+    float min;
+    float max;
+    float max_rate; // per second
+    float noise;    // least standard deviation of a step
+    uint32_t stuck_ms;
+} anomaly_policy_t;
+
+typedef struct
+{
+    bool started;
+    float good; // last sound reading, the reference of the next
+    int64_t good_us;
+    int n; // steps in mean and var, up to ANOMALY_WINDOW
+    float mean;
+    float var;
+    float same; // value held since same_us
+    int64_t same_us;
+    int strikes; // rate or outlier faults in a row
+} anomaly_state_t;
+
+static const anomaly_policy_t s_policies[HYDRO_ROLE_COUNT] = {
+#define ANOMALY_POLICY_ROW(role, min, max, max_rate, noise, stuck_ms) \
+    [role] = {true, min, max, max_rate, noise, stuck_ms},
+    ANOMALY_POLICY_TABLE(ANOMALY_POLICY_ROW)
+#undef ANOMALY_POLICY_ROW
+};
+
+static anomaly_state_t s_states[HYDRO_CHANNEL_COUNT];
+
+uint32_t anomaly_check(int ch, float value, int64_t now_us)
+{
+    const anomaly_policy_t *p = &s_policies[hydro_channels[ch].role];
+    anomaly_state_t *s = &s_states[ch];
+    uint32_t faults = 0;
+    if (!p->enabled)
+    {
+        return 0;
+    }
+
+    if (!(value >= p->min && value <= p->max))
+    {
+        faults |= ANOMALY_RANGE;
+    }
+    if (!s->started || value != s->same)
+    {
+        s->same = value;
+        s->same_us = now_us;
+    }
+    else if (p->stuck_ms && now_us - s->same_us >= p->stuck_ms * 1000LL)
+    {
+        faults |= ANOMALY_STUCK;
+    }
+    if (faults & ANOMALY_RANGE)
+    {
+        return faults; // not a reference for the next
+    }
+    if (!s->started)
+    {
+        s->started = true;
+        s->good = value;
+        s->good_us = now_us;
+        return faults;
+    }
+
+    float step = value - s->good;
+    if (fabsf(step) > p->max_rate * (now_us - s->good_us) / 1e6f)
+    {
+        faults |= ANOMALY_RATE;
+    }
+    if (s->n >= ANOMALY_WARMUP && fabsf(step - s->mean) > ANOMALY_Z_MAX * fmaxf(sqrtf(s->var), p->noise))
+    {
+        faults |= ANOMALY_OUTLIER;
+    }
+    if (faults & (ANOMALY_RATE | ANOMALY_OUTLIER))
+    {
+        if (++s->strikes < ANOMALY_ACCEPT)
+        {
+            return faults;
+        }
+        // Still there: a real change of level, not a spike
+        faults &= ~(ANOMALY_RATE | ANOMALY_OUTLIER);
+    }
+    else
+    {
+        s->n += s->n < ANOMALY_WINDOW;
+        float d = step - s->mean;
+        s->mean += d / s->n;
+        s->var += (d * (step - s->mean) - s->var) / s->n;
+    }
+    s->strikes = 0;
+    s->good = value;
+    s->good_us = now_us;
+    return faults;
+}
+
+void anomaly_reset(int ch)
+{
+    memset(&s_states[ch], 0, sizeof(s_states[ch]));
+}
@@ -0,0 +1,59 @@
+#ifndef ANOMALY_H
+#define ANOMALY_H
+
+#include <stdint.h>
+
+/*
+ * Fault detectors of the sensor readings, run by the sampling task before a
+ * reading is published. Pure C with no IDF dependencies, O(1) per reading.
+ *
+ * X(role, min, max, max_rate, noise, stuck_ms)
+ *
+ * - ANOMALY_RANGE: outside [min, max]. This catches a DS18B20 at its 85 C
+ *   power-on value.
+ * - ANOMALY_RATE: moved faster than max_rate per second since the last
+ *   sound reading.
+ * - ANOMALY_OUTLIER: the step from the last sound reading is more than
+ *   ANOMALY_Z_MAX standard deviations from the mean step. Mean and
+ *   variance are Welford's running ones over the sound readings, with the
+ *   count held at ANOMALY_WINDOW so they follow the sensor's noise as it
+ *   changes, and the deviation is at least noise.
+ * - ANOMALY_STUCK: the same value for stuck_ms. 0 turns it off; temperature
+ *   can hold one value for long in a large tank, while a live pH probe
+ *   moves by a few ADC counts. A steady tank can still read the same, so
+ *   this is only a warning, outside ANOMALY_DROP.
+ *
+ * After ANOMALY_ACCEPT rate or outlier faults in a row the reading is taken
+ * as a real change of level and becomes the new reference. The state of
+ * each channel is only touched by the task that samples it.
+ */
+#define ANOMALY_POLICY_TABLE(X)                                 \
+    X(HYDRO_ROLE_TEMPERATURE, 0.0f, 50.0f, 0.5f, 0.0625f, 0)    \
+    X(HYDRO_ROLE_PH, 0.5f, 13.5f, 0.2f, 0.02f, 600000)
+
+#define ANOMALY_Z_MAX 6.0f
+#define ANOMALY_WINDOW 128
+// Sound readings before the outlier test starts
+#define ANOMALY_WARMUP 16
+#define ANOMALY_ACCEPT 3
+
+enum
+{
+    ANOMALY_RANGE = 1 << 0,
+    ANOMALY_RATE = 1 << 1,
+    ANOMALY_OUTLIER = 1 << 2,
+    ANOMALY_STUCK = 1 << 3,
+};
+
+// Faults that make a reading unusable; the others are reported only
+#define ANOMALY_DROP (ANOMALY_RANGE | ANOMALY_RATE | ANOMALY_OUTLIER)
+
+// Faults of a channel's reading taken at now_us, 0 if it looks sound.
+// Roles without a policy are always sound.
+uint32_t anomaly_check(int ch, float value, int64_t now_us);
+
+// Forget a channel's readings, as a reboot does. For the host tools, which
+// run several traces through one process.
+void anomaly_reset(int ch);
+
+#endif // ANOMALY_H
@@ -0,0 +1,47 @@
+#include "capture.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include "hydro_channels.h"
+
+#define CAPTURE_NONE INT32_MIN
+
+static atomic_bool s_on;
+static void (*s_write_line)(const char *line, int len);
+// Last level sent of the on-change channels
+static int32_t s_last[HYDRO_CHANNEL_COUNT];
+
+void capture_init(void (*write_line)(const char *line, int len))
+{
+    s_write_line = write_line;
+    capture_set(false);
+}
+
+void capture_set(bool on)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        s_last[ch] = CAPTURE_NONE;
+    }
+    atomic_store(&s_on, on);
+}
+
+void capture_raw(int ch, int32_t raw, int64_t acquired_us)
+{
+    if (!atomic_load(&s_on))
+    {
+        return;
+    }
+    hydro_role_t role = hydro_channels[ch].role;
+    if (!HYDRO_ROLE_IS_ADC(role) && role != HYDRO_ROLE_TEMPERATURE)
+    {
+        if (raw == s_last[ch])
+        {
+            return;
+        }
+        s_last[ch] = raw;
+    }
+    char line[48];
+    int n = snprintf(line, sizeof(line), "W:%lu,%s,%ld\n", (unsigned long)(acquired_us / 1000),
+                     hydro_channels[ch].name, (long)raw);
+    s_write_line(line, n);
+}
@@ -0,0 +1,27 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Raw input capture for tools/replay. While on (CAPTURE verb), every raw
+ * sensor input goes out as "W:<ms>,<channel>,<raw>\n", with ms the
+ * acquisition time since boot and channel the HYDRO_CHANNEL_TABLE name:
+ *
+ *   pH, light       ADC counts
+ *   temperature     DS18B20 temperature register, 1/16 C
+ *   water level     0/1, on change
+ *   pumps, light    output level, on change
+ *
+ * Each channel is only captured by the task that samples or drives it.
+ */
+void capture_init(void (*write_line)(const char *line, int len));
+
+// Turning capture on sends the current level of every on-change channel
+// again with its next sample
+void capture_set(bool on);
+
+void capture_raw(int ch, int32_t raw, int64_t acquired_us);
+
+#endif // CAPTURE_H
@@ -0,0 +1,142 @@
+#include "cmd_proto.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CMD_LINE_MAX 128
+
+static const char *const s_result_names[] = {
+#define CMD_RESULT_NAME(name) #name,
+    CMD_RESULT_TABLE(CMD_RESULT_NAME)
+#undef CMD_RESULT_NAME
+};
+
+static const cmd_verb_t *s_verbs;
+static int s_verb_count;
+static void (*s_write_line)(const char *line, int len);
+
+// Request being received; only touched by the command task
+static char s_line[CMD_LINE_MAX];
+static int s_len;
+static bool s_overflow;
+
+void cmd_init(const cmd_verb_t *verbs, int count, void (*write_line)(const char *line, int len))
+{
+    s_verbs = verbs;
+    s_verb_count = count;
+    s_write_line = write_line;
+}
+
+static bool parse_arg(char type, char *token, cmd_arg_t *out)
+{
+    char *end;
+    switch (type)
+    {
+    case 'i':
+        out->i = strtol(token, &end, 10);
+        return *end == '\0';
+    case 'f':
+        out->f = strtof(token, &end);
+        return *end == '\0';
+    case 'c':
+        out->c = token[0];
+        return token[1] == '\0';
+    case 's':
+    case 'r':
+        out->s = token;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static cmd_result_t run(char *rest, char *reply, size_t len)
+{
+    char *save;
+    const char *verb = strtok_r(rest, " ", &save);
+    if (verb == NULL)
+    {
+        return CMD_UNKNOWN;
+    }
+    for (int v = 0; v < s_verb_count; v++)
+    {
+        if (strcmp(verb, s_verbs[v].verb) != 0)
+        {
+            continue;
+        }
+        cmd_arg_t args[CMD_MAX_ARGS];
+        int count = 0;
+        for (const char *type = s_verbs[v].args; *type; type++)
+        {
+            char *token = strtok_r(NULL, *type == 'r' ? "" : " ", &save);
+            if (token == NULL || count == CMD_MAX_ARGS || !parse_arg(*type, token, &args[count]))
+            {
+                return CMD_ARGS;
+            }
+            count++;
+        }
+        if (strtok_r(NULL, " ", &save) != NULL)
+        {
+            return CMD_ARGS;
+        }
+        return s_verbs[v].handler(args, reply, len);
+    }
+    return CMD_UNKNOWN;
+}
+
+// Runs the request in s_line and sends its reply
+static void execute(void)
+{
+    s_line[s_len] = '\0';
+    char *rest;
+    unsigned long seq = strtoul(s_line + 1, &rest, 10);
+    char value[48] = "";
+    cmd_result_t result = s_overflow ? CMD_TOO_LONG : run(rest, value, sizeof(value));
+
+    char line[CMD_LINE_MAX];
+    int n;
+    if (result == CMD_OK)
+    {
+        n = snprintf(line, sizeof(line), value[0] ? "#%lu OK %s\n" : "#%lu OK\n", seq, value);
+    }
+    else
+    {
+        n = snprintf(line, sizeof(line), "#%lu ERR %s\n", seq, s_result_names[result]);
+    }
+    s_write_line(line, n);
+}
+
+bool cmd_feed(const uint8_t *data, int len)
+{
+    if (s_len == 0 && data[0] != '#')
+    {
+        return false;
+    }
+    for (int i = 0; i < len; i++)
+    {
+        char c = data[i];
+        if (c == '\n' || c == '\r')
+        {
+            if (s_len > 0)
+            {
+                execute();
+            }
+            s_len = 0;
+            s_overflow = false;
+        }
+        else if (s_len == 0 && c != '#')
+        {
+            // Only whole requests are accepted after one in the same read
+            continue;
+        }
+        else if (s_len < CMD_LINE_MAX - 1)
+        {
+            s_line[s_len++] = c;
+        }
+        else
+        {
+            s_overflow = true;
+        }
+    }
+    return true;
+}
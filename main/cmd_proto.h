@@ -0,0 +1,65 @@
+#ifndef CMD_PROTO_H
+#define CMD_PROTO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sequenced command protocol, alongside the single-letter commands.
+ *
+ * A request is one line, "#<seq> <VERB> [args...]\n". seq is any number
+ * the host picks; it is echoed in the reply so several requests can be in
+ * flight at once. Requests run in the order received and each gets exactly
+ * one reply:
+ *
+ *   #<seq> OK [value]
+ *   #<seq> ERR <code>
+ *
+ * where code is a name from CMD_RESULT_TABLE. OK means the command was
+ * accepted; a dose, for example, runs after the reply.
+ *
+ * Each verb lists its arguments as a string of types: 'i' integer, 'f'
+ * float, 'c' one character, 's' one word, 'r' the rest of the line (last
+ * only). All arguments are required.
+ */
+#define CMD_RESULT_TABLE(X) \
+    X(OK)                   \
+    X(UNKNOWN)              \
+    X(ARGS)                 \
+    X(RANGE)                \
+    X(BUSY)                 \
+    X(TOO_LONG)
+
+typedef enum
+{
+#define CMD_RESULT_ENUM(name) CMD_##name,
+    CMD_RESULT_TABLE(CMD_RESULT_ENUM)
+#undef CMD_RESULT_ENUM
+} cmd_result_t;
+
+#define CMD_MAX_ARGS 4
+
+typedef union
+{
+    int32_t i;
+    float f;
+    char c;
+    const char *s;
+} cmd_arg_t;
+
+// Handlers may write a value for the OK reply into reply
+typedef struct
+{
+    const char *verb;
+    const char *args;
+    cmd_result_t (*handler)(const cmd_arg_t *args, char *reply, size_t len);
+} cmd_verb_t;
+
+void cmd_init(const cmd_verb_t *verbs, int count, void (*write_line)(const char *line, int len));
+
+// Feed bytes read from the UART. Returns false if they are not part of a
+// sequenced request, so they should be handled as a single-letter command.
+bool cmd_feed(const uint8_t *data, int len);
+
+#endif // CMD_PROTO_H
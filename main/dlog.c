@@ -0,0 +1,204 @@
+#include "dlog.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "task_topology.h"
+
+#define DLOG_RING_SIZE (CONFIG_HYDRO_DLOG_RING_ENTRIES)
+#define DLOG_RING_MASK (DLOG_RING_SIZE - 1)
+
+static_assert((DLOG_RING_SIZE & DLOG_RING_MASK) == 0, "CONFIG_HYDRO_DLOG_RING_ENTRIES must be a power of two");
+
+typedef struct
+{
+    uint16_t id;
+    uint8_t nargs;
+    int64_t timestamp_us;
+    uint32_t args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+typedef struct
+{
+    atomic_uint seq; // == position when free, position + 1 when filled
+    dlog_record_t rec;
+} dlog_entry_t;
+
+static const struct
+{
+    esp_log_level_t level;
+    const char *tag;
+    const char *format;
+} s_formats[DLOG_FORMAT_COUNT] = {
+#define DLOG_FORMAT_ROW(id, level, tag, format) [DLOG_##id] = {level, tag, format},
+    DLOG_FORMAT_TABLE(DLOG_FORMAT_ROW)
+#undef DLOG_FORMAT_ROW
+};
+
+static dlog_entry_t s_ring[DLOG_RING_SIZE];
+MEM_BUFFER_CHECK(DLOG_RING, s_ring);
+static atomic_uint s_head;
+static unsigned s_tail; // consumer only
+static atomic_uint s_dropped;
+static void (*s_emit)(const char *line, int len);
+
+// Bounded MPSC queue after D. Vyukov: a producer claims a position with a
+// CAS on the head, fills the slot, then publishes it through the slot's seq.
+void dlog_write(dlog_id_t id, const uint32_t *args, int nargs)
+{
+    unsigned pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+    dlog_entry_t *entry;
+
+    for (;;)
+    {
+        entry = &s_ring[pos & DLOG_RING_MASK];
+        int dif = (int)(atomic_load_explicit(&entry->seq, memory_order_acquire) - pos);
+        if (dif == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&s_head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+        }
+    }
+
+    if (nargs > DLOG_MAX_ARGS)
+    {
+        nargs = DLOG_MAX_ARGS;
+    }
+    entry->rec.id = id;
+    entry->rec.nargs = nargs;
+    entry->rec.timestamp_us = esp_timer_get_time();
+    for (int i = 0; i < nargs; i++)
+    {
+        entry->rec.args[i] = args[i];
+    }
+    atomic_store_explicit(&entry->seq, pos + 1, memory_order_release);
+}
+
+uint32_t dlog_dropped(void)
+{
+    return atomic_load(&s_dropped);
+}
+
+#if !CONFIG_HYDRO_DLOG_HOST_DECODE
+// printf the format one conversion at a time, taking each argument as an int
+// or a float depending on its conversion character.
+static void dlog_format(const dlog_record_t *rec, char *out, size_t len)
+{
+    const char *f = s_formats[rec->id].format;
+    size_t pos = 0;
+    int arg = 0;
+
+    while (*f && pos + 1 < len)
+    {
+        if (*f != '%')
+        {
+            out[pos++] = *f++;
+            continue;
+        }
+        if (f[1] == '%')
+        {
+            out[pos++] = '%';
+            f += 2;
+            continue;
+        }
+
+        char spec[16];
+        size_t n = 0;
+        do
+        {
+            spec[n++] = *f++;
+        } while (*f && n < sizeof(spec) - 2 && !strchr("diuxXcfeEgG", *f));
+        char conv = *f ? *f++ : 'd';
+        spec[n++] = conv;
+        spec[n] = '\0';
+
+        uint32_t raw = arg < rec->nargs ? rec->args[arg] : 0;
+        arg++;
+        int written;
+        if (strchr("feEgG", conv))
+        {
+            float value;
+            memcpy(&value, &raw, sizeof(value));
+            written = snprintf(out + pos, len - pos, spec, (double)value);
+        }
+        else
+        {
+            written = snprintf(out + pos, len - pos, spec, (int)raw);
+        }
+        if (written > 0)
+        {
+            pos += (size_t)written < len - pos ? (size_t)written : len - pos - 1;
+        }
+    }
+    out[pos] = '\0';
+}
+#endif
+
+static void dlog_output(const dlog_record_t *rec)
+{
+#if CONFIG_HYDRO_DLOG_HOST_DECODE
+    char line[80];
+    int n = snprintf(line, sizeof(line), "G:%u,%lld", rec->id, (long long)rec->timestamp_us);
+    for (int i = 0; i < rec->nargs; i++)
+    {
+        n += snprintf(line + n, sizeof(line) - n, ",%lx", (unsigned long)rec->args[i]);
+    }
+    n += snprintf(line + n, sizeof(line) - n, "\n");
+    s_emit(line, n);
+#else
+    char text[128];
+    dlog_format(rec, text, sizeof(text));
+    ESP_LOG_LEVEL(s_formats[rec->id].level, s_formats[rec->id].tag, "[%lld] %s",
+                  (long long)rec->timestamp_us, text);
+#endif
+}
+
+static void dlog_task(void *arg)
+{
+    uint32_t reported_drops = 0;
+    while (1)
+    {
+        dlog_entry_t *entry = &s_ring[s_tail & DLOG_RING_MASK];
+        if (atomic_load_explicit(&entry->seq, memory_order_acquire) != s_tail + 1)
+        {
+            uint32_t drops = dlog_dropped();
+            if (drops != reported_drops)
+            {
+                ESP_LOGW("dlog", "%lu messages dropped", (unsigned long)(drops - reported_drops));
+                reported_drops = drops;
+            }
+            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
+        }
+
+        dlog_record_t rec = entry->rec;
+        atomic_store_explicit(&entry->seq, s_tail + DLOG_RING_SIZE, memory_order_release);
+        s_tail++;
+        dlog_output(&rec);
+    }
+}
+
+void dlog_start(void (*emit)(const char *line, int len))
+{
+    for (unsigned i = 0; i < DLOG_RING_SIZE; i++)
+    {
+        atomic_init(&s_ring[i].seq, i);
+    }
+    s_emit = emit;
+    topo_create_task(dlog_task, "dlog", MEM_TASK_DLOG, NULL, TOPO_CLASS_BACKGROUND, NULL);
+}
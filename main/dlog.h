@@ -0,0 +1,48 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+#include "dlog_formats.h"
+
+/*
+ * Deferred binary logging. DLOG() stores a message id, a timestamp and the
+ * raw arguments in a lock-free ring; the dlog task formats them later at
+ * background priority. Producers never block and never format: when the
+ * ring is full the message is dropped and counted.
+ *
+ *     DLOG(TEMP_READ, i, dlog_f(temperature));
+ */
+#define DLOG_MAX_ARGS 4
+
+typedef enum
+{
+#define DLOG_FORMAT_ENUM(id, level, tag, format) DLOG_##id,
+    DLOG_FORMAT_TABLE(DLOG_FORMAT_ENUM)
+#undef DLOG_FORMAT_ENUM
+    DLOG_FORMAT_COUNT,
+} dlog_id_t;
+
+// Float arguments are passed as their bit pattern
+static inline uint32_t dlog_f(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+#define DLOG(id, ...)                                                          \
+    dlog_write(DLOG_##id, (const uint32_t[]){0, ##__VA_ARGS__} + 1,            \
+               sizeof((const uint32_t[]){0, ##__VA_ARGS__}) / sizeof(uint32_t) - 1)
+
+void dlog_write(dlog_id_t id, const uint32_t *args, int nargs);
+
+// Start the decoder task. With CONFIG_HYDRO_DLOG_HOST_DECODE, raw records are
+// handed to emit as "G:" lines instead of being formatted on the device.
+void dlog_start(void (*emit)(const char *line, int len));
+
+// Messages lost because the ring was full
+uint32_t dlog_dropped(void);
+
+#endif // DLOG_H
@@ -0,0 +1,22 @@
+#ifndef DLOG_FORMATS_H
+#define DLOG_FORMATS_H
+
+/*
+ * Deferred log messages. Ids are assigned in table order and are part of the
+ * "G:" wire format read by interface/dlog-decode.ts, so only append rows.
+ *
+ * X(id, level, tag, format)
+ *
+ * Formats take up to DLOG_MAX_ARGS integer (%d %u %x %c) or float (%f %e %g)
+ * conversions.
+ */
+#define DLOG_FORMAT_TABLE(X)                                                            \
+    X(TEMP_READ, ESP_LOG_INFO, "DS18B20", "Temperature read from DS18B20[%d]: %.2fC")   \
+    X(TEMP_MISSING, ESP_LOG_ERROR, "DS18B20", "No DS18B20 device found")                \
+    X(MOTOR_READY, ESP_LOG_INFO, "Motor", "Dispensing channel %d")                      \
+    X(MOTOR_ACTIVATE, ESP_LOG_INFO, "Motor", "Activating channel %d")                   \
+    X(DOSE_LIMIT, ESP_LOG_WARN, "Motor", "Channel %d: %.1f ml over limit, %.1f left")   \
+    X(FLOW_SHORT, ESP_LOG_WARN, "Motor", "Channel %d: metered %.1f of %.1f ml")         \
+    X(SENSOR_FAULT, ESP_LOG_WARN, "Sensor", "Channel %d: faults %d at %.2f")
+
+#endif // DLOG_FORMATS_H
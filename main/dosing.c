@@ -0,0 +1,382 @@
+#include "dosing.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "dlog.h"
+#include "hydro_channels.h"
+#include "hydro_io.h"
+#include "mem_budget.h"
+#include "params.h"
+
+#define DOSING_NAMESPACE "dosing"
+
+#if CONFIG_HYDRO_DOSING_ONE_SUPPLY
+#define DOSING_SUPPLY_COUNT 1
+#define DOSING_SUPPLY(ch) 0
+#else
+#define DOSING_SUPPLY_COUNT HYDRO_TANK_COUNT
+#define DOSING_SUPPLY(ch) (hydro_channels[ch].tank)
+#endif
+
+// How often a pulse checks whether to stop, and the flow meter
+#define DOSING_PULSE_POLL_MS 10
+#define DOSING_SAVE_DELAY_US (CONFIG_HYDRO_DOSING_SAVE_DELAY_MS * 1000LL)
+
+typedef struct
+{
+    float ml_s;
+    float total_ml;
+    float left_ml; // of the hourly limit, as of left_us
+    int64_t left_us;
+    bool limited; // the last dose was refused
+    bool unsaved; // total, and a flow meter's calibration, not in NVS yet
+} dosing_pump_t;
+
+static const char *TAG = "dosing";
+
+// Guarded by s_lock: each pump is dosed by its dispense task, and calibrated
+// and listed by the command task
+static dosing_pump_t s_pumps[HYDRO_CHANNEL_COUNT];
+MEM_BUFFER_CHECK(DOSING, s_pumps);
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_buf;
+static int64_t s_unsaved_us; // when the oldest unsaved change was made, 0 if none
+
+static SemaphoreHandle_t s_supply[DOSING_SUPPLY_COUNT];
+static StaticSemaphore_t s_supply_buf[DOSING_SUPPLY_COUNT];
+static void (*s_write_line)(const char *line, int len);
+
+static uint32_t float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Calibration "c<ch>" or total "t<ch>" of a pump, as float bits like the
+// FLOAT parameters
+static esp_err_t set_key(nvs_handle_t nvs, char kind, int ch, float value)
+{
+    char key[8];
+    snprintf(key, sizeof(key), "%c%d", kind, ch);
+    return nvs_set_u32(nvs, key, float_bits(value));
+}
+
+static void save_calibration(int ch, float ml_s)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(DOSING_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        err = set_key(nvs, 'c', ch, ml_s);
+        err = err == ESP_OK ? nvs_commit(nvs) : err;
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "%s not saved: %s", hydro_channels[ch].name, esp_err_to_name(err));
+    }
+}
+
+// Mark a pump's total for the next dosing_save(). Call with s_lock held.
+static void mark_unsaved(dosing_pump_t *p)
+{
+    p->unsaved = true;
+    if (s_unsaved_us == 0)
+    {
+        s_unsaved_us = esp_timer_get_time();
+    }
+}
+
+static void load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(DOSING_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return; // nothing saved yet
+    }
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        char key[8];
+        uint32_t bits;
+        float value;
+        snprintf(key, sizeof(key), "c%d", ch);
+        if (nvs_get_u32(nvs, key, &bits) == ESP_OK)
+        {
+            memcpy(&value, &bits, sizeof(value));
+            s_pumps[ch].ml_s = value >= DOSING_ML_S_MIN && value <= DOSING_ML_S_MAX ? value : DOSING_DEFAULT_ML_S;
+        }
+        snprintf(key, sizeof(key), "t%d", ch);
+        if (nvs_get_u32(nvs, key, &bits) == ESP_OK)
+        {
+            memcpy(&s_pumps[ch].total_ml, &bits, sizeof(float));
+        }
+    }
+    nvs_close(nvs);
+}
+
+// What is left of the hourly limit at now_us. Call with s_lock held.
+static float left_ml(dosing_pump_t *p, int64_t now_us)
+{
+    float limit = param_float(PARAM_PUMP_ML_HOUR);
+    p->left_ml = fminf(limit, p->left_ml + limit * (now_us - p->left_us) / 3600e6f);
+    p->left_us = now_us;
+    return p->left_ml;
+}
+
+// One pulse with the pump's supply taken, adding the ml it pumped to *ml.
+// Returns false if stop(ch) ended it early or kept it from starting.
+static bool pulse(int ch, uint32_t ms, float ml_s, void (*set_pump)(int ch, int level), bool (*stop)(int ch),
+                  float *ml_out)
+{
+    SemaphoreHandle_t supply = s_supply[DOSING_SUPPLY(ch)];
+    xSemaphoreTake(supply, portMAX_DELAY);
+    if (stop(ch))
+    {
+        xSemaphoreGive(supply);
+        return false;
+    }
+    bool stopped = false;
+#if CONFIG_HYDRO_FLOW_METER
+    float want = ml_s * ms / 1000;
+    float ml = 0;
+    int start = io_flow_count();
+    int64_t on_us = esp_timer_get_time();
+    set_pump(ch, 1);
+    while (ml < want && esp_timer_get_time() - on_us < 2000LL * ms && !(stopped = stop(ch)))
+    {
+        vTaskDelay(DOSING_PULSE_POLL_MS / portTICK_PERIOD_MS);
+        ml = (io_flow_count() - start) * 1000.0f / CONFIG_HYDRO_FLOW_METER_PULSES_PER_L;
+    }
+    set_pump(ch, 0);
+    float on_s = (esp_timer_get_time() - on_us) / 1e6f;
+    xSemaphoreGive(supply);
+    *ml_out += ml;
+
+    if (stopped)
+    {
+        // Cut short on purpose: neither a dry supply nor a measure of the flow
+    }
+    else if (ml < want)
+    {
+        DLOG(FLOW_SHORT, ch, dlog_f(ml), dlog_f(want));
+    }
+    else
+    {
+        // A slow correction, so one odd pulse does not throw it off
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        float measured = fminf(fmaxf(ml / on_s, DOSING_ML_S_MIN), DOSING_ML_S_MAX);
+        s_pumps[ch].ml_s += (measured - s_pumps[ch].ml_s) / 4;
+        xSemaphoreGive(s_lock);
+    }
+#else
+    int64_t on_us = esp_timer_get_time();
+    set_pump(ch, 1);
+    while (esp_timer_get_time() - on_us < 1000LL * ms && !(stopped = stop(ch)))
+    {
+        vTaskDelay(DOSING_PULSE_POLL_MS / portTICK_PERIOD_MS);
+    }
+    set_pump(ch, 0);
+    float on_s = (esp_timer_get_time() - on_us) / 1e6f;
+    xSemaphoreGive(supply);
+    *ml_out += ml_s * on_s;
+#endif
+    return !stopped;
+}
+
+void dosing_init(void (*write_line)(const char *line, int len))
+{
+    s_write_line = write_line;
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    for (int i = 0; i < DOSING_SUPPLY_COUNT; i++)
+    {
+        s_supply[i] = xSemaphoreCreateMutexStatic(&s_supply_buf[i]);
+    }
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        s_pumps[ch].ml_s = DOSING_DEFAULT_ML_S;
+        s_pumps[ch].left_ml = INFINITY; // full once the limit applies
+    }
+    load();
+#if CONFIG_HYDRO_FLOW_METER
+    io_flow_init();
+#endif
+}
+
+bool dosing_run(int ch, uint32_t ms, void (*set_pump)(int ch, int level), bool (*stop)(int ch))
+{
+    dosing_pump_t *p = &s_pumps[ch];
+    char line[64];
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    float ml_s = p->ml_s;
+    float ml = ml_s * ms / 1000;
+    float left = left_ml(p, esp_timer_get_time());
+    bool refused = ml > left;
+    bool report = refused && !p->limited;
+    p->limited = refused;
+    p->left_ml -= refused ? 0 : ml;
+    xSemaphoreGive(s_lock);
+
+    if (refused)
+    {
+        // Once until a dose fits again, auto_PH asks every check
+        if (report)
+        {
+            DLOG(DOSE_LIMIT, ch, dlog_f(ml), dlog_f(left));
+            int n = snprintf(line, sizeof(line), "V:%s LIMIT %.1f\n", hydro_channels[ch].name, left);
+            s_write_line(line, n);
+        }
+        return false;
+    }
+
+    uint32_t count = dosing_pulse_count(ms);
+    float pumped = 0;
+    bool stopped = false;
+    for (uint32_t i = 0; i < count && !stopped; i++)
+    {
+        if (i > 0)
+        {
+            vTaskDelay(DOSING_REST_MS / portTICK_PERIOD_MS);
+        }
+        stopped = !pulse(ch, dosing_pulse_ms(ms, i), ml_s, set_pump, stop, &pumped);
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    p->total_ml += pumped;
+    p->left_ml += ml - pumped; // what a flow meter measured counts
+    float total_ml = p->total_ml;
+    mark_unsaved(p);
+    xSemaphoreGive(s_lock);
+
+    int n = snprintf(line, sizeof(line), "V:%s %.1f %.1f%s\n", hydro_channels[ch].name, pumped, total_ml,
+                     stopped ? " STOPPED" : "");
+    s_write_line(line, n);
+    return true;
+}
+
+uint32_t dosing_ms(int ch, float ml)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    float ms = ml * 1000 / s_pumps[ch].ml_s;
+    xSemaphoreGive(s_lock);
+    return ms <= DOSING_MS_MAX ? (uint32_t)lroundf(ms) : 0;
+}
+
+void dosing_calibrate(int ch, float ml_s)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_pumps[ch].ml_s = ml_s;
+    xSemaphoreGive(s_lock);
+    save_calibration(ch, ml_s);
+}
+
+void dosing_reset_total(int ch)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_pumps[ch].total_ml = 0;
+    mark_unsaved(&s_pumps[ch]);
+    xSemaphoreGive(s_lock);
+    dosing_save();
+}
+
+void dosing_save(void)
+{
+    bool unsaved[HYDRO_CHANNEL_COUNT];
+    float total_ml[HYDRO_CHANNEL_COUNT];
+#if CONFIG_HYDRO_FLOW_METER
+    float ml_s[HYDRO_CHANNEL_COUNT]; // corrected by the meter
+#endif
+    int count = 0;
+
+    // Taken off the pumps first, so a dose ending meanwhile is saved next time
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        unsaved[ch] = s_pumps[ch].unsaved;
+        total_ml[ch] = s_pumps[ch].total_ml;
+#if CONFIG_HYDRO_FLOW_METER
+        ml_s[ch] = s_pumps[ch].ml_s;
+#endif
+        s_pumps[ch].unsaved = false;
+        count += unsaved[ch];
+    }
+    s_unsaved_us = 0;
+    xSemaphoreGive(s_lock);
+    if (count == 0)
+    {
+        return;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(DOSING_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        for (int ch = 0; ch < HYDRO_CHANNEL_COUNT && err == ESP_OK; ch++)
+        {
+            if (unsaved[ch])
+            {
+                err = set_key(nvs, 't', ch, total_ml[ch]);
+#if CONFIG_HYDRO_FLOW_METER
+                err = err == ESP_OK ? set_key(nvs, 'c', ch, ml_s[ch]) : err;
+#endif
+            }
+        }
+        err = err == ESP_OK ? nvs_commit(nvs) : err;
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        // Retry after another delay rather than on every poll
+        ESP_LOGE(TAG, "totals not saved: %s", esp_err_to_name(err));
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+        {
+            if (unsaved[ch])
+            {
+                mark_unsaved(&s_pumps[ch]);
+            }
+        }
+        xSemaphoreGive(s_lock);
+    }
+}
+
+void dosing_poll(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool due = s_unsaved_us != 0 && esp_timer_get_time() - s_unsaved_us >= DOSING_SAVE_DELAY_US;
+    xSemaphoreGive(s_lock);
+    if (due)
+    {
+        dosing_save();
+    }
+}
+
+int dosing_list(void (*write_line)(const char *line, int len))
+{
+    int count = 0;
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (!HYDRO_ROLE_IS_PUMP(hydro_channels[ch].role))
+        {
+            continue;
+        }
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        dosing_pump_t p = s_pumps[ch];
+        float left = left_ml(&s_pumps[ch], esp_timer_get_time());
+        xSemaphoreGive(s_lock);
+
+        char line[64];
+        int n = snprintf(line, sizeof(line), "O:%s %.3f %.1f %.1f\n", hydro_channels[ch].name, p.ml_s, p.total_ml,
+                         left);
+        write_line(line, n);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,78 @@
+#ifndef DOSING_H
+#define DOSING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/*
+ * Dosing planner behind the dispense tasks. A dose, given as a pulse length
+ * (DOSE, U/D/F, auto_PH, rules) or in ml (DOSEML), runs as a train of
+ * pulses of at most DOSING_PULSE_MS with DOSING_REST_MS between them:
+ *
+ * - Calibration: each pump has a flow in ml/s (CAL, default
+ *   DOSING_DEFAULT_ML_S) that converts between ml and pulse length.
+ * - Supplies: pumps on one supply run one at a time. The pumps of a tank
+ *   share its supply, or every pump shares one with
+ *   CONFIG_HYDRO_DOSING_ONE_SUPPLY. The supply is taken for each pulse, so a
+ *   long dose does not hold up the other pumps until it ends.
+ * - Limits: each pump may pump at most the pump_ml_h parameter in any hour,
+ *   as a bucket that refills at that rate. A dose that does not fit is
+ *   refused whole and sent as "V:<channel> LIMIT <ml left>".
+ * - Use: each dose is sent as "V:<channel> <ml> <total ml>", with " STOPPED"
+ *   after a dose stopped early. Totals and calibrations are kept in NVS;
+ *   USAGE lists them. A calibration is written when set, totals together,
+ *   CONFIG_HYDRO_DOSING_SAVE_DELAY_MS after the first dose since the last
+ *   save, so a dose does not cost a flash write.
+ * - Flow meter: with CONFIG_HYDRO_FLOW_METER, a meter on the one supply
+ *   (hydro_io.h) ends each pulse once it counted the pulse's volume, or at
+ *   twice its calibrated length, and the measured flow corrects the pump's
+ *   calibration.
+ */
+#define DOSING_PULSE_MS 2000
+#define DOSING_REST_MS 500
+#define DOSING_DEFAULT_ML_S 1.5f
+#define DOSING_ML_S_MIN 0.01f
+#define DOSING_ML_S_MAX 100.0f
+// Longest dose DOSEML plans
+#define DOSING_MS_MAX 600000
+// How often a dispense task looks for a request
+#define DOSING_POLL_MS 100
+
+// Pulses of a dose of ms: even ones, the first takes the remainder
+static inline uint32_t dosing_pulse_count(uint32_t ms)
+{
+    return (ms + DOSING_PULSE_MS - 1) / DOSING_PULSE_MS;
+}
+
+static inline uint32_t dosing_pulse_ms(uint32_t ms, uint32_t pulse)
+{
+    uint32_t count = dosing_pulse_count(ms);
+    return ms / count + (pulse == 0 ? ms % count : 0);
+}
+
+// Load calibrations and totals. Call after params_init(), which opens NVS.
+void dosing_init(void (*write_line)(const char *line, int len));
+
+// Runs a dose of ms on a pump channel, switching it with set_pump. The dose
+// stops early, within a pulse or before the next, once stop(ch) is true;
+// only what was pumped counts. Returns false if the hourly limit refused it.
+bool dosing_run(int ch, uint32_t ms, void (*set_pump)(int ch, int level), bool (*stop)(int ch));
+
+// Pulse length that pumps ml, 0 if over DOSING_MS_MAX
+uint32_t dosing_ms(int ch, float ml);
+
+void dosing_calibrate(int ch, float ml_s);
+void dosing_reset_total(int ch);
+
+// Called periodically by the command task; saves totals once they are due
+void dosing_poll(void);
+
+// Save pending totals now
+void dosing_save(void);
+
+// One "O:<channel> <ml/s> <total ml> <ml left this hour>" line per pump.
+// Returns the number of pumps.
+int dosing_list(void (*write_line)(const char *line, int len));
+
+#endif // DOSING_H
@@ -0,0 +1,114 @@
+#include "gorilla.h"
+
+// Widths of the four non-zero classes of each prefix code
+static const uint8_t s_ts_widths[4] = {3, 7, 12, 32};
+static const uint8_t s_value_widths[4] = {4, 8, 16, 32};
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static void put_le(uint8_t *out, uint32_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out[i] = v >> (8 * i);
+    }
+}
+
+// MSB first. Bytes past the header are cleared as the writer reaches them.
+static void put_bits(gorilla_block_t *b, uint32_t v, int n)
+{
+    while (n > 0)
+    {
+        size_t byte = b->bits / 8;
+        int free = 8 - b->bits % 8;
+        int take = n < free ? n : free;
+        uint32_t chunk = (v >> (n - take)) & ((1u << take) - 1);
+        if (free == 8)
+        {
+            b->buf[byte] = 0;
+        }
+        b->buf[byte] |= chunk << (free - take);
+        b->bits += take;
+        n -= take;
+    }
+}
+
+// Bits needed for v with the prefix code of widths
+static int code_bits(uint32_t v, const uint8_t *widths)
+{
+    if (v == 0)
+    {
+        return 1;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if (v >> widths[i] == 0)
+        {
+            return i + 2 + widths[i];
+        }
+    }
+    return 4 + widths[3];
+}
+
+static void put_code(gorilla_block_t *b, uint32_t v, const uint8_t *widths)
+{
+    if (v == 0)
+    {
+        put_bits(b, 0, 1);
+        return;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if (v >> widths[i] == 0)
+        {
+            put_bits(b, ((1u << (i + 1)) - 1) << 1, i + 2); // i+1 ones, then a zero
+            put_bits(b, v, widths[i]);
+            return;
+        }
+    }
+    put_bits(b, 0xf, 4);
+    put_bits(b, v, widths[3]);
+}
+
+void gorilla_begin(gorilla_block_t *b, uint8_t *buf, size_t cap, uint8_t decimals, uint32_t ms, int32_t value)
+{
+    b->buf = buf;
+    b->cap = cap;
+    b->bits = GORILLA_HEADER_BYTES * 8;
+    b->count = 1;
+    b->last_ms = ms;
+    b->last_delta_ms = 0;
+    b->last_value = value;
+    buf[0] = decimals;
+    put_le(&buf[1], ms, 4);
+    put_le(&buf[5], (uint32_t)value, 4);
+}
+
+bool gorilla_append(gorilla_block_t *b, uint32_t ms, int32_t value)
+{
+    int32_t delta = (int32_t)(ms - b->last_ms);
+    uint32_t dod = zigzag(delta - b->last_delta_ms);
+    uint32_t dv = zigzag(value - b->last_value);
+
+    if (b->count == UINT16_MAX ||
+        b->bits + code_bits(dod, s_ts_widths) + code_bits(dv, s_value_widths) > b->cap * 8)
+    {
+        return false;
+    }
+    put_code(b, dod, s_ts_widths);
+    put_code(b, dv, s_value_widths);
+    b->last_ms = ms;
+    b->last_delta_ms = delta;
+    b->last_value = value;
+    b->count++;
+    return true;
+}
+
+size_t gorilla_finish(gorilla_block_t *b)
+{
+    put_le(&b->buf[9], b->count, 2);
+    return (b->bits + 7) / 8;
+}
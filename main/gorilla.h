@@ -0,0 +1,45 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Block codec for one channel's samples, after Facebook's Gorilla: each
+ * timestamp is stored as the zigzag delta of its delta, each fixed-point
+ * value as the zigzag delta from the previous value, both with a short
+ * prefix code for the width:
+ *
+ *   timestamp   0 | 10 + 3 bits | 110 + 7 | 1110 + 12 | 1111 + 32
+ *   value       0 | 10 + 4 bits | 110 + 8 | 1110 + 16 | 1111 + 32
+ *
+ * A block starts with a header (decimals, first timestamp in ms and first
+ * value, little-endian, then the sample count) and decodes on its own.
+ * Pure C with no IDF dependencies, so tools/gorilla_bench builds it on the
+ * host. The decoder is interface/gorilla.ts.
+ */
+#define GORILLA_HEADER_BYTES 11
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t cap;
+    size_t bits; // written so far, header included
+    uint16_t count;
+    uint32_t last_ms;
+    int32_t last_delta_ms;
+    int32_t last_value;
+} gorilla_block_t;
+
+// Start a block in buf holding its first sample
+void gorilla_begin(gorilla_block_t *b, uint8_t *buf, size_t cap, uint8_t decimals, uint32_t ms, int32_t value);
+
+// Append a sample. Returns false, leaving the block unchanged, if it does
+// not fit.
+bool gorilla_append(gorilla_block_t *b, uint32_t ms, int32_t value);
+
+// Patch the sample count into the header. Returns the block size in bytes.
+size_t gorilla_finish(gorilla_block_t *b);
+
+#endif // GORILLA_H
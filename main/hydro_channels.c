@@ -0,0 +1,117 @@
+#include "hydro_channels.h"
+#include <assert.h>
+#include <math.h>
+
+// Telemetry prefixes, pasted together from the role and tank in each row.
+#define HYDRO_TAG_HYDRO_ROLE_TEMPERATURE "T"
+#define HYDRO_TAG_HYDRO_ROLE_PH "PH"
+#define HYDRO_TAG_HYDRO_ROLE_WATER_LEVEL "WL"
+#define HYDRO_TAG_HYDRO_ROLE_LIGHT "L"
+#define HYDRO_TAG_HYDRO_ROLE_PH_UP "PU"
+#define HYDRO_TAG_HYDRO_ROLE_PH_DOWN "PD"
+#define HYDRO_TAG_HYDRO_ROLE_PLANT_FOOD "PF"
+#define HYDRO_TAG_HYDRO_ROLE_GROW_LIGHT "GL"
+
+#define HYDRO_TANK_SUFFIX_0 ""
+#define HYDRO_TANK_SUFFIX_1 "1"
+
+// ADC1 channel -> GPIO pad. The linux target simulates an ESP32.
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_LINUX
+#define HYDRO_ADC1_GPIO(ch) ((ch) < 4 ? 36 + (ch) : 28 + (ch))
+#else
+#error "hydro_channels: ADC1 pad map is only defined for the ESP32"
+#endif
+
+#define HYDRO_CHANNEL_GPIO(role, io) (HYDRO_ROLE_IS_ADC(role) ? HYDRO_ADC1_GPIO(io) : (io))
+
+const hydro_channel_t hydro_channels[HYDRO_CHANNEL_COUNT] = {
+#define HYDRO_CHANNEL_ROW(name, tank, role, io) \
+    [HYDRO_CH_##name] = {#name, tank, role, io},
+    HYDRO_CHANNEL_TABLE(HYDRO_CHANNEL_ROW)
+#undef HYDRO_CHANNEL_ROW
+};
+
+static const char *const s_tags[HYDRO_CHANNEL_COUNT] = {
+#define HYDRO_CHANNEL_TAG(name, tank, role, io) \
+    [HYDRO_CH_##name] = HYDRO_TAG_##role HYDRO_TANK_SUFFIX_##tank,
+    HYDRO_CHANNEL_TABLE(HYDRO_CHANNEL_TAG)
+#undef HYDRO_CHANNEL_TAG
+};
+
+static const uint8_t s_decimals[HYDRO_ROLE_COUNT] = {
+#define HYDRO_ROLE_DECIMALS(role, decimals) [role] = decimals,
+    HYDRO_ROLE_DECIMALS_TABLE(HYDRO_ROLE_DECIMALS)
+#undef HYDRO_ROLE_DECIMALS
+};
+
+static const float s_pow10[] = {1, 10, 100, 1000};
+
+/*
+ * Build-time checks on the table. Each check sums one bit per row and
+ * compares against the OR of the same bits: any duplicate makes the sum carry
+ * into a different value.
+ */
+#define HYDRO_PIN_BIT(role, io) (1ULL << HYDRO_CHANNEL_GPIO(role, io))
+#define HYDRO_PIN_SUM(name, tank, role, io) +HYDRO_PIN_BIT(role, io)
+#define HYDRO_PIN_OR(name, tank, role, io) | HYDRO_PIN_BIT(role, io)
+
+static_assert((0 HYDRO_CHANNEL_TABLE(HYDRO_PIN_SUM)) == (0 HYDRO_CHANNEL_TABLE(HYDRO_PIN_OR)),
+              "two channels in HYDRO_CHANNEL_TABLE share a GPIO");
+#if CONFIG_HYDRO_TRANSPORT_UART
+#if CONFIG_HYDRO_UART_FLOW_CTRL
+#define HYDRO_UART_FLOW_PINS ((1ULL << CONFIG_HYDRO_UART_RTS) | (1ULL << CONFIG_HYDRO_UART_CTS))
+#else
+#define HYDRO_UART_FLOW_PINS 0
+#endif
+#define HYDRO_UART_PINS ((1ULL << CONFIG_EXAMPLE_UART_TXD) | (1ULL << CONFIG_EXAMPLE_UART_RXD) | HYDRO_UART_FLOW_PINS)
+static_assert(((0 HYDRO_CHANNEL_TABLE(HYDRO_PIN_OR)) & HYDRO_UART_PINS) == 0,
+              "a channel in HYDRO_CHANNEL_TABLE uses a UART pin");
+#endif
+#if CONFIG_HYDRO_FLOW_METER
+static_assert(((0 HYDRO_CHANNEL_TABLE(HYDRO_PIN_OR)) & (1ULL << CONFIG_HYDRO_FLOW_METER_GPIO)) == 0,
+              "a channel in HYDRO_CHANNEL_TABLE uses the flow meter GPIO");
+#endif
+
+#define HYDRO_SLOT_BIT(tank, role) (1ULL << ((tank) * HYDRO_ROLE_COUNT + (role)))
+#define HYDRO_SLOT_SUM(name, tank, role, io) +HYDRO_SLOT_BIT(tank, role)
+#define HYDRO_SLOT_OR(name, tank, role, io) | HYDRO_SLOT_BIT(tank, role)
+#define HYDRO_TANK_RANGE(name, tank, role, io) &&(tank) < HYDRO_TANK_COUNT
+
+static_assert(HYDRO_TANK_COUNT * HYDRO_ROLE_COUNT <= 64, "too many tanks for the table checks");
+static_assert(1 HYDRO_CHANNEL_TABLE(HYDRO_TANK_RANGE), "channel table row uses a tank beyond HYDRO_TANK_COUNT");
+static_assert((0 HYDRO_CHANNEL_TABLE(HYDRO_SLOT_SUM)) == (0 HYDRO_CHANNEL_TABLE(HYDRO_SLOT_OR)),
+              "a tank lists the same role twice in HYDRO_CHANNEL_TABLE");
+static_assert(HYDRO_CHANNEL_COUNT == HYDRO_TANK_COUNT * HYDRO_ROLE_COUNT,
+              "every tank must list every role in HYDRO_CHANNEL_TABLE");
+
+int hydro_channel_find(int tank, hydro_role_t role)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (hydro_channels[ch].tank == tank && hydro_channels[ch].role == role)
+        {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+int hydro_channel_gpio(int ch)
+{
+    return HYDRO_CHANNEL_GPIO(hydro_channels[ch].role, hydro_channels[ch].io);
+}
+
+int hydro_role_decimals(hydro_role_t role)
+{
+    return s_decimals[role];
+}
+
+int32_t hydro_channel_fixed(int ch, float value)
+{
+    return lroundf(value * s_pow10[s_decimals[hydro_channels[ch].role]]);
+}
+
+const char *hydro_channel_tag(int ch)
+{
+    return s_tags[ch];
+}
@@ -0,0 +1,109 @@
+#ifndef HYDRO_CHANNELS_H
+#define HYDRO_CHANNELS_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#define HYDRO_TANK_COUNT (CONFIG_HYDRO_TANK_COUNT)
+
+// What a channel does. Sensor roles come first, see HYDRO_ROLE_IS_SENSOR().
+typedef enum
+{
+    HYDRO_ROLE_TEMPERATURE, // DS18B20 on its own 1-Wire bus, io = bus GPIO
+    HYDRO_ROLE_PH,          // pH probe, io = ADC1 channel
+    HYDRO_ROLE_WATER_LEVEL, // float switch, io = GPIO
+    HYDRO_ROLE_LIGHT,       // light sensor, io = ADC1 channel
+    HYDRO_ROLE_PH_UP,       // pumps and lights, io = GPIO
+    HYDRO_ROLE_PH_DOWN,
+    HYDRO_ROLE_PLANT_FOOD,
+    HYDRO_ROLE_GROW_LIGHT,
+    HYDRO_ROLE_COUNT,
+} hydro_role_t;
+
+#define HYDRO_ROLE_IS_SENSOR(role) ((role) <= HYDRO_ROLE_LIGHT)
+#define HYDRO_ROLE_IS_ADC(role) ((role) == HYDRO_ROLE_PH || (role) == HYDRO_ROLE_LIGHT)
+#define HYDRO_ROLE_IS_PUMP(role) ((role) >= HYDRO_ROLE_PH_UP && (role) <= HYDRO_ROLE_PLANT_FOOD)
+
+// Decimal places kept where a role's values go out in fixed point: the
+// flash log and the compressed telemetry stream.
+// X(role, decimals)
+#define HYDRO_ROLE_DECIMALS_TABLE(X)     \
+    X(HYDRO_ROLE_TEMPERATURE, 2)         \
+    X(HYDRO_ROLE_PH, 2)                  \
+    X(HYDRO_ROLE_WATER_LEVEL, 0)         \
+    X(HYDRO_ROLE_LIGHT, 0)               \
+    X(HYDRO_ROLE_PH_UP, 0)               \
+    X(HYDRO_ROLE_PH_DOWN, 0)             \
+    X(HYDRO_ROLE_PLANT_FOOD, 0)          \
+    X(HYDRO_ROLE_GROW_LIGHT, 0)
+
+/*
+ * Channel table: every sensor and actuator of every tank, one row each.
+ *
+ * X(name, tank, role, io)
+ *
+ * Each tank must list every role exactly once and no two channels may share
+ * a pin; both are checked at build time in hydro_channels.c. To add a tank,
+ * add a HYDRO_TANKn_CHANNELS block and raise the HYDRO_TANK_COUNT range.
+ */
+#define HYDRO_TANK0_CHANNELS(X)                        \
+    X(T0_TEMP, 0, HYDRO_ROLE_TEMPERATURE, 13)          \
+    X(T0_PH, 0, HYDRO_ROLE_PH, 6)                      \
+    X(T0_WATER_LEVEL, 0, HYDRO_ROLE_WATER_LEVEL, 14)   \
+    X(T0_LIGHT, 0, HYDRO_ROLE_LIGHT, 3)                \
+    X(T0_PH_UP, 0, HYDRO_ROLE_PH_UP, 33)               \
+    X(T0_PH_DOWN, 0, HYDRO_ROLE_PH_DOWN, 32)           \
+    X(T0_PLANT_FOOD, 0, HYDRO_ROLE_PLANT_FOOD, 25)     \
+    X(T0_GROW_LIGHT, 0, HYDRO_ROLE_GROW_LIGHT, 27)
+
+#if CONFIG_HYDRO_TANK_COUNT > 1
+#define HYDRO_TANK1_CHANNELS(X)                        \
+    X(T1_TEMP, 1, HYDRO_ROLE_TEMPERATURE, 16)          \
+    X(T1_PH, 1, HYDRO_ROLE_PH, 7)                      \
+    X(T1_WATER_LEVEL, 1, HYDRO_ROLE_WATER_LEVEL, 17)   \
+    X(T1_LIGHT, 1, HYDRO_ROLE_LIGHT, 0)                \
+    X(T1_PH_UP, 1, HYDRO_ROLE_PH_UP, 18)               \
+    X(T1_PH_DOWN, 1, HYDRO_ROLE_PH_DOWN, 19)           \
+    X(T1_PLANT_FOOD, 1, HYDRO_ROLE_PLANT_FOOD, 21)     \
+    X(T1_GROW_LIGHT, 1, HYDRO_ROLE_GROW_LIGHT, 22)
+#else
+#define HYDRO_TANK1_CHANNELS(X)
+#endif
+
+#define HYDRO_CHANNEL_TABLE(X) \
+    HYDRO_TANK0_CHANNELS(X)    \
+    HYDRO_TANK1_CHANNELS(X)
+
+typedef enum
+{
+#define HYDRO_CHANNEL_ENUM(name, tank, role, io) HYDRO_CH_##name,
+    HYDRO_CHANNEL_TABLE(HYDRO_CHANNEL_ENUM)
+#undef HYDRO_CHANNEL_ENUM
+    HYDRO_CHANNEL_COUNT,
+} hydro_channel_id_t;
+
+typedef struct
+{
+    const char *name;
+    uint8_t tank;
+    hydro_role_t role;
+    int io; // GPIO number, or ADC1 channel for ADC roles
+} hydro_channel_t;
+
+extern const hydro_channel_t hydro_channels[HYDRO_CHANNEL_COUNT];
+
+// Returns the channel of the given role in a tank, or -1 if there is none.
+int hydro_channel_find(int tank, hydro_role_t role);
+
+// GPIO pad used by a channel, resolving ADC1 channels to their pad.
+int hydro_channel_gpio(int ch);
+
+// A channel's value in fixed point, with the decimals of its role
+int32_t hydro_channel_fixed(int ch, float value);
+int hydro_role_decimals(hydro_role_t role);
+
+// Telemetry prefix for a sensor channel: "T", "PH", "WL" or "L" for tank 0,
+// with the tank number appended for the other tanks ("PH1").
+const char *hydro_channel_tag(int ch);
+
+#endif // HYDRO_CHANNELS_H
@@ -0,0 +1,83 @@
+#include "hydro_io.h"
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+
+#include "driver/adc.h"
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "esp_err.h"
+#include "hydro_channels.h"
+
+#if CONFIG_HYDRO_FLOW_METER
+static pcnt_unit_handle_t s_flow;
+#endif
+
+void io_init(void)
+{
+    adc1_config_width(ADC_WIDTH_BIT_12); // Set ADC resolution to 12 bits
+}
+
+void io_output_init(int ch)
+{
+    gpio_num_t pin = hydro_channels[ch].io;
+    gpio_reset_pin(pin);
+    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+}
+
+void io_output_set(int ch, int level)
+{
+    gpio_set_level(hydro_channels[ch].io, level);
+}
+
+int io_input_get(int ch)
+{
+    return gpio_get_level(hydro_channels[ch].io);
+}
+
+void io_adc_init(int ch)
+{
+    adc1_config_channel_atten(hydro_channels[ch].io, ADC_ATTEN_DB_11); // Set attenuation for full-scale voltage
+}
+
+int io_adc_read(int ch)
+{
+    return adc1_get_raw(hydro_channels[ch].io);
+}
+
+#if CONFIG_HYDRO_FLOW_METER
+void io_flow_init(void)
+{
+    // Counts past the 16-bit unit are accumulated in software, which needs
+    // the limit as a watch point
+    pcnt_unit_config_t unit_config = {
+        .low_limit = -1,
+        .high_limit = INT16_MAX,
+        .flags.accum_count = true,
+    };
+    ESP_ERROR_CHECK(pcnt_new_unit(&unit_config, &s_flow));
+    pcnt_glitch_filter_config_t filter_config = {.max_glitch_ns = 1000};
+    ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(s_flow, &filter_config));
+    pcnt_chan_config_t chan_config = {
+        .edge_gpio_num = CONFIG_HYDRO_FLOW_METER_GPIO,
+        .level_gpio_num = -1,
+    };
+    pcnt_channel_handle_t chan;
+    ESP_ERROR_CHECK(pcnt_new_channel(s_flow, &chan_config, &chan));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                                 PCNT_CHANNEL_EDGE_ACTION_HOLD));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(s_flow, INT16_MAX));
+    ESP_ERROR_CHECK(pcnt_unit_enable(s_flow));
+    ESP_ERROR_CHECK(pcnt_unit_clear_count(s_flow));
+    ESP_ERROR_CHECK(pcnt_unit_start(s_flow));
+}
+
+int io_flow_count(void)
+{
+    int count = 0;
+    pcnt_unit_get_count(s_flow, &count);
+    return count;
+}
+#endif
+
+#endif // !CONFIG_IDF_TARGET_LINUX
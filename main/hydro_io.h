@@ -0,0 +1,36 @@
+#ifndef HYDRO_IO_H
+#define HYDRO_IO_H
+
+#include "sdkconfig.h"
+
+/*
+ * Pin and ADC access of the channel tasks, by channel index. On a chip this
+ * is the GPIO and ADC1 drivers (hydro_io.c). On the linux target
+ * hydro_io_sim.c reads a reservoir model driven by the pumps, or scripted
+ * or recorded readings, logs the outputs and also stands in for the
+ * DS18B20 driver (onewire_sensor.h).
+ */
+
+// Calibration of the pH probe: pH = slope * ADC counts + offset
+#define HYDRO_PH_SLOPE (-0.00476f)
+#define HYDRO_PH_OFFSET 15.28f
+
+// Called once from app_main before the channel tasks start
+void io_init(void);
+
+void io_output_init(int ch);
+void io_output_set(int ch, int level);
+
+int io_input_get(int ch);
+
+void io_adc_init(int ch);
+int io_adc_read(int ch); // 12-bit counts
+
+#if CONFIG_HYDRO_FLOW_METER
+// Flow meter on the dosing supply (dosing.h), pulses counted since
+// io_flow_init(): PCNT on a chip, the model's pumped volume on linux
+void io_flow_init(void);
+int io_flow_count(void);
+#endif
+
+#endif // HYDRO_IO_H
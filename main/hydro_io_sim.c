@@ -0,0 +1,266 @@
+#include "hydro_io.h"
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "hydro_channels.h"
+#include "onewire_sensor.h"
+#include "reservoir.h"
+
+/*
+ * Simulated inputs. Each tank is a reservoir model (reservoir.h) started at
+ * SIM_START_PH and driven in real time by the pump outputs.
+ *
+ * HYDRO_SIM_SCRIPT optionally names a file of "<ms>,<tag>,<value>" lines,
+ * the format the bridge records with RECORD=. Times count from the first
+ * line and are played back from boot; each channel holds its last value
+ * until the next line for it. Values are in the units sent on the link:
+ * degrees, pH, 0/1 for the float switch and counts for the light sensor.
+ * Channels with lines read the script instead of the model.
+ */
+#define SIM_START_PH 7.0
+
+typedef struct
+{
+    uint32_t ms;
+    float value;
+} sim_event_t;
+
+// Each channel is only read by the task that samples it
+typedef struct
+{
+    sim_event_t *events;
+    int count;
+    int next;
+    float value;
+    int output; // last level set, -1 before the first
+} sim_channel_t;
+
+static const char *TAG = "sim";
+
+static sim_channel_t s_channels[HYDRO_CHANNEL_COUNT];
+
+// Models are shared by the sensor and pump tasks of a tank
+static reservoir_t s_tanks[HYDRO_TANK_COUNT];
+static SemaphoreHandle_t s_model_lock;
+static StaticSemaphore_t s_model_lock_buf;
+
+static int find_tag(const char *tag)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (strcmp(tag, hydro_channel_tag(ch)) == 0)
+        {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+static void load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        ESP_LOGE(TAG, "cannot open %s", path);
+        return;
+    }
+    char line[96];
+    unsigned long first = 0;
+    int lines = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long ms;
+        char tag[16];
+        float value;
+        if (sscanf(line, "%lu,%15[^,],%f", &ms, tag, &value) != 3)
+        {
+            continue;
+        }
+        int ch = find_tag(tag);
+        if (ch < 0)
+        {
+            continue;
+        }
+        if (lines++ == 0)
+        {
+            first = ms;
+        }
+        sim_channel_t *c = &s_channels[ch];
+        sim_event_t *events = realloc(c->events, (c->count + 1) * sizeof(sim_event_t));
+        if (events == NULL)
+        {
+            break;
+        }
+        c->events = events;
+        c->events[c->count++] = (sim_event_t){(uint32_t)(ms - first), value};
+    }
+    fclose(f);
+    ESP_LOGI(TAG, "%d readings from %s", lines, path);
+}
+
+void io_init(void)
+{
+    s_model_lock = xSemaphoreCreateMutexStatic(&s_model_lock_buf);
+    for (int tank = 0; tank < HYDRO_TANK_COUNT; tank++)
+    {
+        reservoir_init(&s_tanks[tank], &reservoir_defaults, SIM_START_PH);
+    }
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        s_channels[ch].output = -1;
+    }
+    const char *script = getenv("HYDRO_SIM_SCRIPT");
+    if (script)
+    {
+        load_script(script);
+    }
+}
+
+// Model of a channel's tank, brought up to the current time. Call with
+// s_model_lock held.
+static reservoir_t *sim_model(int ch)
+{
+    reservoir_t *r = &s_tanks[hydro_channels[ch].tank];
+    reservoir_run(r, esp_timer_get_time() / 1e6);
+    return r;
+}
+
+static float model_value(int ch)
+{
+    xSemaphoreTake(s_model_lock, portMAX_DELAY);
+    reservoir_t *r = sim_model(ch);
+    float value = 0;
+    switch (hydro_channels[ch].role)
+    {
+    case HYDRO_ROLE_TEMPERATURE:
+        value = r->temp_c;
+        break;
+    case HYDRO_ROLE_PH:
+        value = r->ph;
+        break;
+    case HYDRO_ROLE_WATER_LEVEL:
+        value = reservoir_level_ok(r);
+        break;
+    case HYDRO_ROLE_LIGHT:
+        value = reservoir_light(r);
+        break;
+    default:
+        break;
+    }
+    xSemaphoreGive(s_model_lock);
+    return value;
+}
+
+// Value of a channel at the current time
+static float sim_value(int ch)
+{
+    sim_channel_t *c = &s_channels[ch];
+    if (c->count == 0)
+    {
+        return model_value(ch);
+    }
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    while (c->next < c->count && c->events[c->next].ms <= now_ms)
+    {
+        c->value = c->events[c->next++].value;
+    }
+    return c->value;
+}
+
+static int sim_pump(hydro_role_t role)
+{
+    switch (role)
+    {
+    case HYDRO_ROLE_PH_UP:
+        return RESERVOIR_PUMP_UP;
+    case HYDRO_ROLE_PH_DOWN:
+        return RESERVOIR_PUMP_DOWN;
+    case HYDRO_ROLE_PLANT_FOOD:
+        return RESERVOIR_PUMP_FOOD;
+    default:
+        return -1;
+    }
+}
+
+void io_output_init(int ch)
+{
+}
+
+void io_output_set(int ch, int level)
+{
+    if (s_channels[ch].output != level)
+    {
+        s_channels[ch].output = level;
+        ESP_LOGI(TAG, "%s -> %d", hydro_channels[ch].name, level);
+        int pump = sim_pump(hydro_channels[ch].role);
+        if (pump >= 0)
+        {
+            xSemaphoreTake(s_model_lock, portMAX_DELAY);
+            reservoir_set_pump(sim_model(ch), pump, level != 0);
+            xSemaphoreGive(s_model_lock);
+        }
+    }
+}
+
+int io_input_get(int ch)
+{
+    return sim_value(ch) != 0.0f;
+}
+
+void io_adc_init(int ch)
+{
+}
+
+int io_adc_read(int ch)
+{
+    float value = sim_value(ch);
+    if (hydro_channels[ch].role == HYDRO_ROLE_PH)
+    {
+        value = (value - HYDRO_PH_OFFSET) / HYDRO_PH_SLOPE;
+    }
+    return value < 0 ? 0 : value > 4095 ? 4095 : (int)(value + 0.5f);
+}
+
+#if CONFIG_HYDRO_FLOW_METER
+void io_flow_init(void)
+{
+}
+
+// All the model's pumps are on the one supply the meter is on
+int io_flow_count(void)
+{
+    double ml = 0;
+    xSemaphoreTake(s_model_lock, portMAX_DELAY);
+    for (int tank = 0; tank < HYDRO_TANK_COUNT; tank++)
+    {
+        reservoir_t *r = &s_tanks[tank];
+        reservoir_run(r, esp_timer_get_time() / 1e6);
+        for (int pump = 0; pump < RESERVOIR_PUMP_COUNT; pump++)
+        {
+            ml += r->pumped_ml[pump];
+        }
+    }
+    xSemaphoreGive(s_model_lock);
+    return (int)(ml * CONFIG_HYDRO_FLOW_METER_PULSES_PER_L / 1000);
+}
+#endif
+
+void sensor_detect(int tank, int bus_gpio)
+{
+}
+
+bool sensor_read(int tank, float *out)
+{
+    *out = sim_value(hydro_channel_find(tank, HYDRO_ROLE_TEMPERATURE));
+    return true;
+}
+
+#endif // CONFIG_IDF_TARGET_LINUX
@@ -0,0 +1,79 @@
+#include "latency_hist.h"
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct
+{
+    uint32_t buckets[HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+} hist_t;
+
+static const char *const s_kind_names[HIST_KIND_COUNT] = {
+    [HIST_JITTER] = "jitter",
+    [HIST_LATENCY] = "latency",
+};
+
+static hist_t s_hists[HIST_SLOTS][HIST_KIND_COUNT];
+static portMUX_TYPE s_hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void hist_record(int slot, hist_kind_t kind, uint32_t us)
+{
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= HIST_BUCKETS)
+    {
+        bucket = HIST_BUCKETS - 1;
+    }
+
+    hist_t *h = &s_hists[slot][kind];
+    portENTER_CRITICAL(&s_hist_lock);
+    h->buckets[bucket]++;
+    h->count++;
+    if (us > h->max_us)
+    {
+        h->max_us = us;
+    }
+    portEXIT_CRITICAL(&s_hist_lock);
+}
+
+void hist_reset(void)
+{
+    portENTER_CRITICAL(&s_hist_lock);
+    for (int i = 0; i < HIST_SLOTS; i++)
+    {
+        for (int k = 0; k < HIST_KIND_COUNT; k++)
+        {
+            s_hists[i][k] = (hist_t){0};
+        }
+    }
+    portEXIT_CRITICAL(&s_hist_lock);
+}
+
+int hist_format(int slot, const char *name, hist_kind_t kind, char *buf, size_t len)
+{
+    portENTER_CRITICAL(&s_hist_lock);
+    hist_t h = s_hists[slot][kind];
+    portEXIT_CRITICAL(&s_hist_lock);
+
+    if (h.count == 0)
+    {
+        return 0;
+    }
+
+    // "H:T0_PH latency n=42 max=1830 <1024:40 <2048:2"
+    size_t pos = snprintf(buf, len, "H:%s %s n=%lu max=%lu", name, s_kind_names[kind],
+                          (unsigned long)h.count, (unsigned long)h.max_us);
+    for (int i = 0; i < HIST_BUCKETS && pos < len; i++)
+    {
+        if (h.buckets[i])
+        {
+            pos += snprintf(buf + pos, len - pos, " <%lu:%lu", 1UL << i, (unsigned long)h.buckets[i]);
+        }
+    }
+    if (pos + 1 < len)
+    {
+        buf[pos++] = '\n';
+        buf[pos] = '\0';
+    }
+    return pos < len ? pos : len - 1;
+}
@@ -0,0 +1,28 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Log2-bucketed histograms per channel, in microseconds. Bucket 0 counts
+ * zero, bucket i counts values in [2^(i-1), 2^i); the last bucket also
+ * takes everything larger.
+ */
+#define HIST_BUCKETS 24
+#define HIST_SLOTS 16
+
+typedef enum
+{
+    HIST_JITTER,  // |actual - nominal| sampling period
+    HIST_LATENCY, // acquisition to UART write done
+    HIST_KIND_COUNT,
+} hist_kind_t;
+
+void hist_record(int slot, hist_kind_t kind, uint32_t us);
+void hist_reset(void);
+
+// Format one histogram as a line of text. Returns 0 if it is empty.
+int hist_format(int slot, const char *name, hist_kind_t kind, char *buf, size_t len);
+
+#endif // LATENCY_HIST_H
@@ -0,0 +1,188 @@
+#include "mem_budget.h"
+#include <assert.h>
+#include <stdio.h>
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#endif
+
+#if CONFIG_HYDRO_STATIC_ALLOC
+#define MEM_STATIC 1
+#else
+#define MEM_STATIC 0
+#endif
+
+#define MEM_BUFFER_DEF_MEM(id, bytes) uint8_t mem_buffer_##id[bytes];
+#define MEM_BUFFER_DEF_MODULE(id, bytes)
+#define MEM_BUFFER_DEF(id, bytes, owner) MEM_BUFFER_DEF_##owner(id, bytes)
+MEM_BUFFER_TABLE(MEM_BUFFER_DEF)
+#undef MEM_BUFFER_DEF
+
+static const struct
+{
+    const char *name;
+    uint32_t stack_bytes;
+    uint8_t instances;
+} s_tasks[MEM_TASK_COUNT] = {
+#define MEM_TASK_ROW(id, stack_bytes, instances) [MEM_TASK_##id] = {#id, stack_bytes, instances},
+    MEM_TASK_TABLE(MEM_TASK_ROW)
+#undef MEM_TASK_ROW
+};
+
+static const struct
+{
+    const char *name;
+    size_t bytes;
+} s_buffers[] = {
+#define MEM_BUFFER_ROW(id, bytes, owner) {#id, bytes},
+    MEM_BUFFER_TABLE(MEM_BUFFER_ROW)
+#undef MEM_BUFFER_ROW
+};
+
+#define MEM_TASK_INSTANCES(id, stack_bytes, instances) +(instances)
+#define MEM_TASK_TOTAL(id, stack_bytes, instances) +(stack_bytes) * (instances)
+#define MEM_BUFFER_TOTAL(id, bytes, owner) +(bytes)
+#define MEM_INSTANCE_COUNT (0 MEM_TASK_TABLE(MEM_TASK_INSTANCES))
+
+#if CONFIG_HYDRO_STATIC_ALLOC
+#define MEM_STATIC_TOTAL ((0 MEM_TASK_TABLE(MEM_TASK_TOTAL)) + MEM_INSTANCE_COUNT * sizeof(StaticTask_t) + \
+                          (0 MEM_BUFFER_TABLE(MEM_BUFFER_TOTAL)))
+
+static_assert(MEM_STATIC_TOTAL <= CONFIG_HYDRO_STATIC_RAM_BUDGET_KB * 1024,
+              "task stacks and buffers exceed CONFIG_HYDRO_STATIC_RAM_BUDGET_KB");
+
+#define MEM_TASK_STORAGE(id, stack_bytes, instances)                   \
+    static StackType_t s_stack_##id[instances][stack_bytes];           \
+    static StaticTask_t s_tcb_##id[instances];
+MEM_TASK_TABLE(MEM_TASK_STORAGE)
+#undef MEM_TASK_STORAGE
+
+static StackType_t *mem_stack(mem_task_t id, int instance)
+{
+    switch (id)
+    {
+#define MEM_TASK_STACK(id, stack_bytes, instances) \
+    case MEM_TASK_##id:                            \
+        return s_stack_##id[instance];
+        MEM_TASK_TABLE(MEM_TASK_STACK)
+#undef MEM_TASK_STACK
+    default:
+        return NULL;
+    }
+}
+
+static StaticTask_t *mem_tcb(mem_task_t id, int instance)
+{
+    switch (id)
+    {
+#define MEM_TASK_TCB(id, stack_bytes, instances) \
+    case MEM_TASK_##id:                          \
+        return &s_tcb_##id[instance];
+        MEM_TASK_TABLE(MEM_TASK_TCB)
+#undef MEM_TASK_TCB
+    default:
+        return NULL;
+    }
+}
+#endif // CONFIG_HYDRO_STATIC_ALLOC
+
+static struct
+{
+    TaskHandle_t handle;
+    const char *name;
+    mem_task_t id;
+} s_created[MEM_INSTANCE_COUNT];
+static int s_created_count;
+static uint8_t s_used[MEM_TASK_COUNT];
+static size_t s_driver_heap_before, s_driver_heap_after;
+
+uint32_t mem_task_stack_size(mem_task_t id)
+{
+    return s_tasks[id].stack_bytes;
+}
+
+// Tasks are created from app_main and the command task, never concurrently
+// with each other, so the bookkeeping needs no lock.
+BaseType_t mem_create_task(TaskFunction_t fn, const char *name, mem_task_t id, void *arg,
+                           UBaseType_t priority, BaseType_t core, TaskHandle_t *handle)
+{
+    if (s_used[id] >= s_tasks[id].instances)
+    {
+        return pdFAIL;
+    }
+    int instance = s_used[id]++;
+    TaskHandle_t created = NULL;
+
+#if CONFIG_HYDRO_STATIC_ALLOC
+    created = xTaskCreateStaticPinnedToCore(fn, name, s_tasks[id].stack_bytes, arg, priority,
+                                            mem_stack(id, instance), mem_tcb(id, instance), core);
+#else
+    (void)instance;
+    xTaskCreatePinnedToCore(fn, name, s_tasks[id].stack_bytes, arg, priority, &created, core);
+#endif
+    if (created == NULL)
+    {
+        return pdFAIL;
+    }
+    s_created[s_created_count].handle = created;
+    s_created[s_created_count].name = name;
+    s_created[s_created_count].id = id;
+    s_created_count++;
+    if (handle)
+    {
+        *handle = created;
+    }
+    return pdPASS;
+}
+
+size_t mem_heap_free(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    return 0;
+#else
+    return esp_get_free_heap_size();
+#endif
+}
+
+void mem_note_driver_heap(size_t free_before, size_t free_after)
+{
+    s_driver_heap_before = free_before;
+    s_driver_heap_after = free_after;
+}
+
+void mem_report(void (*write_line)(const char *line, int len))
+{
+    char line[96];
+    int n;
+    size_t stacks = 0, buffers = 0;
+
+    for (int i = 0; i < s_created_count; i++)
+    {
+        uint32_t size = s_tasks[s_created[i].id].stack_bytes;
+        uint32_t free_min = uxTaskGetStackHighWaterMark(s_created[i].handle);
+        stacks += size;
+        n = snprintf(line, sizeof(line), "M:task %s stack=%lu peak=%lu\n", s_created[i].name,
+                     (unsigned long)size, (unsigned long)(size - free_min));
+        write_line(line, n);
+    }
+    for (size_t i = 0; i < sizeof(s_buffers) / sizeof(s_buffers[0]); i++)
+    {
+        if (s_buffers[i].bytes == 0)
+        {
+            continue; // configured out
+        }
+        buffers += s_buffers[i].bytes;
+        n = snprintf(line, sizeof(line), "M:buf %s size=%u\n", s_buffers[i].name, (unsigned)s_buffers[i].bytes);
+        write_line(line, n);
+    }
+    n = snprintf(line, sizeof(line), "M:total stacks=%u buffers=%u static=%d\n", (unsigned)stacks,
+                 (unsigned)buffers, MEM_STATIC);
+    write_line(line, n);
+#if !CONFIG_IDF_TARGET_LINUX
+    n = snprintf(line, sizeof(line), "M:heap free=%lu min=%lu largest=%u drivers=%d\n",
+                 (unsigned long)esp_get_free_heap_size(), (unsigned long)esp_get_minimum_free_heap_size(),
+                 (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+                 (int)(s_driver_heap_before - s_driver_heap_after));
+    write_line(line, n);
+#endif
+}
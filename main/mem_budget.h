@@ -0,0 +1,122 @@
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "hydro_channels.h"
+#include "sdkconfig.h"
+
+/*
+ * Every task stack and large buffer of the firmware, sized at build time.
+ *
+ * X(id, stack_bytes, instances)
+ *
+ * With CONFIG_HYDRO_STATIC_ALLOC the stacks and TCBs are static arrays, so
+ * the whole budget is fixed at link time, and a static_assert fails the
+ * build if the stacks, TCBs and MEM_BUFFER_TABLE need more than
+ * CONFIG_HYDRO_STATIC_RAM_BUDGET_KB. The 'M' command reports each task's
+ * peak stack use from its high-water mark at run time.
+ *
+ * Every task starts at boot; AUTO_PH and TOGGLE_LED idle until their
+ * command. The 1-Wire, DS18B20, RMT and UART drivers allocate their
+ * objects inside ESP-IDF at boot and never free them, so they cannot
+ * fragment the heap later; 'M' shows the heap they took.
+ */
+#define MEM_TASK_TABLE(X)                                   \
+    X(ECHO, CONFIG_EXAMPLE_TASK_STACK_SIZE, 1)              \
+    X(TEMPERATURE, 4096, HYDRO_TANK_COUNT)                  \
+    X(WATER_LEVEL, 2048, HYDRO_TANK_COUNT)                  \
+    X(PH, 3072, HYDRO_TANK_COUNT)                           \
+    X(LIGHT, 4096, HYDRO_TANK_COUNT)                        \
+    X(DISPENSE, 4096, 3 * HYDRO_TANK_COUNT)                 \
+    X(TOGGLE_LED, 4096, HYDRO_TANK_COUNT)                   \
+    X(AUTO_PH, 2048, HYDRO_TANK_COUNT)                      \
+    X(UART_LOAD, 2048, 1)                                   \
+    X(DLOG, 3072, 1)                                        \
+    X(TSDB, 3072, 1)                                        \
+    X(RULES, 3072, 1)
+
+// ESP32 sizes of the buffers the modules own, 0 when configured out
+#if CONFIG_HYDRO_TRACE
+#define MEM_TRACE_BYTES (portNUM_PROCESSORS * (12 * CONFIG_HYDRO_TRACE_RING_ENTRIES + 12))
+#else
+#define MEM_TRACE_BYTES 0
+#endif
+#if CONFIG_HYDRO_TSDB
+#define MEM_TSDB_BYTES 256
+#else
+#define MEM_TSDB_BYTES 0
+#endif
+#if CONFIG_HYDRO_RULES
+#define MEM_RULES_BYTES (240 * CONFIG_HYDRO_RULE_COUNT)
+#else
+#define MEM_RULES_BYTES 0
+#endif
+
+/*
+ * X(id, bytes, owner)
+ *
+ * owner is MEM for a buffer defined here as mem_buffer_<id>, or MODULE for
+ * one its module defines and checks against its row with
+ * MEM_BUFFER_CHECK(). The rows are the sizes on the ESP32; the linux
+ * target's 64-bit pointers make some larger and are not checked.
+ */
+#define MEM_BUFFER_TABLE(X)                                                  \
+    X(ECHO_RX, 1024, MEM)                                                    \
+    X(DLOG_RING, 40 * CONFIG_HYDRO_DLOG_RING_ENTRIES, MODULE)                \
+    X(TRACE_RINGS, MEM_TRACE_BYTES, MODULE)                                  \
+    X(TSDB_PAGE, MEM_TSDB_BYTES, MODULE)                                     \
+    X(ROLLUP, 14176 * HYDRO_TANK_COUNT, MODULE)                              \
+    X(TELEMETRY_BLOCKS, 88 * HYDRO_CHANNEL_COUNT, MODULE)                    \
+    X(RULES, MEM_RULES_BYTES, MODULE)                                        \
+    X(DOSING, 32 * HYDRO_CHANNEL_COUNT, MODULE)
+
+typedef enum
+{
+#define MEM_TASK_ENUM(id, stack_bytes, instances) MEM_TASK_##id,
+    MEM_TASK_TABLE(MEM_TASK_ENUM)
+#undef MEM_TASK_ENUM
+    MEM_TASK_COUNT,
+} mem_task_t;
+
+enum
+{
+#define MEM_BUFFER_ENUM(id, bytes, owner) MEM_BUFFER_BYTES_##id = (bytes),
+    MEM_BUFFER_TABLE(MEM_BUFFER_ENUM)
+#undef MEM_BUFFER_ENUM
+};
+
+#define MEM_BUFFER_DECL_MEM(id, bytes) extern uint8_t mem_buffer_##id[bytes];
+#define MEM_BUFFER_DECL_MODULE(id, bytes)
+#define MEM_BUFFER_DECL(id, bytes, owner) MEM_BUFFER_DECL_##owner(id, bytes)
+MEM_BUFFER_TABLE(MEM_BUFFER_DECL)
+#undef MEM_BUFFER_DECL
+
+// Fails the build if a module's buffer outgrew its row of MEM_BUFFER_TABLE
+#if CONFIG_IDF_TARGET_LINUX
+#define MEM_BUFFER_CHECK(id, buffer)
+#else
+#define MEM_BUFFER_CHECK(id, buffer) \
+    static_assert(sizeof(buffer) <= MEM_BUFFER_BYTES_##id, #buffer " outgrew " #id " in MEM_BUFFER_TABLE")
+#endif
+
+uint32_t mem_task_stack_size(mem_task_t id);
+
+// Create the next instance of a task from the table, static or dynamic per
+// CONFIG_HYDRO_STATIC_ALLOC. Returns pdFAIL when the table has no instance left.
+BaseType_t mem_create_task(TaskFunction_t fn, const char *name, mem_task_t id, void *arg,
+                           UBaseType_t priority, BaseType_t core, TaskHandle_t *handle);
+
+// Heap free before and after the drivers' init at boot, to show what they took
+void mem_note_driver_heap(size_t free_before, size_t free_after);
+
+// Free heap in bytes; 0 on the linux target, where the heap is the host's
+size_t mem_heap_free(void);
+
+// Emit the memory report, one line per call of write_line
+void mem_report(void (*write_line)(const char *line, int len));
+
+#endif // MEM_BUDGET_H
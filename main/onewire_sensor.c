@@ -1,22 +1,38 @@
 #include "onewire_sensor.h"
+#include "sdkconfig.h"
+
+// On the linux target hydro_io_sim.c provides the readings
+#if !CONFIG_IDF_TARGET_LINUX
+
 #include "esp_log.h"
 #include "ds18b20.h"
 #include "onewire_bus.h"
+#include "onewire_crc.h"
+#include "hydro_channels.h"
+#include "dlog.h"
+#include "trace.h"
 
-#define EXAMPLE_ONEWIRE_BUS_GPIO 13
 #define EXAMPLE_ONEWIRE_MAX_DS18B20 2
 
-static int s_ds18b20_device_num = 0;
-static float s_temperature = 0.0;
-static ds18b20_device_handle_t s_ds18b20s[EXAMPLE_ONEWIRE_MAX_DS18B20];
+// One 1-Wire bus per tank
+static int s_ds18b20_device_num[HYDRO_TANK_COUNT];
+static ds18b20_device_handle_t s_ds18b20s[HYDRO_TANK_COUNT][EXAMPLE_ONEWIRE_MAX_DS18B20];
 
 static const char *TAG = "DS18B20";
 
-void sensor_detect(void)
+#if CONFIG_ONEWIRE_CRC8_SELF_TEST
+void sensor_self_test(void)
+{
+    // Every ROM and scratchpad read is checked with it
+    ESP_ERROR_CHECK(onewire_crc8_self_test() ? ESP_OK : ESP_ERR_INVALID_CRC);
+}
+#endif
+
+void sensor_detect(int tank, int bus_gpio)
 {
     onewire_bus_handle_t bus = NULL;
     onewire_bus_config_t bus_config = {
-        .bus_gpio_num = EXAMPLE_ONEWIRE_BUS_GPIO,
+        .bus_gpio_num = bus_gpio,
     };
     onewire_bus_rmt_config_t rmt_config = {
         .max_rx_bytes = 10,
@@ -28,19 +44,20 @@ void sensor_detect(void)
     esp_err_t search_result = ESP_OK;
 
     ESP_ERROR_CHECK(onewire_new_device_iter(bus, &iter));
-    ESP_LOGI(TAG, "Device iterator created, start searching...");
+    ESP_LOGI(TAG, "Device iterator created on GPIO %d (tank %d), start searching...", bus_gpio, tank);
     do
     {
         search_result = onewire_device_iter_get_next(iter, &next_onewire_device);
-        if (search_result == ESP_OK)
+        if (search_result == ESP_OK && s_ds18b20_device_num[tank] < EXAMPLE_ONEWIRE_MAX_DS18B20)
         {
             ds18b20_config_t ds_cfg = {};
             onewire_device_address_t address;
-            if (ds18b20_new_device(&next_onewire_device, &ds_cfg, &s_ds18b20s[s_ds18b20_device_num]) == ESP_OK)
+            int num = s_ds18b20_device_num[tank];
+            if (ds18b20_new_device(&next_onewire_device, &ds_cfg, &s_ds18b20s[tank][num]) == ESP_OK)
             {
-                ds18b20_get_device_address(s_ds18b20s[s_ds18b20_device_num], &address);
-                ESP_LOGI(TAG, "Found a DS18B20[%d], address: %016llX", s_ds18b20_device_num, address);
-                s_ds18b20_device_num++;
+                ds18b20_get_device_address(s_ds18b20s[tank][num], &address);
+                ESP_LOGI(TAG, "Found a DS18B20[%d], address: %016llX", num, address);
+                s_ds18b20_device_num[tank]++;
             }
             else
             {
@@ -49,21 +66,27 @@ void sensor_detect(void)
         }
     } while (search_result != ESP_ERR_NOT_FOUND);
     ESP_ERROR_CHECK(onewire_del_device_iter(iter));
-    ESP_LOGI(TAG, "Searching done, %d DS18B20 device(s) found", s_ds18b20_device_num);
+    ESP_LOGI(TAG, "Searching done, %d DS18B20 device(s) found", s_ds18b20_device_num[tank]);
 }
 
-float sensor_read(void)
+bool sensor_read(int tank, float *out)
 {
-    for (int i = 0; i < s_ds18b20_device_num; i++)
+    float temperature = 0.0;
+    for (int i = 0; i < s_ds18b20_device_num[tank]; i++)
     {
-        ESP_ERROR_CHECK(ds18b20_trigger_temperature_conversion(s_ds18b20s[i]));
-        ESP_ERROR_CHECK(ds18b20_get_temperature(s_ds18b20s[i], &s_temperature));
-        ESP_LOGI(TAG, "Temperature read from DS18B20[%d]: %.2fC", i, s_temperature);
-        return s_temperature;
+        trace_begin(ONEWIRE_CONVERT, tank);
+        ESP_ERROR_CHECK(ds18b20_trigger_temperature_conversion(s_ds18b20s[tank][i]));
+        trace_end(ONEWIRE_CONVERT, tank);
+        trace_begin(ONEWIRE_READ, tank);
+        ESP_ERROR_CHECK(ds18b20_get_temperature(s_ds18b20s[tank][i], &temperature));
+        trace_end(ONEWIRE_READ, tank);
+        DLOG(TEMP_READ, i, dlog_f(temperature));
+        *out = temperature;
+        return true;
     }
 
-    ESP_LOGE(TAG, "No DS18B20 device found");
-    return -1.0;
-    
+    DLOG(TEMP_MISSING);
+    return false;
+}
 
-}
\ No newline at end of file
+#endif // !CONFIG_IDF_TARGET_LINUX
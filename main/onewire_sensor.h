@@ -1,7 +1,18 @@
 #ifndef ONEWIRE_SENSOR_H
 #define ONEWIRE_SENSOR_H
 
-void sensor_detect(void);
-float sensor_read(void);
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#if CONFIG_ONEWIRE_CRC8_SELF_TEST && !CONFIG_IDF_TARGET_LINUX
+void sensor_self_test(void);
+#else
+static inline void sensor_self_test(void) {}
+#endif
+void sensor_detect(int tank, int bus_gpio);
+
+// Temperature of the first DS18B20 on a tank's bus, in C. Returns false,
+// leaving *out alone, if there is none.
+bool sensor_read(int tank, float *out);
 
 #endif // ONEWIRE_SENSOR_H
\ No newline at end of file
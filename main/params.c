@@ -0,0 +1,213 @@
+#include "params.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
+
+#define PARAM_NAMESPACE "params"
+#define PARAM_SAVE_DELAY_US (CONFIG_HYDRO_PARAM_SAVE_DELAY_MS * 1000LL)
+
+static_assert(PARAM_COUNT <= 32, "dirty parameters are a 32-bit mask");
+
+static const char *TAG = "params";
+
+static const struct
+{
+    const char *key;
+    param_type_t type;
+    float def;
+    float min;
+    float max;
+} s_params[PARAM_COUNT] = {
+#define PARAM_ROW(id, key, type, def, min, max) [PARAM_##id] = {key, PARAM_##type, def, min, max},
+    PARAM_TABLE(PARAM_ROW)
+#undef PARAM_ROW
+};
+
+// Written by the command task only; every other task just loads a value
+static float s_values[PARAM_COUNT];
+static uint32_t s_dirty;
+static int64_t s_changed_us;
+
+static bool in_range(param_id_t id, float value)
+{
+    return value >= s_params[id].min && value <= s_params[id].max;
+}
+
+// INT parameters are stored as their value, FLOAT ones as their bits
+static uint32_t to_stored(param_id_t id, float value)
+{
+    if (s_params[id].type == PARAM_INT)
+    {
+        return (uint32_t)(int32_t)value;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float from_stored(param_id_t id, uint32_t stored)
+{
+    if (s_params[id].type == PARAM_INT)
+    {
+        return (float)(int32_t)stored;
+    }
+    float value;
+    memcpy(&value, &stored, sizeof(value));
+    return value;
+}
+
+void params_init(void)
+{
+    for (int id = 0; id < PARAM_COUNT; id++)
+    {
+        s_values[id] = s_params[id].def;
+    }
+
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(TAG, "erasing NVS: %s", esp_err_to_name(err));
+        nvs_flash_erase();
+        err = nvs_flash_init();
+    }
+    nvs_handle_t nvs;
+    if (err == ESP_OK)
+    {
+        err = nvs_open(PARAM_NAMESPACE, NVS_READONLY, &nvs);
+    }
+    if (err != ESP_OK)
+    {
+        // ESP_ERR_NVS_NOT_FOUND until the first save
+        if (err != ESP_ERR_NVS_NOT_FOUND)
+        {
+            ESP_LOGW(TAG, "using defaults: %s", esp_err_to_name(err));
+        }
+        return;
+    }
+    int loaded = 0;
+    for (int id = 0; id < PARAM_COUNT; id++)
+    {
+        uint32_t stored;
+        if (nvs_get_u32(nvs, s_params[id].key, &stored) != ESP_OK)
+        {
+            continue;
+        }
+        float value = from_stored(id, stored);
+        if (!in_range(id, value))
+        {
+            ESP_LOGW(TAG, "%s: saved value out of range, using default", s_params[id].key);
+            continue;
+        }
+        s_values[id] = value;
+        loaded++;
+    }
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "%d saved parameters", loaded);
+}
+
+int32_t param_int(param_id_t id)
+{
+    return (int32_t)s_values[id];
+}
+
+float param_float(param_id_t id)
+{
+    return s_values[id];
+}
+
+int param_find(const char *key)
+{
+    for (int id = 0; id < PARAM_COUNT; id++)
+    {
+        if (strcmp(key, s_params[id].key) == 0)
+        {
+            return id;
+        }
+    }
+    return -1;
+}
+
+bool param_set(param_id_t id, const char *text)
+{
+    char *end;
+    float value = strtof(text, &end);
+    if (end == text || *end != '\0')
+    {
+        return false;
+    }
+    return param_set_value(id, value);
+}
+
+bool param_set_value(param_id_t id, float value)
+{
+    if (isnan(value) || !in_range(id, value) || (s_params[id].type == PARAM_INT && value != truncf(value)))
+    {
+        return false;
+    }
+    if (value != s_values[id])
+    {
+        s_values[id] = value;
+        s_dirty |= 1u << id;
+        s_changed_us = esp_timer_get_time();
+    }
+    return true;
+}
+
+int param_format(param_id_t id, char *buf, size_t len)
+{
+    if (s_params[id].type == PARAM_INT)
+    {
+        return snprintf(buf, len, "%s %ld %ld %ld", s_params[id].key, (long)s_values[id], (long)s_params[id].min,
+                        (long)s_params[id].max);
+    }
+    return snprintf(buf, len, "%s %g %g %g", s_params[id].key, s_values[id], s_params[id].min, s_params[id].max);
+}
+
+void params_save(void)
+{
+    if (s_dirty == 0)
+    {
+        return;
+    }
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(PARAM_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        for (int id = 0; id < PARAM_COUNT && err == ESP_OK; id++)
+        {
+            if (s_dirty & (1u << id))
+            {
+                err = nvs_set_u32(nvs, s_params[id].key, to_stored(id, s_values[id]));
+            }
+        }
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        // Retry after another delay rather than on every poll
+        ESP_LOGE(TAG, "save failed: %s", esp_err_to_name(err));
+        s_changed_us = esp_timer_get_time();
+        return;
+    }
+    ESP_LOGI(TAG, "saved 0x%lx", (unsigned long)s_dirty);
+    s_dirty = 0;
+}
+
+void params_poll(void)
+{
+    if (s_dirty && esp_timer_get_time() - s_changed_us >= PARAM_SAVE_DELAY_US)
+    {
+        params_save();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Tuning parameters, changed at run time with the GET / SET / LIST / SAVE
+ * commands and kept in NVS across reboots.
+ *
+ * X(id, key, type, default, min, max)
+ *
+ * key is the command and NVS name (at most 15 characters). type is INT or
+ * FLOAT; INT parameters reject fractional values. Tasks read parameters
+ * every period, so a change applies from their next cycle. Changes are
+ * written to NVS together, CONFIG_HYDRO_PARAM_SAVE_DELAY_MS after the last
+ * one, or at once with SAVE.
+ */
+#define PARAM_TABLE(X)                                             \
+    X(SAMPLE_MS, "sample_ms", INT, 1000, 100, 60000)               \
+    X(PH_SAMPLE_MS, "ph_sample_ms", INT, 2200, 100, 60000)         \
+    X(LIGHT_SAMPLE_MS, "light_ms", INT, 250, 50, 60000)            \
+    X(DOSE_MS, "dose_ms", INT, 1000, 10, 60000)                    \
+    X(PH_TARGET, "ph_target", FLOAT, 6.0f, 0.0f, 14.0f)            \
+    X(PH_BAND, "ph_band", FLOAT, 0.2f, 0.01f, 2.0f)                \
+    X(PH_CHECK_MS, "ph_check_ms", INT, 1000, 100, 60000)           \
+    X(LIGHT_THRESHOLD, "light_on", INT, 1000, 0, 3999)             \
+    X(PUMP_ML_HOUR, "pump_ml_h", FLOAT, 200.0f, 1.0f, 10000.0f)
+
+typedef enum
+{
+    PARAM_INT,
+    PARAM_FLOAT,
+} param_type_t;
+
+typedef enum
+{
+#define PARAM_ENUM(id, key, type, def, min, max) PARAM_##id,
+    PARAM_TABLE(PARAM_ENUM)
+#undef PARAM_ENUM
+    PARAM_COUNT,
+} param_id_t;
+
+// Load saved values from NVS; parameters missing or out of range keep
+// their default. Call before starting the tasks that read them.
+void params_init(void);
+
+int32_t param_int(param_id_t id);
+float param_float(param_id_t id);
+
+// Parameter by key, or -1
+int param_find(const char *key);
+
+// Parse and set a value. Returns false if it does not parse as the
+// parameter's type or is out of range.
+bool param_set(param_id_t id, const char *text);
+bool param_set_value(param_id_t id, float value);
+
+// Format "<key> <value> <min> <max>"
+int param_format(param_id_t id, char *buf, size_t len);
+
+// Called periodically by the command task; saves changes once they settle
+void params_poll(void);
+
+// Save pending changes now
+void params_save(void);
+
+#endif // PARAMS_H
@@ -0,0 +1,31 @@
+#include "ph_control.h"
+
+ph_action_t ph_control_step(ph_control_t *c, bool fresh, float ph, float target, float band)
+{
+    ph_action_t action = PH_ACTION_NONE;
+    if (!fresh)
+    {
+        // No recent reading, don't dose blind
+    }
+    else if (ph < target - band)
+    {
+        action = PH_ACTION_UP;
+    }
+    else if (ph > target + band)
+    {
+        action = PH_ACTION_DOWN;
+    }
+    if (++c->checks == PH_CONTROL_CLEAR_EVERY)
+    {
+        c->checks = 0;
+        action = PH_ACTION_NONE;
+    }
+    return action;
+}
+
+ph_action_t ph_control_check(ph_control_t *c, int64_t age_ms, float ph, ph_settle_status_t settling, float final,
+                             float target, float band)
+{
+    bool fresh = age_ms <= CONFIG_HYDRO_PH_MAX_AGE_MS && settling != PH_SETTLE_WAITING;
+    return ph_control_step(c, fresh, settling == PH_SETTLE_PREDICTED ? final : ph, target, band);
+}
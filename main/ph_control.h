@@ -0,0 +1,42 @@
+#ifndef PH_CONTROL_H
+#define PH_CONTROL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ph_settle.h"
+#include "sdkconfig.h"
+
+/*
+ * Decision of the automatic pH controller, one call per check. Pure C with
+ * no IDF dependencies: auto_PH runs it on the device and
+ * tools/reservoir_sim runs the same code against the reservoir model.
+ */
+
+// Every this many checks both pumps are released, so a request can never
+// outlive the conditions that raised it
+#define PH_CONTROL_CLEAR_EVERY 49
+
+typedef enum
+{
+    PH_ACTION_NONE, // release both pumps
+    PH_ACTION_UP,
+    PH_ACTION_DOWN,
+} ph_action_t;
+
+typedef struct
+{
+    int checks;
+} ph_control_t;
+
+// fresh is false when there is no reading recent enough to dose on
+ph_action_t ph_control_step(ph_control_t *c, bool fresh, float ph, float target, float band);
+
+// One auto_PH check on the latest reading, age_ms old (INT64_MAX if none).
+// Readings older than CONFIG_HYDRO_PH_MAX_AGE_MS are not dosed on. While a
+// dose mixes in (settling from ph_settle.h, PH_SETTLE_IDLE without
+// CONFIG_HYDRO_PH_SETTLE) it doses on the predicted final pH, or not at all
+// until there is one.
+ph_action_t ph_control_check(ph_control_t *c, int64_t age_ms, float ph, ph_settle_status_t settling, float final,
+                             float target, float band);
+
+#endif // PH_CONTROL_H
@@ -0,0 +1,116 @@
+#include "ph_settle.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+// Floor of the residual variance, about the error of a reading quantized
+// by the ADC, so a noiseless fit still has an interval
+#define PH_SETTLE_MIN_VAR 4e-6
+
+// PH_SETTLE_TAU_MIN_S * (PH_SETTLE_TAU_MAX_S / PH_SETTLE_TAU_MIN_S)^(j / 15)
+// as powf gives it, so a reading does not pay a powf per time constant.
+// Regenerate it if the range or count changes.
+static const float s_tau_s[] = {
+    10.0f,       14.1368122f, 19.9849472f, 28.252346f,  39.9398117f, 56.4621658f, 79.8195038f, 112.83934f,
+    159.518875f, 225.50882f,  318.797607f, 450.678162f, 637.115295f, 900.677979f, 1273.27148f, 1800.0f,
+};
+static_assert(sizeof(s_tau_s) / sizeof(s_tau_s[0]) == PH_SETTLE_TAU_COUNT, "one time constant per fit");
+
+void ph_settle_init(ph_settle_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->status = PH_SETTLE_IDLE;
+}
+
+void ph_settle_start(ph_settle_t *s, int64_t now_ms)
+{
+    ph_settle_init(s);
+    s->status = PH_SETTLE_WAITING;
+    s->start_ms = now_ms;
+}
+
+ph_settle_status_t ph_settle_add(ph_settle_t *s, int64_t now_ms, float ph, float ci_max)
+{
+    float t = (now_ms - s->start_ms) / 1000.0f;
+    if (s->status == PH_SETTLE_IDLE || t < 0)
+    {
+        return s->status;
+    }
+    if (s->n == 0)
+    {
+        s->y0 = ph;
+    }
+    double y = ph - s->y0;
+    s->n++;
+    s->sy += y;
+    s->syy += y * y;
+    for (int j = 0; j < PH_SETTLE_TAU_COUNT; j++)
+    {
+        double e = expf(-t / s_tau_s[j]);
+        s->se[j] += e;
+        s->see[j] += e * e;
+        s->sey[j] += e * y;
+    }
+    if (s->n < PH_SETTLE_MIN_READINGS)
+    {
+        return s->status;
+    }
+
+    // final and a for each time constant, and how well each fits
+    double final[PH_SETTLE_TAU_COUNT];
+    double sse[PH_SETTLE_TAU_COUNT];
+    double gain[PH_SETTLE_TAU_COUNT]; // variance of final per unit noise variance
+    int best = -1;
+    for (int j = 0; j < PH_SETTLE_TAU_COUNT; j++)
+    {
+        double det = s->n * s->see[j] - s->se[j] * s->se[j];
+        if (det <= 1e-9 * s->n * s->see[j])
+        {
+            // exp(-t / tau) is still about 1 for every reading: no fit
+            sse[j] = INFINITY;
+            continue;
+        }
+        double a = (s->n * s->sey[j] - s->se[j] * s->sy) / det;
+        final[j] = (s->see[j] * s->sy - s->se[j] * s->sey[j]) / det;
+        sse[j] = fmax(s->syy - final[j] * s->sy - a * s->sey[j], 0);
+        gain[j] = s->see[j] / det;
+        if (best < 0 || sse[j] < sse[best])
+        {
+            best = j;
+        }
+    }
+    if (best < 0)
+    {
+        return s->status;
+    }
+
+    // Every time constant within the 95% F-test of the best one
+    double var = fmax(sse[best] / (s->n - 3), PH_SETTLE_MIN_VAR);
+    double lo = INFINITY;
+    double hi = -INFINITY;
+    float tau_max = 0; // slowest response that fits
+    for (int j = 0; j < PH_SETTLE_TAU_COUNT; j++)
+    {
+        if (sse[j] <= sse[best] + 4 * var)
+        {
+            double err = 2 * sqrt(var * gain[j]);
+            lo = fmin(lo, final[j] - err);
+            hi = fmax(hi, final[j] + err);
+            tau_max = s_tau_s[j];
+        }
+    }
+    s->final = s->y0 + final[best];
+    s->ci = fmax(hi - final[best], final[best] - lo);
+    s->tau_s = s_tau_s[best];
+
+    if (t >= PH_SETTLE_MAX_S || (s->ci <= ci_max && t >= PH_SETTLE_TAUS * tau_max))
+    {
+        // A slow fit would otherwise hold the prediction for hours
+        s->status = PH_SETTLE_IDLE;
+    }
+    else
+    {
+        s->status = s->ci <= ci_max ? PH_SETTLE_PREDICTED : PH_SETTLE_WAITING;
+    }
+    return s->status;
+}
@@ -0,0 +1,69 @@
+#ifndef PH_SETTLE_H
+#define PH_SETTLE_H
+
+#include <stdint.h>
+
+/*
+ * Prediction of where the pH settles after a dose. Pure C with no IDF
+ * dependencies: get_ph_value runs it on the device and tools/common/ph_loop.c
+ * in the host tools.
+ *
+ * After a dose the probe approaches its final value exponentially, as the
+ * dose mixes into the tank (mix_s in reservoir.h):
+ *
+ *   ph(t) = final + a * exp(-t / tau), t from the end of the dose
+ *
+ * For each of PH_SETTLE_TAU_COUNT time constants, log-spaced from
+ * PH_SETTLE_TAU_MIN_S to PH_SETTLE_TAU_MAX_S, final and a are a linear least
+ * squares fit kept as running sums, so a reading costs one expf and a 2x2
+ * solve per time constant and nothing is stored. The best time constant
+ * gives the prediction. Its 95% interval covers every time constant that
+ * fits about as well, each with its own 2-sigma error, so it stays wide
+ * until the readings curve enough to tell the time constant.
+ */
+#define PH_SETTLE_TAU_COUNT 16
+#define PH_SETTLE_TAU_MIN_S 10.0f
+#define PH_SETTLE_TAU_MAX_S 1800.0f
+// Readings before the first prediction
+#define PH_SETTLE_MIN_READINGS 6
+// Settled once this many time constants have passed: within 1% of the step
+#define PH_SETTLE_TAUS 5
+// Back to the reading this long after the dose, whether or not the response
+// fits or its time constants have passed
+#define PH_SETTLE_MAX_S 900
+
+typedef enum
+{
+    PH_SETTLE_IDLE,      // settled, or no dose yet: the reading is the pH
+    PH_SETTLE_WAITING,   // a dose is mixing in, no confident prediction yet
+    PH_SETTLE_PREDICTED, // final is within ci of where the pH settles
+} ph_settle_status_t;
+
+typedef struct
+{
+    ph_settle_status_t status;
+    int64_t start_ms; // end of the last dose
+    int n;
+    float y0; // first reading, the sums are of readings less y0
+    double sy;
+    double syy;
+    // Per time constant: sum of e, e * e and e * y, with e = exp(-t / tau)
+    double se[PH_SETTLE_TAU_COUNT];
+    double see[PH_SETTLE_TAU_COUNT];
+    double sey[PH_SETTLE_TAU_COUNT];
+    // Latest fit
+    float final;
+    float ci; // half-width of the 95% interval
+    float tau_s;
+} ph_settle_t;
+
+void ph_settle_init(ph_settle_t *s);
+
+// A pump started or stopped at now_ms: the fit starts over from there
+void ph_settle_start(ph_settle_t *s, int64_t now_ms);
+
+// A reading taken at now_ms. The prediction counts once its interval is
+// within ci_max. Returns the new status.
+ph_settle_status_t ph_settle_add(ph_settle_t *s, int64_t now_ms, float ph, float ci_max);
+
+#endif // PH_SETTLE_H
@@ -0,0 +1,67 @@
+#include "report_policy.h"
+#include <math.h>
+#include <stdio.h>
+#include "hydro_channels.h"
+#include "sdkconfig.h"
+
+typedef struct
+{
+    float alpha;
+    float deadband;
+    uint32_t heartbeat_ms;
+    uint32_t min_interval_ms;
+} report_policy_t;
+
+typedef struct
+{
+    float filtered;
+    float reported; // filtered value at the last send
+    int64_t sent_us;
+    uint32_t sent;
+    uint32_t skipped;
+} report_state_t;
+
+static const report_policy_t s_policies[HYDRO_ROLE_COUNT] = {
+#define REPORT_POLICY_ROW(role, alpha, deadband, heartbeat_ms, min_interval_ms) \
+    [role] = {alpha, deadband, heartbeat_ms, min_interval_ms},
+    REPORT_POLICY_TABLE(REPORT_POLICY_ROW)
+#undef REPORT_POLICY_ROW
+};
+
+static report_state_t s_states[HYDRO_CHANNEL_COUNT];
+
+bool report_due(int ch, float value, int64_t now_us)
+{
+    const report_policy_t *p = &s_policies[hydro_channels[ch].role];
+    report_state_t *s = &s_states[ch];
+    bool first = s->sent == 0;
+    s->filtered = first ? value : s->filtered + p->alpha * (value - s->filtered);
+
+#if CONFIG_HYDRO_REPORT_POLICY
+    if (!first)
+    {
+        int64_t since_ms = (now_us - s->sent_us) / 1000;
+        bool moved = fabsf(s->filtered - s->reported) > p->deadband;
+        if (since_ms < p->heartbeat_ms && !(moved && since_ms >= p->min_interval_ms))
+        {
+            s->skipped++;
+            return false;
+        }
+    }
+#endif
+    s->reported = s->filtered;
+    s->sent_us = now_us;
+    s->sent++;
+    return true;
+}
+
+int report_format(int ch, char *buf, size_t len)
+{
+    const report_state_t *s = &s_states[ch];
+    if (s->sent == 0)
+    {
+        return 0;
+    }
+    return snprintf(buf, len, "N:%s sent=%lu skipped=%lu\n", hydro_channels[ch].name, (unsigned long)s->sent,
+                    (unsigned long)s->skipped);
+}
@@ -0,0 +1,31 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * When a sensor reading goes out on the telemetry link.
+ *
+ * X(role, alpha, deadband, heartbeat_ms, min_interval_ms)
+ *
+ * Each reading updates an exponential filter, f += alpha * (x - f). A
+ * reading is sent when f has moved more than deadband since the last one
+ * sent, but no sooner than min_interval_ms after it; or when heartbeat_ms
+ * passed without a send. The state of each channel is only touched by the
+ * task that samples it.
+ */
+#define REPORT_POLICY_TABLE(X)                              \
+    X(HYDRO_ROLE_TEMPERATURE, 0.5f, 0.05f, 60000, 0)        \
+    X(HYDRO_ROLE_PH, 0.3f, 0.05f, 30000, 0)                 \
+    X(HYDRO_ROLE_WATER_LEVEL, 1.0f, 0.0f, 60000, 0)         \
+    X(HYDRO_ROLE_LIGHT, 0.25f, 50.0f, 30000, 1000)
+
+// Whether the reading of a channel taken at now_us should be sent
+bool report_due(int ch, float value, int64_t now_us);
+
+// Format the sent/skipped counts of a channel. Returns 0 if it has none.
+int report_format(int ch, char *buf, size_t len);
+
+#endif // REPORT_POLICY_H
@@ -0,0 +1,120 @@
+#include "reservoir.h"
+
+#include <math.h>
+#include <string.h>
+
+#define KW 1e-14 // ionic product of water
+
+const reservoir_params_t reservoir_defaults = {
+#define RESERVOIR_PARAM_DEFAULT(field, def) .field = def,
+    RESERVOIR_PARAM_TABLE(RESERVOIR_PARAM_DEFAULT)
+#undef RESERVOIR_PARAM_DEFAULT
+};
+
+static const double s_pump_ml_s[RESERVOIR_PUMP_COUNT] = {
+#define RESERVOIR_PUMP_FLOW(pump, ml_s, mmol_ml) [pump] = ml_s,
+    RESERVOIR_PUMP_TABLE(RESERVOIR_PUMP_FLOW)
+#undef RESERVOIR_PUMP_FLOW
+};
+
+static const double s_pump_mmol_ml[RESERVOIR_PUMP_COUNT] = {
+#define RESERVOIR_PUMP_STRENGTH(pump, ml_s, mmol_ml) [pump] = mmol_ml,
+    RESERVOIR_PUMP_TABLE(RESERVOIR_PUMP_STRENGTH)
+#undef RESERVOIR_PUMP_STRENGTH
+};
+
+static double ambient_c(const reservoir_params_t *p, double t_s)
+{
+    double hours = fmod(t_s / 3600.0, 24.0);
+    return p->ambient_c + p->ambient_swing_c * cos(2 * M_PI * (hours - 15.0) / 24.0);
+}
+
+// mmol of base that move a litre by one pH unit at pH ph
+static double buffer_capacity(const reservoir_t *r, double ph)
+{
+    // The buffer concentrates as water evaporates and dilutes with doses
+    double c = r->p.buffer_mmol_l * r->p.volume_l / r->volume_l / 1000.0;
+    double h = pow(10.0, -ph);
+    double ka = pow(10.0, -r->p.buffer_pka);
+    return 2.303 * (c * ka * h / ((ka + h) * (ka + h)) + h + KW / h) * 1000.0;
+}
+
+void reservoir_init(reservoir_t *r, const reservoir_params_t *p, double ph)
+{
+    memset(r, 0, sizeof(*r));
+    r->p = *p;
+    r->ph = ph;
+    r->temp_c = ambient_c(p, 0);
+    r->volume_l = p->volume_l;
+}
+
+static void step(reservoir_t *r, double dt)
+{
+    for (int pump = 0; pump < RESERVOIR_PUMP_COUNT; pump++)
+    {
+        if (r->pump_on[pump])
+        {
+            double ml = s_pump_ml_s[pump] * dt;
+            r->pumped_ml[pump] += ml;
+            r->volume_l += ml / 1000.0;
+            r->unmixed_mmol += ml * s_pump_mmol_ml[pump];
+        }
+    }
+
+    double mixed = r->unmixed_mmol * -expm1(-dt / r->p.mix_s);
+    r->unmixed_mmol -= mixed;
+    if (r->volume_l > 0)
+    {
+        r->ph += mixed / (buffer_capacity(r, r->ph) * r->volume_l);
+    }
+    r->ph += (r->p.drift_ph - r->ph) * -expm1(-dt / (r->p.drift_h * 3600.0));
+
+    r->temp_c += (ambient_c(&r->p, r->t_s) - r->temp_c) * -expm1(-dt / (r->p.thermal_h * 3600.0));
+    r->volume_l -= r->p.evap_l_day / 86400.0 * dt * (1.0 + 0.07 * (r->temp_c - 20.0));
+    if (r->volume_l < 0)
+    {
+        r->volume_l = 0;
+    }
+    r->t_s += dt;
+}
+
+void reservoir_run(reservoir_t *r, double t_s)
+{
+    while (r->t_s < t_s)
+    {
+        step(r, fmin(RESERVOIR_STEP_S, t_s - r->t_s));
+    }
+}
+
+void reservoir_set_pump(reservoir_t *r, reservoir_pump_t pump, bool on)
+{
+    r->pump_on[pump] = on;
+}
+
+bool reservoir_param_set(reservoir_params_t *p, const char *name, double value)
+{
+#define RESERVOIR_PARAM_SET(field, def) \
+    if (strcmp(name, #field) == 0)      \
+    {                                   \
+        p->field = value;               \
+        return true;                    \
+    }
+    RESERVOIR_PARAM_TABLE(RESERVOIR_PARAM_SET)
+#undef RESERVOIR_PARAM_SET
+    return false;
+}
+
+bool reservoir_level_ok(const reservoir_t *r)
+{
+    return r->volume_l >= r->p.low_level_l;
+}
+
+double reservoir_light(const reservoir_t *r)
+{
+    double hours = fmod(r->t_s / 3600.0, 24.0);
+    if (hours < 6.0 || hours > 20.0)
+    {
+        return 0;
+    }
+    return r->p.day_counts * sin(M_PI * (hours - 6.0) / 14.0);
+}
@@ -0,0 +1,95 @@
+#ifndef RESERVOIR_H
+#define RESERVOIR_H
+
+#include <stdbool.h>
+
+/*
+ * Model of one tank, for the linux target (hydro_io_sim.c) and
+ * tools/reservoir_sim. Pure C with no IDF dependencies.
+ *
+ * - pH: acid and base move the pH by dose / (beta * volume), where beta is
+ *   the buffer capacity of a weak acid of concentration buffer_mmol_l and
+ *   pKa buffer_pka, plus water. Without doses the pH relaxes towards
+ *   drift_ph with time constant drift_h (CO2 exchange, nutrient uptake).
+ * - Mixing: a dose first goes into an unmixed pool that reaches the probe
+ *   with time constant mix_s.
+ * - Pumps: each runs at its flow rate and carries its reagent strength in
+ *   mmol of base per ml (negative for acid), see RESERVOIR_PUMP_TABLE.
+ * - Temperature: follows the room with time constant thermal_h; the room
+ *   swings by ambient_swing_c around ambient_c, warmest at 15:00.
+ * - Evaporation: evap_l_day at 20 C, 7% more per degree. The float switch
+ *   opens below low_level_l.
+ * - Light: daylight from 06:00 to 20:00 peaking at day_counts.
+ *
+ * Time counts in seconds from midnight of the first day.
+ *
+ * X(field, default)
+ */
+#define RESERVOIR_PARAM_TABLE(X) \
+    X(volume_l, 40.0)            \
+    X(buffer_mmol_l, 2.0)        \
+    X(buffer_pka, 6.8)           \
+    X(drift_ph, 7.2)             \
+    X(drift_h, 24.0)             \
+    X(mix_s, 120.0)              \
+    X(ambient_c, 22.0)           \
+    X(ambient_swing_c, 3.0)      \
+    X(thermal_h, 3.0)            \
+    X(evap_l_day, 0.5)           \
+    X(low_level_l, 30.0)         \
+    X(day_counts, 3000.0)
+
+// X(pump, ml_s, mmol_ml)
+#define RESERVOIR_PUMP_TABLE(X)           \
+    X(RESERVOIR_PUMP_UP, 1.5, 0.5)        \
+    X(RESERVOIR_PUMP_DOWN, 1.5, -0.5)     \
+    X(RESERVOIR_PUMP_FOOD, 1.5, -0.05)
+
+// Longest step of the integration
+#define RESERVOIR_STEP_S 0.1
+
+typedef enum
+{
+#define RESERVOIR_PUMP_ENUM(pump, ml_s, mmol_ml) pump,
+    RESERVOIR_PUMP_TABLE(RESERVOIR_PUMP_ENUM)
+#undef RESERVOIR_PUMP_ENUM
+    RESERVOIR_PUMP_COUNT,
+} reservoir_pump_t;
+
+typedef struct
+{
+#define RESERVOIR_PARAM_FIELD(field, def) double field;
+    RESERVOIR_PARAM_TABLE(RESERVOIR_PARAM_FIELD)
+#undef RESERVOIR_PARAM_FIELD
+} reservoir_params_t;
+
+extern const reservoir_params_t reservoir_defaults;
+
+typedef struct
+{
+    reservoir_params_t p;
+    double t_s;
+    double ph;
+    double temp_c;
+    double volume_l;
+    double unmixed_mmol; // dosed but not yet at the probe
+    bool pump_on[RESERVOIR_PUMP_COUNT];
+    double pumped_ml[RESERVOIR_PUMP_COUNT];
+} reservoir_t;
+
+// Start at time 0 with pH ph, the water at room temperature
+void reservoir_init(reservoir_t *r, const reservoir_params_t *p, double ph);
+
+// Advance to t_s with the pumps as they are
+void reservoir_run(reservoir_t *r, double t_s);
+
+// Call reservoir_run() up to the switch time first
+void reservoir_set_pump(reservoir_t *r, reservoir_pump_t pump, bool on);
+
+// Set a parameter by field name. Returns false if there is none.
+bool reservoir_param_set(reservoir_params_t *p, const char *name, double value);
+
+bool reservoir_level_ok(const reservoir_t *r);
+double reservoir_light(const reservoir_t *r);
+
+#endif // RESERVOIR_H
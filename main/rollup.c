@@ -0,0 +1,152 @@
+#include "rollup.h"
+#include <stdio.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "mem_budget.h"
+
+#define ROLLUP_SENSORS (HYDRO_ROLE_LIGHT + 1)
+#define ROLLUP_SLOTS (HYDRO_TANK_COUNT * ROLLUP_SENSORS)
+
+#define ROLLUP_DEPTH_TOTAL(tier, letter, seconds, depth) +(depth)
+#define ROLLUP_RING_SIZE (0 ROLLUP_TIER_TABLE(ROLLUP_DEPTH_TOTAL))
+
+typedef struct
+{
+    uint32_t start_s;
+    uint32_t count;
+    float min;
+    float max;
+    double sum;
+} rollup_bucket_t;
+
+typedef struct
+{
+    rollup_bucket_t open[ROLLUP_TIER_COUNT];
+    rollup_bucket_t closed[ROLLUP_RING_SIZE]; // one ring per tier, back to back
+    uint32_t closed_count[ROLLUP_TIER_COUNT];
+} rollup_slot_t;
+
+static const struct
+{
+    char letter;
+    uint32_t seconds;
+    uint16_t depth;
+} s_tiers[ROLLUP_TIER_COUNT] = {
+#define ROLLUP_TIER_ROW(tier, letter, seconds, depth) [ROLLUP_TIER_##tier] = {letter, seconds, depth},
+    ROLLUP_TIER_TABLE(ROLLUP_TIER_ROW)
+#undef ROLLUP_TIER_ROW
+};
+
+static rollup_slot_t s_slots[ROLLUP_SLOTS];
+MEM_BUFFER_CHECK(ROLLUP, s_slots);
+static uint16_t s_offsets[ROLLUP_TIER_COUNT]; // of each tier's ring in closed[]
+static portMUX_TYPE s_rollup_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void rollup_init(void)
+{
+    uint16_t offset = 0;
+    for (int tier = 0; tier < ROLLUP_TIER_COUNT; tier++)
+    {
+        s_offsets[tier] = offset;
+        offset += s_tiers[tier].depth;
+    }
+}
+
+// Three bucket updates per sample, plus a copy into the ring for each tier
+// whose period just ended
+void rollup_add(int ch, float value)
+{
+    const hydro_channel_t *c = &hydro_channels[ch];
+    if (!HYDRO_ROLE_IS_SENSOR(c->role))
+    {
+        return;
+    }
+    rollup_slot_t *slot = &s_slots[c->tank * ROLLUP_SENSORS + c->role];
+    uint32_t now = (uint32_t)time(NULL);
+
+    portENTER_CRITICAL(&s_rollup_lock);
+    for (int tier = 0; tier < ROLLUP_TIER_COUNT; tier++)
+    {
+        rollup_bucket_t *b = &slot->open[tier];
+        uint32_t start = now - now % s_tiers[tier].seconds;
+        if (b->count && b->start_s != start)
+        {
+            slot->closed[s_offsets[tier] + slot->closed_count[tier] % s_tiers[tier].depth] = *b;
+            slot->closed_count[tier]++;
+            b->count = 0;
+        }
+        if (b->count == 0)
+        {
+            *b = (rollup_bucket_t){.start_s = start, .min = value, .max = value};
+        }
+        b->min = value < b->min ? value : b->min;
+        b->max = value > b->max ? value : b->max;
+        b->sum += value;
+        b->count++;
+    }
+    portEXIT_CRITICAL(&s_rollup_lock);
+}
+
+int rollup_tier(char letter)
+{
+    for (int tier = 0; tier < ROLLUP_TIER_COUNT; tier++)
+    {
+        if (s_tiers[tier].letter == letter)
+        {
+            return tier;
+        }
+    }
+    return -1;
+}
+
+static void write_bucket(const char *name, char letter, const rollup_bucket_t *b,
+                         void (*write_line)(const char *line, int len))
+{
+    char line[96];
+    int n = snprintf(line, sizeof(line), "A:%s,%c,%lu,%lu,%.2f,%.2f,%.2f\n", name, letter, (unsigned long)b->start_s,
+                     (unsigned long)b->count, b->min, b->max, b->sum / b->count);
+    write_line(line, n);
+}
+
+void rollup_dump(rollup_tier_t tier, int max, void (*write_line)(const char *line, int len))
+{
+    uint32_t depth = s_tiers[tier].depth;
+    if (max <= 0 || (uint32_t)max > depth)
+    {
+        max = depth;
+    }
+
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        const hydro_channel_t *c = &hydro_channels[ch];
+        if (!HYDRO_ROLE_IS_SENSOR(c->role))
+        {
+            continue;
+        }
+        rollup_slot_t *slot = &s_slots[c->tank * ROLLUP_SENSORS + c->role];
+
+        portENTER_CRITICAL(&s_rollup_lock);
+        uint32_t closed = slot->closed_count[tier];
+        rollup_bucket_t open = slot->open[tier];
+        portEXIT_CRITICAL(&s_rollup_lock);
+
+        uint32_t first = closed > (uint32_t)max ? closed - max : 0;
+        for (uint32_t i = first; i < closed; i++)
+        {
+            portENTER_CRITICAL(&s_rollup_lock);
+            rollup_bucket_t b = slot->closed[s_offsets[tier] + i % depth];
+            // Overwritten while the previous lines were sent
+            bool gone = slot->closed_count[tier] >= i + depth + 1;
+            portEXIT_CRITICAL(&s_rollup_lock);
+            if (!gone)
+            {
+                write_bucket(c->name, s_tiers[tier].letter, &b, write_line);
+            }
+        }
+        if (open.count)
+        {
+            write_bucket(c->name, s_tiers[tier].letter, &open, write_line);
+        }
+    }
+    write_line("A:end\n", 6);
+}
@@ -0,0 +1,43 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdint.h>
+#include "hydro_channels.h"
+
+/*
+ * Min/max/mean/count of every sensor channel at several resolutions.
+ *
+ * X(tier, letter, seconds, depth)
+ *
+ * Each sample updates the open bucket of every tier; a bucket closes when a
+ * sample falls into the next period and is kept in a ring of the last depth
+ * buckets of its tier. Buckets are aligned to the epoch clock.
+ */
+#define ROLLUP_TIER_TABLE(X)       \
+    X(SECOND, 'S', 1, 60)          \
+    X(MINUTE, 'M', 60, 60)         \
+    X(HOUR, 'H', 3600, 24)
+
+typedef enum
+{
+#define ROLLUP_TIER_ENUM(tier, letter, seconds, depth) ROLLUP_TIER_##tier,
+    ROLLUP_TIER_TABLE(ROLLUP_TIER_ENUM)
+#undef ROLLUP_TIER_ENUM
+    ROLLUP_TIER_COUNT,
+} rollup_tier_t;
+
+// Call once from app_main before any task adds samples
+void rollup_init(void);
+
+// Add a sample of a channel. Ignored for actuator channels.
+void rollup_add(int ch, float value);
+
+// Tier for its command letter, or -1
+int rollup_tier(char letter);
+
+// Send the last max closed buckets of a tier for every sensor channel, then
+// the open one, as "A:<channel>,<tier>,<start>,<count>,<min>,<max>,<mean>"
+// lines ending with "A:end". max 0 sends the whole ring.
+void rollup_dump(rollup_tier_t tier, int max, void (*write_line)(const char *line, int len));
+
+#endif // ROLLUP_H
@@ -0,0 +1,345 @@
+#include "rule_vm.h"
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hydro_channels.h"
+
+static_assert(HYDRO_CHANNEL_COUNT <= 32, "inputs are a 32-bit mask");
+
+// Recursive descent over the rule text, one token of lookahead
+typedef struct
+{
+    const char *pos;   // after the current token
+    const char *token; // current token, len characters
+    int len;
+    int depth;   // stack depth of the code emitted so far
+    int nesting; // open parentheses and nots
+    const char *error;
+    rule_program_t *out;
+} parser_t;
+
+static const struct
+{
+    const char *text;
+    rule_op_t op;
+} s_compares[] = {
+    {"<", RULE_OP_LT}, {"<=", RULE_OP_LE}, {">", RULE_OP_GT},
+    {">=", RULE_OP_GE}, {"==", RULE_OP_EQ}, {"!=", RULE_OP_NE},
+};
+
+static void next(parser_t *p)
+{
+    const char *s = p->pos;
+    while (*s == ' ')
+    {
+        s++;
+    }
+    p->token = s;
+    if (isalpha((unsigned char)*s) || *s == '_')
+    {
+        while (isalnum((unsigned char)*s) || *s == '_')
+        {
+            s++;
+        }
+    }
+    else if (isdigit((unsigned char)*s) || *s == '.' || *s == '-')
+    {
+        char *end;
+        strtof(s, &end);
+        s = end > s ? end : s + 1;
+    }
+    else if (*s && strchr("<>=!", *s) && s[1] == '=')
+    {
+        s += 2;
+    }
+    else if (*s)
+    {
+        s++;
+    }
+    p->len = s - p->token;
+    p->pos = s;
+}
+
+static bool is(const parser_t *p, const char *text)
+{
+    return (int)strlen(text) == p->len && strncmp(p->token, text, p->len) == 0;
+}
+
+// Records the first error and skips to the end, which ends every loop
+static void fail(parser_t *p)
+{
+    if (p->error == NULL)
+    {
+        p->error = p->token;
+    }
+    p->pos = p->token + strlen(p->token);
+    next(p);
+}
+
+static void emit(parser_t *p, uint8_t byte, int stack_change)
+{
+    rule_program_t *out = p->out;
+    p->depth += stack_change;
+    if (out->code_len == RULE_CODE_MAX || p->depth > RULE_STACK_MAX)
+    {
+        fail(p);
+        return;
+    }
+    out->code[out->code_len++] = byte;
+}
+
+static int find_channel(const parser_t *p)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (is(p, hydro_channels[ch].name))
+        {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+static void operand(parser_t *p)
+{
+    int ch = find_channel(p);
+    char *end;
+    float value = strtof(p->token, &end);
+    if (ch >= 0)
+    {
+        emit(p, RULE_OP_LOAD, 1);
+        emit(p, ch, 0);
+        p->out->inputs |= 1u << ch;
+    }
+    else if (p->len > 0 && end == p->token + p->len)
+    {
+        uint8_t bytes[sizeof(value)];
+        memcpy(bytes, &value, sizeof(value));
+        emit(p, RULE_OP_CONST, 1);
+        for (size_t i = 0; i < sizeof(bytes); i++)
+        {
+            emit(p, bytes[i], 0);
+        }
+    }
+    else
+    {
+        fail(p);
+        return;
+    }
+    next(p);
+}
+
+static void comparison(parser_t *p)
+{
+    operand(p);
+    for (size_t i = 0; i < sizeof(s_compares) / sizeof(s_compares[0]); i++)
+    {
+        if (is(p, s_compares[i].text))
+        {
+            next(p);
+            operand(p);
+            emit(p, s_compares[i].op, -1);
+            return;
+        }
+    }
+    fail(p);
+}
+
+static void condition(parser_t *p);
+
+static void factor(parser_t *p)
+{
+    bool not = is(p, "not");
+    if (!not && !is(p, "("))
+    {
+        comparison(p);
+        return;
+    }
+    if (++p->nesting > RULE_STACK_MAX)
+    {
+        fail(p);
+        return;
+    }
+    next(p);
+    if (not)
+    {
+        factor(p);
+        emit(p, RULE_OP_NOT, 0);
+    }
+    else
+    {
+        condition(p);
+        if (!is(p, ")"))
+        {
+            fail(p);
+        }
+        next(p);
+    }
+    p->nesting--;
+}
+
+static void term(parser_t *p)
+{
+    factor(p);
+    while (is(p, "and"))
+    {
+        next(p);
+        factor(p);
+        emit(p, RULE_OP_AND, -1);
+    }
+}
+
+static void condition(parser_t *p)
+{
+    term(p);
+    while (is(p, "or"))
+    {
+        next(p);
+        term(p);
+        emit(p, RULE_OP_OR, -1);
+    }
+}
+
+static void action(parser_t *p)
+{
+    rule_program_t *out = p->out;
+    rule_action_t *a = &out->actions[out->action_count];
+    if (out->action_count == RULE_ACTIONS_MAX)
+    {
+        fail(p);
+        return;
+    }
+    a->kind = is(p, "off") ? RULE_ACTION_OFF : is(p, "on") ? RULE_ACTION_ON : RULE_ACTION_DOSE;
+    if (a->kind == RULE_ACTION_DOSE && !is(p, "dose"))
+    {
+        fail(p);
+        return;
+    }
+    next(p);
+    int ch = find_channel(p);
+    hydro_role_t role = ch < 0 ? HYDRO_ROLE_COUNT : hydro_channels[ch].role;
+    bool valid = a->kind == RULE_ACTION_OFF    ? ch >= 0 && !HYDRO_ROLE_IS_SENSOR(role)
+                 : a->kind == RULE_ACTION_ON ? role == HYDRO_ROLE_GROW_LIGHT
+                                               : HYDRO_ROLE_IS_PUMP(role);
+    if (!valid)
+    {
+        fail(p);
+        return;
+    }
+    a->ch = ch;
+    next(p);
+    if (a->kind == RULE_ACTION_DOSE)
+    {
+        // The limits of the DOSE command
+        char *end;
+        long ms = strtol(p->token, &end, 10);
+        if (end != p->token + p->len || ms < 10 || ms > 60000)
+        {
+            fail(p);
+            return;
+        }
+        a->ms = ms;
+        next(p);
+    }
+    out->action_count++;
+}
+
+const char *rule_compile(const char *text, rule_program_t *out)
+{
+    parser_t p = {.pos = text, .out = out};
+    memset(out, 0, sizeof(*out));
+    next(&p);
+    condition(&p);
+    if (is(&p, "for"))
+    {
+        next(&p);
+        char *end;
+        float seconds = strtof(p.token, &end);
+        if (end != p.token + p.len || !(seconds >= 0 && seconds <= 86400))
+        {
+            fail(&p);
+        }
+        out->hold_ms = seconds * 1000;
+        next(&p);
+    }
+    if (!is(&p, "then"))
+    {
+        fail(&p);
+    }
+    next(&p);
+    action(&p);
+    while (is(&p, ","))
+    {
+        next(&p);
+        action(&p);
+    }
+    if (p.len > 0)
+    {
+        fail(&p);
+    }
+    return p.error;
+}
+
+bool rule_eval(const rule_program_t *p, const float *values)
+{
+    float stack[RULE_STACK_MAX];
+    int sp = 0;
+    for (int pc = 0; pc < p->code_len;)
+    {
+        rule_op_t op = p->code[pc++];
+        if (op == RULE_OP_LOAD)
+        {
+            stack[sp++] = values[p->code[pc++]];
+            continue;
+        }
+        if (op == RULE_OP_CONST)
+        {
+            memcpy(&stack[sp++], &p->code[pc], sizeof(float));
+            pc += sizeof(float);
+            continue;
+        }
+        if (op == RULE_OP_NOT)
+        {
+            stack[sp - 1] = stack[sp - 1] == 0;
+            continue;
+        }
+        float b = stack[--sp];
+        float a = stack[sp - 1];
+        if (op <= RULE_OP_NE && (isnan(a) || isnan(b)))
+        {
+            stack[sp - 1] = 0;
+            continue;
+        }
+        switch (op)
+        {
+        case RULE_OP_LT:
+            a = a < b;
+            break;
+        case RULE_OP_LE:
+            a = a <= b;
+            break;
+        case RULE_OP_GT:
+            a = a > b;
+            break;
+        case RULE_OP_GE:
+            a = a >= b;
+            break;
+        case RULE_OP_EQ:
+            a = a == b;
+            break;
+        case RULE_OP_NE:
+            a = a != b;
+            break;
+        case RULE_OP_AND:
+            a = a != 0 && b != 0;
+            break;
+        default: // RULE_OP_OR
+            a = a != 0 || b != 0;
+            break;
+        }
+        stack[sp - 1] = a;
+    }
+    return sp == 1 && stack[0] != 0;
+}
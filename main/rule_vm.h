@@ -0,0 +1,83 @@
+#ifndef RULE_VM_H
+#define RULE_VM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Compiler and interpreter of automation rules. Pure C with no IDF
+ * dependencies: rules.c runs the rules on the device and tools/kernel_bench
+ * times them on the host.
+ *
+ * A rule is one line:
+ *
+ *   <condition> [for <seconds>] then <action>[, <action>]...
+ *
+ *   condition  comparisons of channels (HYDRO_CHANNEL_TABLE names) and
+ *              numbers with < <= > >= == !=, combined with and, or, not and
+ *              parentheses; and binds tighter than or
+ *   for        the condition must hold this long before the rule fires
+ *   action     off <output>        hold an output off while the rule is active
+ *              on <grow light>     hold a grow light on while it is active
+ *              dose <pump> <ms>    run a pump once when the rule fires
+ *
+ * e.g. "T0_WATER_LEVEL == 0 for 5 then off T0_PH_UP, off T0_PH_DOWN".
+ *
+ * The condition compiles to bytecode for a stack machine of floats:
+ * RULE_OP_LOAD <channel>, RULE_OP_CONST <4-byte float>, and one byte for
+ * every operator, in postfix order. Code and stack are bounded at compile
+ * time, so one evaluation runs at most RULE_CODE_MAX instructions. The
+ * channels a condition reads are kept as a mask, so a rule is only
+ * evaluated again when one of them changes.
+ */
+#define RULE_CODE_MAX 64
+#define RULE_STACK_MAX 8
+#define RULE_ACTIONS_MAX 4
+
+typedef enum
+{
+    RULE_OP_LOAD,
+    RULE_OP_CONST,
+    RULE_OP_LT,
+    RULE_OP_LE,
+    RULE_OP_GT,
+    RULE_OP_GE,
+    RULE_OP_EQ,
+    RULE_OP_NE,
+    RULE_OP_AND,
+    RULE_OP_OR,
+    RULE_OP_NOT,
+} rule_op_t;
+
+typedef enum
+{
+    RULE_ACTION_OFF,
+    RULE_ACTION_ON,
+    RULE_ACTION_DOSE,
+} rule_action_kind_t;
+
+typedef struct
+{
+    uint8_t kind; // rule_action_kind_t
+    uint8_t ch;
+    uint16_t ms; // RULE_ACTION_DOSE only
+} rule_action_t;
+
+typedef struct
+{
+    uint8_t code[RULE_CODE_MAX];
+    uint8_t code_len;
+    uint8_t action_count;
+    rule_action_t actions[RULE_ACTIONS_MAX];
+    uint32_t hold_ms;
+    uint32_t inputs; // bit per channel the condition reads
+} rule_program_t;
+
+// Returns NULL on success, or the text from where compiling failed
+const char *rule_compile(const char *text, rule_program_t *out);
+
+// Evaluate the condition on the latest value of every channel. Channels
+// with no value yet are NAN, which makes every comparison with them false.
+bool rule_eval(const rule_program_t *p, const float *values);
+
+#endif // RULE_VM_H
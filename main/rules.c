@@ -0,0 +1,338 @@
+#include "rules.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "hydro_channels.h"
+#include "rule_vm.h"
+#include "state_store.h"
+#include "task_topology.h"
+#include "trace.h"
+
+#if CONFIG_HYDRO_RULES
+
+#define RULES_NAMESPACE "rules"
+// What is left of a request line after "#<seq> RULE <slot> "
+#define RULE_TEXT_MAX 112
+#define RULES_ALL_CHANNELS (UINT32_MAX >> (32 - HYDRO_CHANNEL_COUNT))
+
+typedef struct
+{
+    char text[RULE_TEXT_MAX]; // empty for a free slot
+    rule_program_t program;
+    int64_t true_since_us; // 0 while the condition is false
+    bool fresh;            // not evaluated since it was installed
+    bool active;
+    uint32_t evals;
+    uint32_t eval_us_max;
+    uint64_t eval_us_total;
+} rule_slot_t;
+
+static const char *TAG = "rules";
+
+// Guarded by s_lock, taken by the rule task for a pass and by the command
+// task to change a slot
+static rule_slot_t s_rules[RULES_COUNT];
+MEM_BUFFER_CHECK(RULES, s_rules);
+static float s_values[HYDRO_CHANNEL_COUNT];
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_buf;
+
+static atomic_int s_output[HYDRO_CHANNEL_COUNT];
+static TaskHandle_t s_task;
+static void (*s_write_line)(const char *line, int len);
+
+static void report(int slot, bool active)
+{
+    char line[16];
+    int n = snprintf(line, sizeof(line), "E:%d %d\n", slot, active);
+    s_write_line(line, n);
+}
+
+// Off wins over on, so a safety rule cannot be overridden by another
+static void update_outputs(void)
+{
+    int level[HYDRO_CHANNEL_COUNT];
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        level[ch] = RULES_FREE;
+    }
+    for (int slot = 0; slot < RULES_COUNT; slot++)
+    {
+        const rule_program_t *p = &s_rules[slot].program;
+        for (int i = 0; s_rules[slot].active && i < p->action_count; i++)
+        {
+            const rule_action_t *a = &p->actions[i];
+            if (a->kind == RULE_ACTION_OFF)
+            {
+                level[a->ch] = 0;
+            }
+            else if (a->kind == RULE_ACTION_ON && level[a->ch] != 0)
+            {
+                level[a->ch] = 1;
+            }
+        }
+    }
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        atomic_store(&s_output[ch], level[ch]);
+    }
+}
+
+// Actions that run once when a rule fires, after the outputs it holds
+// are in place
+static void fire(const rule_program_t *p)
+{
+    for (int i = 0; i < p->action_count; i++)
+    {
+        const rule_action_t *a = &p->actions[i];
+        bool pump = hydro_channels[a->ch].role != HYDRO_ROLE_GROW_LIGHT;
+        if (a->kind == RULE_ACTION_OFF && pump)
+        {
+            state_request_dispense(a->ch, false);
+        }
+        else if (a->kind == RULE_ACTION_DOSE && rules_output(a->ch) != 0)
+        {
+            state_request_dose(a->ch, a->ms);
+        }
+    }
+}
+
+// Evaluates the rules reading a changed channel and fires or releases the
+// ones whose state changed. Returns how long to wait for the next rule to
+// come due, if no channel changes before.
+static TickType_t rules_pass(uint32_t changed)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        state_sample_t sample;
+        if (changed & (1u << ch))
+        {
+            s_values[ch] = state_read(ch, &sample) ? sample.value : NAN;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t wait_us = INT64_MAX;
+    uint32_t fired = 0;
+    bool released = false;
+    for (int slot = 0; slot < RULES_COUNT; slot++)
+    {
+        rule_slot_t *r = &s_rules[slot];
+        if (r->text[0] == '\0')
+        {
+            continue;
+        }
+        if (r->fresh || (r->program.inputs & changed))
+        {
+            r->fresh = false;
+            int64_t start = esp_timer_get_time();
+            bool holds = rule_eval(&r->program, s_values);
+            uint32_t us = esp_timer_get_time() - start;
+            r->evals++;
+            r->eval_us_total += us;
+            r->eval_us_max = us > r->eval_us_max ? us : r->eval_us_max;
+            r->true_since_us = !holds ? 0 : r->true_since_us ? r->true_since_us : now;
+        }
+        int64_t due_us = r->true_since_us + r->program.hold_ms * 1000LL;
+        bool active = r->true_since_us != 0 && now >= due_us;
+        if (r->true_since_us != 0 && !active && due_us - now < wait_us)
+        {
+            wait_us = due_us - now;
+        }
+        if (active != r->active)
+        {
+            r->active = active;
+            fired |= active ? 1u << slot : 0;
+            released |= !active;
+            report(slot, active);
+        }
+    }
+    if (fired || released)
+    {
+        update_outputs();
+    }
+    for (int slot = 0; slot < RULES_COUNT; slot++)
+    {
+        if (fired & (1u << slot))
+        {
+            fire(&s_rules[slot].program);
+        }
+    }
+    return wait_us == INT64_MAX ? portMAX_DELAY : wait_us / 1000 / portTICK_PERIOD_MS + 1;
+}
+
+static void rules_task(void *arg)
+{
+    uint32_t changed = RULES_ALL_CHANNELS;
+    while (1)
+    {
+        trace_begin(RULES, changed);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        TickType_t wait = rules_pass(changed);
+        xSemaphoreGive(s_lock);
+        trace_end(RULES, changed);
+
+        changed = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &changed, wait);
+    }
+}
+
+static void on_change(int ch)
+{
+    if (s_task)
+    {
+        xTaskNotify(s_task, 1u << ch, eSetBits);
+    }
+}
+
+// Replaces a slot, releasing what the rule there held. text is empty to
+// clear it.
+static void install(int slot, const char *text, const rule_program_t *program)
+{
+    rule_slot_t *r = &s_rules[slot];
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool was_active = r->active;
+    memset(r, 0, sizeof(*r));
+    snprintf(r->text, sizeof(r->text), "%s", text);
+    r->program = *program;
+    r->fresh = true;
+    if (was_active)
+    {
+        update_outputs();
+        report(slot, false);
+    }
+    xSemaphoreGive(s_lock);
+    // Evaluate it now rather than on the next change
+    xTaskNotify(s_task, 0, eSetBits);
+}
+
+static void save(int slot, const char *text)
+{
+    char key[4];
+    nvs_handle_t nvs;
+    snprintf(key, sizeof(key), "r%d", slot);
+    esp_err_t err = nvs_open(RULES_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        err = text[0] ? nvs_set_str(nvs, key, text) : nvs_erase_key(nvs, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND)
+        {
+            err = ESP_OK;
+        }
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "rule %d not saved: %s", slot, esp_err_to_name(err));
+    }
+}
+
+static void load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(RULES_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return; // nothing saved yet
+    }
+    int loaded = 0;
+    for (int slot = 0; slot < RULES_COUNT; slot++)
+    {
+        char key[4];
+        char text[RULE_TEXT_MAX];
+        size_t len = sizeof(text);
+        rule_program_t program;
+        snprintf(key, sizeof(key), "r%d", slot);
+        if (nvs_get_str(nvs, key, text, &len) != ESP_OK)
+        {
+            continue;
+        }
+        const char *error = rule_compile(text, &program);
+        if (error)
+        {
+            ESP_LOGW(TAG, "rule %d: saved rule does not compile at \"%s\"", slot, error);
+            continue;
+        }
+        snprintf(s_rules[slot].text, sizeof(s_rules[slot].text), "%s", text);
+        s_rules[slot].program = program;
+        s_rules[slot].fresh = true;
+        loaded++;
+    }
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "%d saved rules", loaded);
+}
+
+void rules_start(void (*write_line)(const char *line, int len))
+{
+    s_write_line = write_line;
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        s_values[ch] = NAN;
+        atomic_store(&s_output[ch], RULES_FREE);
+    }
+    load();
+    topo_create_task(rules_task, "rules", MEM_TASK_RULES, NULL, TOPO_CLASS_CONTROL, &s_task);
+    state_set_listener(on_change);
+}
+
+int rules_set(int slot, const char *text)
+{
+    rule_program_t program;
+    const char *error = rule_compile(text, &program);
+    if (error || strlen(text) >= RULE_TEXT_MAX)
+    {
+        ESP_LOGW(TAG, "rule %d: error at \"%s\"", slot, error ? error : "");
+        return -1;
+    }
+    install(slot, text, &program);
+    save(slot, text);
+    return program.code_len;
+}
+
+void rules_clear(int slot)
+{
+    rule_program_t none = {0};
+    install(slot, "", &none);
+    save(slot, "");
+}
+
+int rules_list(void (*write_line)(const char *line, int len))
+{
+    char line[RULE_TEXT_MAX + 64];
+    int count = 0;
+    for (int slot = 0; slot < RULES_COUNT; slot++)
+    {
+        // Copied under the lock, sent without it
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        rule_slot_t r = s_rules[slot];
+        xSemaphoreGive(s_lock);
+        if (r.text[0] == '\0')
+        {
+            continue;
+        }
+        int n = snprintf(line, sizeof(line), "U:%d %d %lu %llu %lu %d %s\n", slot, r.active, (unsigned long)r.evals,
+                         (unsigned long long)r.eval_us_total, (unsigned long)r.eval_us_max, r.program.code_len,
+                         r.text);
+        write_line(line, n);
+        count++;
+    }
+    return count;
+}
+
+int rules_output(int ch)
+{
+    return atomic_load(&s_output[ch]);
+}
+
+#endif // CONFIG_HYDRO_RULES
@@ -0,0 +1,47 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include "sdkconfig.h"
+
+/*
+ * User automations: rules uploaded with the RULE command, compiled by
+ * rule_vm.c (syntax in rule_vm.h) and kept in NVS across reboots.
+ *
+ * A task waits for channels to change (state_set_listener()) and evaluates
+ * only the rules that read them. A rule fires once its condition has held
+ * for its "for" time and stays active until the condition is false; each
+ * change is sent as "E:<slot> <0|1>". While a rule is active its off and on
+ * actions hold their outputs: dispense() and light_control_led() ask
+ * rules_output() before driving a channel, and off wins over on. Its dose
+ * actions run once, when it fires.
+ */
+#define RULES_FREE (-1)
+
+#if CONFIG_HYDRO_RULES
+
+#define RULES_COUNT (CONFIG_HYDRO_RULE_COUNT)
+
+// Load the saved rules and start the rule task. Call after params_init(),
+// which opens NVS, and before the tasks that publish samples.
+void rules_start(void (*write_line)(const char *line, int len));
+
+// Compile a rule into a slot, replacing the one there, and save it. Returns
+// the size of its bytecode, or -1 if it does not compile.
+int rules_set(int slot, const char *text);
+void rules_clear(int slot);
+
+// One "U:<slot> <active> <evals> <total us> <max us> <bytes> <text>" line
+// per rule. Returns the number of rules.
+int rules_list(void (*write_line)(const char *line, int len));
+
+// The level an active rule holds an output at, or RULES_FREE
+int rules_output(int ch);
+
+#else
+
+#define rules_start(write_line) ((void)(write_line))
+#define rules_output(ch) ((void)(ch), RULES_FREE)
+
+#endif // CONFIG_HYDRO_RULES
+
+#endif // RULES_H
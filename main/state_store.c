@@ -0,0 +1,128 @@
+#include "state_store.h"
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+typedef struct
+{
+    atomic_uint lock; // odd while a publish is in progress
+    float value;
+    int64_t timestamp_us;
+} state_slot_t;
+
+static state_slot_t s_slots[HYDRO_CHANNEL_COUNT];
+static atomic_bool s_dispense[HYDRO_CHANNEL_COUNT];
+static atomic_uint s_dose_ms[HYDRO_CHANNEL_COUNT];
+static atomic_bool s_cancel[HYDRO_CHANNEL_COUNT];
+static atomic_bool s_flags[HYDRO_TANK_COUNT][STATE_FLAG_COUNT];
+
+// Serializes writers only; readers never take it.
+static portMUX_TYPE s_publish_lock = portMUX_INITIALIZER_UNLOCKED;
+static void (*s_on_change)(int ch);
+
+void state_set_listener(void (*on_change)(int ch))
+{
+    s_on_change = on_change;
+}
+
+void state_publish(int ch, float value, int64_t acquired_us)
+{
+    state_slot_t *slot = &s_slots[ch];
+
+    portENTER_CRITICAL(&s_publish_lock);
+    unsigned lock = atomic_load_explicit(&slot->lock, memory_order_relaxed);
+    bool changed = lock == 0 || slot->value != value;
+    atomic_store_explicit(&slot->lock, lock + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->value = value;
+    slot->timestamp_us = acquired_us;
+    atomic_store_explicit(&slot->lock, lock + 2, memory_order_release);
+    portEXIT_CRITICAL(&s_publish_lock);
+    if (changed && s_on_change)
+    {
+        s_on_change(ch);
+    }
+}
+
+bool state_read(int ch, state_sample_t *out)
+{
+    state_slot_t *slot = &s_slots[ch];
+    unsigned before, after;
+
+    do
+    {
+        before = atomic_load_explicit(&slot->lock, memory_order_acquire);
+        out->value = slot->value;
+        out->timestamp_us = slot->timestamp_us;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&slot->lock, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    out->seq = before / 2;
+    return out->seq != 0;
+}
+
+bool state_read_fresh(int ch, int64_t max_age_us, state_sample_t *out)
+{
+    if (!state_read(ch, out))
+    {
+        return false;
+    }
+    return esp_timer_get_time() - out->timestamp_us <= max_age_us;
+}
+
+// A plain request keeps the length of a dose still pending; dropping the
+// request, done or held off, clears it for the next one
+void state_request_dispense(int ch, bool request)
+{
+    if (!request)
+    {
+        atomic_store(&s_dose_ms[ch], 0);
+    }
+    else
+    {
+        atomic_store(&s_cancel[ch], false);
+    }
+    atomic_store(&s_dispense[ch], request);
+}
+
+// The length is stored before the request, so the pump never sees a new
+// request with the previous length
+void state_request_dose(int ch, uint32_t ms)
+{
+    atomic_store(&s_dose_ms[ch], ms);
+    atomic_store(&s_cancel[ch], false);
+    atomic_store(&s_dispense[ch], true);
+}
+
+// Stays set until the next request, so it also stops a dose that is running
+void state_cancel_dispense(int ch)
+{
+    atomic_store(&s_cancel[ch], true);
+    state_request_dispense(ch, false);
+}
+
+bool state_dispense_cancelled(int ch)
+{
+    return atomic_load(&s_cancel[ch]);
+}
+
+bool state_dispense_requested(int ch)
+{
+    return atomic_load(&s_dispense[ch]);
+}
+
+uint32_t state_dose_ms(int ch)
+{
+    return atomic_load(&s_dose_ms[ch]);
+}
+
+void state_set_flag(int tank, state_flag_t flag, bool value)
+{
+    atomic_store(&s_flags[tank][flag], value);
+}
+
+bool state_get_flag(int tank, state_flag_t flag)
+{
+    return atomic_load(&s_flags[tank][flag]);
+}
@@ -0,0 +1,62 @@
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hydro_channels.h"
+
+/*
+ * Shared state of the controller: the latest sample of every channel plus
+ * the flags the command task uses to drive the workers.
+ *
+ * Each channel slot is a seqlock. Publishing takes a short spinlock so the
+ * grow light can be driven from two tasks; readers never take it and never
+ * block a writer. They retry only if they raced with a publish, and always
+ * get a value, timestamp and sequence number from the same sample.
+ */
+
+typedef struct
+{
+    float value;
+    int64_t timestamp_us; // esp_timer_get_time() at acquisition
+    uint32_t seq;         // 1 for the first sample, 0 if never published
+} state_sample_t;
+
+typedef enum
+{
+    STATE_FLAG_AUTO_PH,     // run the pH controller
+    STATE_FLAG_TOGGLE_LEDS, // blink the grow light
+    STATE_FLAG_COUNT,
+} state_flag_t;
+
+// Publish a new sample for a channel. acquired_us is esp_timer_get_time()
+// when the sampling task started the read, so the age and freshness checks
+// include the conversion time. Not for use from ISRs.
+void state_publish(int ch, float value, int64_t acquired_us);
+
+// Called from state_publish() when a channel's first value, or a value
+// different from its previous one, is published, once readers can see it.
+// Set before the tasks start.
+void state_set_listener(void (*on_change)(int ch));
+
+// Copy the latest sample of a channel. Returns false if nothing was published yet.
+bool state_read(int ch, state_sample_t *out);
+
+// Like state_read(), but also fails if the sample is older than max_age_us.
+bool state_read_fresh(int ch, int64_t max_age_us, state_sample_t *out);
+
+// Pending pump pulse for an actuator channel. A pulse requested with
+// state_request_dose() lasts ms; state_dose_ms() is 0 for the default length.
+void state_request_dispense(int ch, bool request);
+void state_request_dose(int ch, uint32_t ms);
+bool state_dispense_requested(int ch);
+uint32_t state_dose_ms(int ch);
+
+// Drop the pending pulse and stop a running one. Cleared by the next request.
+void state_cancel_dispense(int ch);
+bool state_dispense_cancelled(int ch);
+
+void state_set_flag(int tank, state_flag_t flag, bool value);
+bool state_get_flag(int tank, state_flag_t flag);
+
+#endif // STATE_STORE_H
@@ -0,0 +1,165 @@
+#include "task_topology.h"
+#include <stdio.h>
+#include "esp_check.h"
+#include "latency_hist.h"
+#include "sdkconfig.h"
+
+#define TOPO_SIDE_SENSE (CONFIG_HYDRO_SENSE_CORE)
+#define TOPO_SIDE_COMMS (1 - CONFIG_HYDRO_SENSE_CORE)
+
+static const int s_sides[TOPO_CLASS_COUNT] = {
+#define TOPO_CLASS_ROW(cls, side, deadline_ms) [TOPO_CLASS_##cls] = TOPO_SIDE_##side,
+    TOPO_CLASS_TABLE(TOPO_CLASS_ROW)
+#undef TOPO_CLASS_ROW
+};
+
+typedef struct
+{
+    int64_t last_us;
+    int64_t sum_us;
+    uint32_t count; // intervals recorded
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t max_dev_us; // largest |interval - period|
+    uint32_t period_ms;
+} topo_jitter_t;
+
+static topo_jitter_t s_jitter[TOPO_JITTER_SLOTS];
+static portMUX_TYPE s_jitter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_HYDRO_TOPOLOGY_SPLIT
+static uint32_t deadline_ms(topo_class_t cls)
+{
+    switch (cls)
+    {
+#define TOPO_CLASS_CASE(cls, side, deadline_ms) \
+    case TOPO_CLASS_##cls:                      \
+        return deadline_ms;
+        TOPO_CLASS_TABLE(TOPO_CLASS_CASE)
+#undef TOPO_CLASS_CASE
+    default:
+        return UINT32_MAX;
+    }
+}
+#endif
+
+UBaseType_t topo_priority(topo_class_t cls)
+{
+#if CONFIG_HYDRO_TOPOLOGY_SPLIT
+    UBaseType_t priority = TOPO_PRIORITY_BASE;
+    for (int i = 0; i < TOPO_CLASS_COUNT; i++)
+    {
+        if (deadline_ms(i) > deadline_ms(cls))
+        {
+            priority++;
+        }
+    }
+    return priority;
+#else
+    return cls == TOPO_CLASS_COMMS ? 10 : 5;
+#endif
+}
+
+BaseType_t topo_core(topo_class_t cls)
+{
+#if CONFIG_HYDRO_TOPOLOGY_SPLIT && !CONFIG_FREERTOS_UNICORE
+    return s_sides[cls];
+#else
+    return tskNO_AFFINITY;
+#endif
+}
+
+BaseType_t topo_create_task(TaskFunction_t fn, const char *name, mem_task_t mem, void *arg,
+                            topo_class_t cls, TaskHandle_t *handle)
+{
+    return mem_create_task(fn, name, mem, arg, topo_priority(cls), topo_core(cls), handle);
+}
+
+static void release(void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+void topo_period_wait(topo_period_t *p, int slot, uint32_t period_ms)
+{
+    if (!p->timer)
+    {
+        const esp_timer_create_args_t args = {
+            .callback = release,
+            .arg = xTaskGetCurrentTaskHandle(),
+            .name = "period",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &p->timer));
+    }
+    if (period_ms != p->period_ms)
+    {
+        esp_timer_stop(p->timer); // not running the first time
+        ESP_ERROR_CHECK(esp_timer_start_periodic(p->timer, period_ms * 1000ULL));
+        p->period_ms = period_ms;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    topo_jitter_mark(slot, period_ms);
+}
+
+void topo_jitter_mark(int slot, uint32_t period_ms)
+{
+    int64_t now = esp_timer_get_time();
+    topo_jitter_t *j = &s_jitter[slot];
+    uint32_t abs_dev = 0;
+
+    portENTER_CRITICAL(&s_jitter_lock);
+    bool first = j->last_us == 0 || j->period_ms != period_ms;
+    if (!first)
+    {
+        uint32_t interval = now - j->last_us;
+        int64_t dev = (int64_t)interval - (int64_t)period_ms * 1000;
+        abs_dev = dev < 0 ? -dev : dev;
+        if (j->count == 0 || interval < j->min_us)
+        {
+            j->min_us = interval;
+        }
+        if (interval > j->max_us)
+        {
+            j->max_us = interval;
+        }
+        if (abs_dev > j->max_dev_us)
+        {
+            j->max_dev_us = abs_dev;
+        }
+        j->sum_us += interval;
+        j->count++;
+    }
+    j->last_us = now;
+    j->period_ms = period_ms;
+    portEXIT_CRITICAL(&s_jitter_lock);
+
+    if (!first)
+    {
+        hist_record(slot, HIST_JITTER, abs_dev);
+    }
+}
+
+void topo_jitter_reset(void)
+{
+    portENTER_CRITICAL(&s_jitter_lock);
+    for (int i = 0; i < TOPO_JITTER_SLOTS; i++)
+    {
+        s_jitter[i] = (topo_jitter_t){0};
+    }
+    portEXIT_CRITICAL(&s_jitter_lock);
+}
+
+int topo_jitter_format(int slot, const char *name, char *buf, size_t len)
+{
+    portENTER_CRITICAL(&s_jitter_lock);
+    topo_jitter_t j = s_jitter[slot];
+    portEXIT_CRITICAL(&s_jitter_lock);
+
+    if (j.count == 0)
+    {
+        return 0;
+    }
+    return snprintf(buf, len, "J:%s n=%lu period=%lums mean=%lldus min=%luus max=%luus dev=%luus\n",
+                    name, (unsigned long)j.count, (unsigned long)j.period_ms, (long long)(j.sum_us / j.count),
+                    (unsigned long)j.min_us, (unsigned long)j.max_us, (unsigned long)j.max_dev_us);
+}
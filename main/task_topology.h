@@ -0,0 +1,82 @@
+#ifndef TASK_TOPOLOGY_H
+#define TASK_TOPOLOGY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "mem_budget.h"
+#include "params.h"
+
+/*
+ * Where each kind of task runs and at what priority.
+ *
+ * X(class, side, deadline_ms)
+ *
+ * side is SENSE or COMMS; with CONFIG_HYDRO_TOPOLOGY_SPLIT the two sides are
+ * pinned to opposite cores. Priorities are deadline-monotonic: a class gets
+ * one priority level above every class with a longer deadline. A periodic
+ * class's deadline is its period, as set when its tasks are created. A pump
+ * pulse should end within a tick of its length, and a command byte must be
+ * read before the UART FIFO fills at the fast link rate.
+ */
+#define TOPO_CLASS_TABLE(X)                                   \
+    X(SENSE_PH, SENSE, param_int(PARAM_PH_SAMPLE_MS))         \
+    X(ACTUATE, SENSE, portTICK_PERIOD_MS)                     \
+    X(COMMS, COMMS, 20)                                       \
+    X(SENSE_LIGHT, SENSE, param_int(PARAM_LIGHT_SAMPLE_MS))   \
+    X(SENSE_LEVEL, SENSE, param_int(PARAM_SAMPLE_MS))         \
+    X(SENSE_TEMP, SENSE, param_int(PARAM_SAMPLE_MS))          \
+    X(CONTROL, SENSE, param_int(PARAM_PH_CHECK_MS))           \
+    X(BACKGROUND, COMMS, 10000)
+
+typedef enum
+{
+#define TOPO_CLASS_ENUM(cls, side, deadline_ms) TOPO_CLASS_##cls,
+    TOPO_CLASS_TABLE(TOPO_CLASS_ENUM)
+#undef TOPO_CLASS_ENUM
+    TOPO_CLASS_COUNT,
+} topo_class_t;
+
+// Lowest priority handed out by the split topology
+#define TOPO_PRIORITY_BASE 3
+
+// Create a task placed according to its class, with the stack given for it
+// in MEM_TASK_TABLE.
+BaseType_t topo_create_task(TaskFunction_t fn, const char *name, mem_task_t mem, void *arg,
+                            topo_class_t cls, TaskHandle_t *handle);
+
+UBaseType_t topo_priority(topo_class_t cls);
+BaseType_t topo_core(topo_class_t cls);
+
+/*
+ * Periodic release of a sampling task. An esp_timer notifies the task each
+ * period, so the period and the jitter measured against it are in
+ * microseconds instead of FreeRTOS ticks (10 ms at CONFIG_FREERTOS_HZ=100).
+ */
+typedef struct
+{
+    esp_timer_handle_t timer;
+    uint32_t period_ms;
+} topo_period_t;
+
+// Waits for the next release, restarting the timer if period_ms changed,
+// and marks the wake-up in jitter slot. Call from one task only.
+void topo_period_wait(topo_period_t *p, int slot, uint32_t period_ms);
+
+/*
+ * Jitter benchmark: periodic tasks call topo_jitter_mark() once per period,
+ * right after waking. Each slot records the actual interval between marks
+ * against the nominal period, and feeds the deviation to the HIST_JITTER
+ * histogram of the same slot. A new period starts the intervals over.
+ */
+#define TOPO_JITTER_SLOTS 16
+
+void topo_jitter_mark(int slot, uint32_t period_ms);
+void topo_jitter_reset(void);
+
+// Format one slot as a line of text. Returns 0 if the slot has no samples.
+int topo_jitter_format(int slot, const char *name, char *buf, size_t len);
+
+#endif // TASK_TOPOLOGY_H
@@ -0,0 +1,96 @@
+#include "telemetry.h"
+#include <stdatomic.h>
+#include "gorilla.h"
+#include "hydro_channels.h"
+#include "mem_budget.h"
+#include "sdkconfig.h"
+
+#define TELEMETRY_BLOCK_BYTES 48
+#define TELEMETRY_FLUSH_US (CONFIG_HYDRO_GORILLA_FLUSH_MS * 1000LL)
+
+typedef struct
+{
+    gorilla_block_t block;
+    uint8_t buf[TELEMETRY_BLOCK_BYTES];
+    int64_t opened_us; // acquisition time of the first sample, 0 when empty
+} telemetry_channel_t;
+
+static telemetry_channel_t s_channels[HYDRO_CHANNEL_COUNT];
+MEM_BUFFER_CHECK(TELEMETRY_BLOCKS, s_channels);
+static atomic_bool s_compressed;
+static void (*s_write_line)(const char *line, int len);
+
+void telemetry_init(void (*write_line)(const char *line, int len))
+{
+    s_write_line = write_line;
+}
+
+void telemetry_set_compressed(bool on)
+{
+    atomic_store(&s_compressed, on);
+}
+
+bool telemetry_compressed(void)
+{
+    return atomic_load(&s_compressed);
+}
+
+static int base64(const uint8_t *in, int len, char *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int n = 0;
+    for (int i = 0; i < len; i += 3)
+    {
+        uint32_t v = in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0) | (i + 2 < len ? in[i + 2] : 0);
+        out[n++] = alphabet[v >> 18 & 0x3f];
+        out[n++] = alphabet[v >> 12 & 0x3f];
+        out[n++] = i + 1 < len ? alphabet[v >> 6 & 0x3f] : '=';
+        out[n++] = i + 2 < len ? alphabet[v & 0x3f] : '=';
+    }
+    return n;
+}
+
+void telemetry_flush(int ch)
+{
+    telemetry_channel_t *c = &s_channels[ch];
+    if (c->opened_us == 0)
+    {
+        return;
+    }
+    // "Z:" + tag + ":" + base64 + "\n"
+    char line[8 + (TELEMETRY_BLOCK_BYTES + 2) / 3 * 4 + 2];
+    const char *tag = hydro_channel_tag(ch);
+    int n = 0;
+    line[n++] = 'Z';
+    line[n++] = ':';
+    while (*tag && n < 6)
+    {
+        line[n++] = *tag++;
+    }
+    line[n++] = ':';
+    n += base64(c->buf, gorilla_finish(&c->block), &line[n]);
+    line[n++] = '\n';
+    s_write_line(line, n);
+    c->opened_us = 0;
+}
+
+void telemetry_compress(int ch, float value, int64_t acquired_us)
+{
+    telemetry_channel_t *c = &s_channels[ch];
+    uint32_t ms = (uint32_t)(acquired_us / 1000);
+    int32_t fixed = hydro_channel_fixed(ch, value);
+
+    if (c->opened_us && !gorilla_append(&c->block, ms, fixed))
+    {
+        telemetry_flush(ch);
+    }
+    if (c->opened_us == 0)
+    {
+        gorilla_begin(&c->block, c->buf, sizeof(c->buf), hydro_role_decimals(hydro_channels[ch].role), ms, fixed);
+        c->opened_us = acquired_us;
+    }
+    if (acquired_us - c->opened_us >= TELEMETRY_FLUSH_US)
+    {
+        telemetry_flush(ch);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Compressed telemetry stream. When enabled with the 'Z' command, readings
+ * are packed per channel into gorilla blocks instead of being sent as text.
+ * A block goes out as "Z:<tag>:<base64>\n" when it is full or
+ * CONFIG_HYDRO_GORILLA_FLUSH_MS after its first sample. The bridge turns the
+ * blocks back into "<tag>:<value>" messages.
+ *
+ * Each channel's block is only touched by the task that samples the channel.
+ */
+void telemetry_init(void (*write_line)(const char *line, int len));
+
+void telemetry_set_compressed(bool on);
+bool telemetry_compressed(void);
+
+// Add a reading to the channel's block, sending the block when due
+void telemetry_compress(int ch, float value, int64_t acquired_us);
+
+// Send the channel's block now if it has samples
+void telemetry_flush(int ch);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,104 @@
+#include "trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "mem_budget.h"
+
+#if CONFIG_HYDRO_TRACE
+
+#define TRACE_RING_SIZE (CONFIG_HYDRO_TRACE_RING_ENTRIES)
+
+typedef struct
+{
+    uint32_t timestamp_us; // low 32 bits of esp_timer_get_time()
+    TaskHandle_t task;
+    uint8_t event;
+    char phase; // 'B' or 'E'
+    uint16_t arg;
+} trace_entry_t;
+
+typedef struct
+{
+    trace_entry_t entries[TRACE_RING_SIZE];
+    uint32_t written; // total events ever recorded on this core
+    portMUX_TYPE lock;
+} trace_ring_t;
+
+static const char *const s_event_names[TRACE_EVENT_COUNT] = {
+#define TRACE_EVENT_NAME(id, name) [TRACE_##id] = name,
+    TRACE_EVENT_TABLE(TRACE_EVENT_NAME)
+#undef TRACE_EVENT_NAME
+};
+
+static trace_ring_t s_rings[portNUM_PROCESSORS];
+MEM_BUFFER_CHECK(TRACE_RINGS, s_rings);
+static atomic_bool s_paused;
+
+void trace_init(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        portMUX_INITIALIZE(&s_rings[core].lock);
+    }
+}
+
+// Tasks on the same core may preempt each other mid-record, so each ring has
+// its own spinlock; the two cores never contend for it.
+void IRAM_ATTR trace_record(trace_event_t event, char phase, uint16_t arg)
+{
+    if (atomic_load_explicit(&s_paused, memory_order_relaxed))
+    {
+        return;
+    }
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    trace_ring_t *ring = &s_rings[xPortGetCoreID()];
+
+    portENTER_CRITICAL_SAFE(&ring->lock);
+    trace_entry_t *e = &ring->entries[ring->written % TRACE_RING_SIZE];
+    e->timestamp_us = now;
+    e->task = task;
+    e->event = event;
+    e->phase = phase;
+    e->arg = arg;
+    ring->written++;
+    portEXIT_CRITICAL_SAFE(&ring->lock);
+}
+
+void trace_dump(void (*write_line)(const char *line, int len))
+{
+    char line[80];
+    atomic_store(&s_paused, true);
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        trace_ring_t *ring = &s_rings[core];
+        uint32_t count = ring->written < TRACE_RING_SIZE ? ring->written : TRACE_RING_SIZE;
+        for (uint32_t i = ring->written - count; i != ring->written; i++)
+        {
+            const trace_entry_t *e = &ring->entries[i % TRACE_RING_SIZE];
+            // "TR:<core>,<us>,<B|E>,<event>,<arg>,<task>"
+            int n = snprintf(line, sizeof(line), "TR:%d,%lu,%c,%s,%u,%s\n", core, (unsigned long)e->timestamp_us,
+                             e->phase, s_event_names[e->event], e->arg, e->task ? pcTaskGetName(e->task) : "isr");
+            write_line(line, n);
+        }
+    }
+    write_line("TR:end\n", 7);
+
+    atomic_store(&s_paused, false);
+}
+
+void trace_clear(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        portENTER_CRITICAL(&s_rings[core].lock);
+        s_rings[core].written = 0;
+        portEXIT_CRITICAL(&s_rings[core].lock);
+    }
+}
+
+#endif // CONFIG_HYDRO_TRACE
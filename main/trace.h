@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/*
+ * Lightweight event tracing: timestamped begin/end pairs recorded in a ring
+ * per core, oldest events overwritten first. Dump with the 'T' command and
+ * convert to Chrome/Perfetto JSON with interface/trace2chrome.ts.
+ *
+ * X(id, name)
+ */
+#define TRACE_EVENT_TABLE(X)               \
+    X(SAMPLE, "sample")                    \
+    X(ADC_READ, "adc_read")                \
+    X(ONEWIRE_CONVERT, "onewire_convert")  \
+    X(ONEWIRE_READ, "onewire_read")        \
+    X(UART_WRITE, "uart_write")            \
+    X(DOSE, "dose")                        \
+    X(COMMAND, "command")                  \
+    X(RULES, "rules")
+
+typedef enum
+{
+#define TRACE_EVENT_ENUM(id, name) TRACE_##id,
+    TRACE_EVENT_TABLE(TRACE_EVENT_ENUM)
+#undef TRACE_EVENT_ENUM
+    TRACE_EVENT_COUNT,
+} trace_event_t;
+
+#if CONFIG_HYDRO_TRACE
+
+// Call once from app_main before any task records
+void trace_init(void);
+void trace_record(trace_event_t event, char phase, uint16_t arg);
+
+#define trace_begin(event, arg) trace_record(TRACE_##event, 'B', (arg))
+#define trace_end(event, arg) trace_record(TRACE_##event, 'E', (arg))
+
+// Emit every recorded event, oldest first per core. Recording is paused
+// while the dump runs.
+void trace_dump(void (*write_line)(const char *line, int len));
+void trace_clear(void);
+
+#else
+
+#define trace_init() ((void)0)
+#define trace_begin(event, arg) ((void)(arg))
+#define trace_end(event, arg) ((void)(arg))
+#define trace_dump(write_line) ((void)(write_line))
+#define trace_clear() ((void)0)
+
+#endif // CONFIG_HYDRO_TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,34 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/*
+ * Byte stream that commands arrive on and telemetry leaves on. One backend
+ * is built, chosen with CONFIG_HYDRO_TRANSPORT:
+ *
+ *   UART  CONFIG_EXAMPLE_UART_PORT_NUM, to the serial bridge. Supports the
+ *         "B" rate negotiation of interface/link.ts.
+ *   TCP   a listening socket on CONFIG_HYDRO_TCP_PORT, one client at a time,
+ *         for the linux target and test harnesses. Output is dropped while
+ *         no client is connected.
+ *
+ * transport_write() may be called from any task, transport_read() only
+ * from the command task.
+ */
+
+// Called from app_main before any task can write
+void transport_init(void);
+
+// Wait up to timeout_ms for input. Returns the number of bytes read, 0 on
+// timeout.
+int transport_read(uint8_t *buf, size_t len, uint32_t timeout_ms);
+
+void transport_write(const char *data, size_t len);
+
+// The "B" link command; see transport_uart.c. Ignored by the TCP backend.
+void transport_link_command(const uint8_t *data, int len);
+
+#endif // TRANSPORT_H
@@ -0,0 +1,137 @@
+#include "transport.h"
+
+#if CONFIG_HYDRO_TRANSPORT_TCP
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+// Writes that cannot complete within this are treated as a dead client
+#define TCP_SEND_TIMEOUT_MS 200
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char *TAG = "tcp";
+
+static int s_listen = -1;
+// Connected client, -1 if none. Set and closed by the command task; writers
+// hold s_write_lock while they use it.
+static int s_client = -1;
+static SemaphoreHandle_t s_write_lock;
+static StaticSemaphore_t s_write_lock_buf;
+
+void transport_init(void)
+{
+    s_write_lock = xSemaphoreCreateMutexStatic(&s_write_lock_buf);
+
+    s_listen = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(s_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_HYDRO_TCP_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (s_listen < 0 || bind(s_listen, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s_listen, 1) != 0)
+    {
+        ESP_LOGE(TAG, "cannot listen on port %d: %s", CONFIG_HYDRO_TCP_PORT, strerror(errno));
+        return;
+    }
+    ESP_LOGI(TAG, "listening on port %d", CONFIG_HYDRO_TCP_PORT);
+}
+
+static bool wait_readable(int fd, uint32_t timeout_ms)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval tv = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+    return select(fd + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+static void set_client(int fd)
+{
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+    if (s_client >= 0)
+    {
+        close(s_client);
+    }
+    s_client = fd;
+    xSemaphoreGive(s_write_lock);
+}
+
+int transport_read(uint8_t *buf, size_t len, uint32_t timeout_ms)
+{
+    if (s_listen < 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+        return 0;
+    }
+    if (s_client < 0)
+    {
+        if (!wait_readable(s_listen, timeout_ms))
+        {
+            return 0;
+        }
+        int fd = accept(s_listen, NULL, NULL);
+        if (fd < 0)
+        {
+            return 0;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        struct timeval tv = {.tv_sec = 0, .tv_usec = TCP_SEND_TIMEOUT_MS * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        set_client(fd);
+        ESP_LOGI(TAG, "client connected");
+        return 0;
+    }
+    if (!wait_readable(s_client, timeout_ms))
+    {
+        return 0;
+    }
+    int n = recv(s_client, buf, len, 0);
+    if (n <= 0)
+    {
+        // Closed by the peer, or shut down by a failed write
+        set_client(-1);
+        ESP_LOGI(TAG, "client disconnected");
+        return 0;
+    }
+    return n;
+}
+
+void transport_write(const char *data, size_t len)
+{
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+    while (s_client >= 0 && len > 0)
+    {
+        int n = send(s_client, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            // Wake the reader, which closes the socket
+            shutdown(s_client, SHUT_RDWR);
+            break;
+        }
+        data += n;
+        len -= n;
+    }
+    xSemaphoreGive(s_write_lock);
+}
+
+void transport_link_command(const uint8_t *data, int len)
+{
+}
+
+#endif // CONFIG_HYDRO_TRANSPORT_TCP
@@ -0,0 +1,136 @@
+#include "transport.h"
+
+#if CONFIG_HYDRO_TRANSPORT_UART
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "mem_budget.h"
+
+/**
+ * The UART is driven without the driver event queue.
+ *
+ * - Port: configured UART
+ * - Receive (Rx) buffer: twice the command buffer
+ * - Transmit (Tx) buffer: CONFIG_HYDRO_UART_TX_BUF_SIZE
+ * - Flow control: CONFIG_HYDRO_UART_FLOW_CTRL
+ * - Pin assignment: see defines below (See Kconfig)
+ */
+
+#define ECHO_TEST_TXD (CONFIG_EXAMPLE_UART_TXD)
+#define ECHO_TEST_RXD (CONFIG_EXAMPLE_UART_RXD)
+#if CONFIG_HYDRO_UART_FLOW_CTRL
+#define ECHO_TEST_RTS (CONFIG_HYDRO_UART_RTS)
+#define ECHO_TEST_CTS (CONFIG_HYDRO_UART_CTS)
+#define ECHO_FLOW_CTRL (UART_HW_FLOWCTRL_CTS_RTS)
+#else
+#define ECHO_TEST_RTS (UART_PIN_NO_CHANGE)
+#define ECHO_TEST_CTS (UART_PIN_NO_CHANGE)
+#define ECHO_FLOW_CTRL (UART_HW_FLOWCTRL_DISABLE)
+#endif
+
+#define ECHO_UART_PORT_NUM (CONFIG_EXAMPLE_UART_PORT_NUM)
+#define ECHO_UART_BAUD_RATE (CONFIG_EXAMPLE_UART_BAUD_RATE)
+#define ECHO_TX_BUF_SIZE (CONFIG_HYDRO_UART_TX_BUF_SIZE)
+#define ECHO_RX_BUF_SIZE (sizeof(mem_buffer_ECHO_RX) * 2)
+
+// The driver only accepts a TX ring larger than the hardware FIFO
+static_assert(ECHO_TX_BUF_SIZE == 0 || ECHO_TX_BUF_SIZE > CONFIG_SOC_UART_FIFO_LEN,
+              "CONFIG_HYDRO_UART_TX_BUF_SIZE must be 0 or larger than the UART FIFO");
+
+// How long a new link rate waits for its first byte before falling back
+#define LINK_CONFIRM_US (2000 * 1000)
+
+// Rate of the link and, after a switch, the time by which a byte must have
+// arrived at the new rate; 0 once one has
+static uint32_t s_link_baud = ECHO_UART_BAUD_RATE;
+static int64_t s_link_deadline_us;
+
+void transport_init(void)
+{
+    /* Configure parameters of an UART driver,
+     * communication pins and install the driver */
+    uart_config_t uart_config = {
+        .baud_rate = ECHO_UART_BAUD_RATE,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = ECHO_FLOW_CTRL,
+        .rx_flow_ctrl_thresh = CONFIG_SOC_UART_FIFO_LEN - 6,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    int intr_alloc_flags = 0;
+
+#if CONFIG_UART_ISR_IN_IRAM
+    intr_alloc_flags = ESP_INTR_FLAG_IRAM;
+#endif
+
+    ESP_ERROR_CHECK(uart_driver_install(ECHO_UART_PORT_NUM, ECHO_RX_BUF_SIZE, ECHO_TX_BUF_SIZE, 0, NULL, intr_alloc_flags));
+    ESP_ERROR_CHECK(uart_param_config(ECHO_UART_PORT_NUM, &uart_config));
+    ESP_ERROR_CHECK(uart_set_pin(ECHO_UART_PORT_NUM, ECHO_TEST_TXD, ECHO_TEST_RXD, ECHO_TEST_RTS, ECHO_TEST_CTS));
+}
+
+static void link_set_baud(uint32_t baud)
+{
+    // Let queued output finish at the old rate
+    uart_wait_tx_done(ECHO_UART_PORT_NUM, pdMS_TO_TICKS(500));
+    uart_set_baudrate(ECHO_UART_PORT_NUM, baud);
+    s_link_baud = baud;
+}
+
+// Falls back to the base rate if a switch was not confirmed in time
+static void link_check(int len)
+{
+    if (len > 0)
+    {
+        s_link_deadline_us = 0;
+    }
+    else if (s_link_deadline_us && esp_timer_get_time() > s_link_deadline_us)
+    {
+        s_link_deadline_us = 0;
+        link_set_baud(ECHO_UART_BAUD_RATE);
+    }
+}
+
+int transport_read(uint8_t *buf, size_t len, uint32_t timeout_ms)
+{
+    int n = uart_read_bytes(ECHO_UART_PORT_NUM, buf, len, pdMS_TO_TICKS(timeout_ms));
+    link_check(n);
+    return n > 0 ? n : 0;
+}
+
+void transport_write(const char *data, size_t len)
+{
+    uart_write_bytes(ECHO_UART_PORT_NUM, data, len);
+}
+
+// "B<baud>" switches the link to a rate up to CONFIG_HYDRO_UART_LINK_MAX_BAUD.
+// The reply "B:<baud>" is sent at the old rate, then both ends switch. If
+// nothing arrives at the new rate within LINK_CONFIRM_US the link returns to
+// CONFIG_EXAMPLE_UART_BAUD_RATE. A bare "B" replies with the current rate;
+// the bridge sends it to check the link.
+void transport_link_command(const uint8_t *data, int len)
+{
+    uint32_t baud = len > 1 ? strtoul((const char *)data + 1, NULL, 10) : s_link_baud;
+    if (baud < ECHO_UART_BAUD_RATE)
+    {
+        baud = ECHO_UART_BAUD_RATE;
+    }
+    if (baud > CONFIG_HYDRO_UART_LINK_MAX_BAUD)
+    {
+        baud = CONFIG_HYDRO_UART_LINK_MAX_BAUD;
+    }
+    char line[24];
+    int n = snprintf(line, sizeof(line), "B:%lu\n", (unsigned long)baud);
+    transport_write(line, n);
+    if (baud != s_link_baud)
+    {
+        link_set_baud(baud);
+        s_link_deadline_us = esp_timer_get_time() + LINK_CONFIRM_US;
+    }
+}
+
+#endif // CONFIG_HYDRO_TRANSPORT_UART
@@ -0,0 +1,440 @@
+#include "tsdb.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "state_store.h"
+#include "task_topology.h"
+
+#if CONFIG_HYDRO_TSDB
+
+#define TSDB_PARTITION_NAME "tsdb"
+#define TSDB_PARTITION_SUBTYPE 0x40
+#define TSDB_SECTOR_SIZE 4096
+#define TSDB_PAGES_PER_SECTOR (TSDB_SECTOR_SIZE / TSDB_PAGE_SIZE)
+#define TSDB_ERASED 0xFFFFFFFF
+#define TSDB_VARINT_MAX 5
+#define TSDB_PERIOD_S (CONFIG_HYDRO_TSDB_PERIOD_S)
+
+typedef struct
+{
+    tsdb_page_header_t header;
+    uint8_t rows[TSDB_PAGE_SIZE - sizeof(tsdb_page_header_t)];
+} tsdb_page_t;
+
+static_assert(sizeof(tsdb_page_header_t) == 20, "page header layout is part of the export format");
+static_assert(sizeof(tsdb_page_t) == TSDB_PAGE_SIZE, "one page per flash program");
+static_assert(HYDRO_CHANNEL_COUNT <= 30, "changed-channel mask must fit a row header");
+
+static const char *TAG = "tsdb";
+
+static const int32_t s_deadbands[HYDRO_ROLE_COUNT] = {
+#define TSDB_ROLE_ROW(role, deadband) [role] = deadband,
+    TSDB_ROLE_TABLE(TSDB_ROLE_ROW)
+#undef TSDB_ROLE_ROW
+};
+
+static const esp_partition_t *s_partition;
+static uint32_t s_page_count;
+static uint32_t s_head; // next page to write
+static uint32_t s_seq;  // sequence number of the next page
+
+// Page being filled and the encoder state, guarded by s_lock
+static tsdb_page_t s_page;
+MEM_BUFFER_CHECK(TSDB_PAGE, s_page);
+static int32_t s_last[HYDRO_CHANNEL_COUNT]; // last value stored per channel
+static uint32_t s_run;                      // unchanged rows not yet written
+static uint32_t s_next_s;                   // time the next row is due
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_buf;
+static TaskHandle_t s_task;
+
+// Export requested by "X" and streamed by the logger task between rows.
+// tsdb_export() fills it in while it is not active, under s_lock; after
+// that only the logger task touches it until it clears active.
+typedef struct
+{
+    bool active;
+    uint32_t from_s, to_s;
+    uint32_t head;    // oldest page when the export started
+    uint32_t scanned; // pages looked at so far
+    uint32_t sent;
+    void (*write_line)(const char *line, int len);
+} tsdb_export_t;
+
+static tsdb_export_t s_export;
+
+static int put_varint(uint8_t *out, uint32_t v)
+{
+    int n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+// Rows go in only if TSDB_VARINT_MAX bytes stay free for a pending run
+static bool page_fits(int n)
+{
+    return (size_t)(s_page.header.used + n + TSDB_VARINT_MAX) <= sizeof(s_page.rows);
+}
+
+static void page_put(const uint8_t *bytes, int n)
+{
+    memcpy(&s_page.rows[s_page.header.used], bytes, n);
+    s_page.header.used += n;
+}
+
+static void flush_run(void)
+{
+    if (s_run)
+    {
+        s_page.header.used += put_varint(&s_page.rows[s_page.header.used], s_run << 2 | TSDB_RUN);
+        s_run = 0;
+    }
+}
+
+static void page_seal(tsdb_page_t *page)
+{
+    page->header.end_s = s_next_s - TSDB_PERIOD_S;
+    page->header.crc = esp_rom_crc32_le(0, (const uint8_t *)&page->header, offsetof(tsdb_page_header_t, crc));
+    page->header.crc = esp_rom_crc32_le(page->header.crc, page->rows, page->header.used);
+}
+
+// Write the page to flash and start an empty one. Sectors are erased just
+// before their first page is written.
+static void page_close(void)
+{
+    if (s_page.header.used == 0)
+    {
+        return;
+    }
+    flush_run();
+    s_page.header.seq = s_seq;
+    page_seal(&s_page);
+
+    esp_err_t err = ESP_OK;
+    if (s_head % TSDB_PAGES_PER_SECTOR == 0)
+    {
+        err = esp_partition_erase_range(s_partition, s_head * TSDB_PAGE_SIZE, TSDB_SECTOR_SIZE);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_partition_write(s_partition, s_head * TSDB_PAGE_SIZE, &s_page, TSDB_PAGE_SIZE);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "page %lu: %s", (unsigned long)s_head, esp_err_to_name(err));
+    }
+    s_head = (s_head + 1) % s_page_count;
+    s_seq++;
+
+    memset(&s_page, 0xff, sizeof(s_page));
+    s_page.header.used = 0;
+}
+
+// Start a page with a row holding every channel
+static void page_open(uint32_t now_s, const int32_t *q)
+{
+    uint8_t row[TSDB_VARINT_MAX * (HYDRO_CHANNEL_COUNT + 1)];
+    int n = put_varint(row, ((1u << HYDRO_CHANNEL_COUNT) - 1) << 2 | TSDB_ROW);
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        n += put_varint(&row[n], zigzag(q[ch]));
+        s_last[ch] = q[ch];
+    }
+    s_page.header.start_s = now_s;
+    s_page.header.channels = HYDRO_CHANNEL_COUNT;
+    s_page.header.period_s = TSDB_PERIOD_S;
+    page_put(row, n);
+    s_run = 0;
+    s_next_s = now_s + TSDB_PERIOD_S;
+}
+
+static void tsdb_append(uint32_t now_s, const int32_t *q)
+{
+    if (s_page.header.used == 0)
+    {
+        page_open(now_s, q);
+        return;
+    }
+    // A clock set backwards or a page held in RAM too long starts a new page
+    if (now_s < s_next_s || now_s - s_page.header.start_s >= CONFIG_HYDRO_TSDB_FLUSH_S)
+    {
+        page_close();
+        page_open(now_s, q);
+        return;
+    }
+
+    uint8_t row[TSDB_VARINT_MAX * (HYDRO_CHANNEL_COUNT + 2)];
+    int n = 0;
+    if (now_s > s_next_s)
+    {
+        n += put_varint(&row[n], (now_s - s_next_s) << 2 | TSDB_GAP);
+    }
+    uint32_t mask = 0;
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (abs(q[ch] - s_last[ch]) > s_deadbands[hydro_channels[ch].role])
+        {
+            mask |= 1u << ch;
+        }
+    }
+    if (mask == 0 && n == 0)
+    {
+        s_run++;
+        s_next_s = now_s + TSDB_PERIOD_S;
+        return;
+    }
+    n += put_varint(&row[n], mask << 2 | TSDB_ROW);
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (mask & (1u << ch))
+        {
+            n += put_varint(&row[n], zigzag(q[ch] - s_last[ch]));
+        }
+    }
+
+    flush_run();
+    if (!page_fits(n))
+    {
+        page_close();
+        page_open(now_s, q);
+        return;
+    }
+    page_put(row, n);
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (mask & (1u << ch))
+        {
+            s_last[ch] = q[ch];
+        }
+    }
+    s_next_s = now_s + TSDB_PERIOD_S;
+}
+
+static uint32_t read_seq(uint32_t page)
+{
+    uint32_t seq = TSDB_ERASED;
+    esp_partition_read(s_partition, page * TSDB_PAGE_SIZE, &seq, sizeof(seq));
+    return seq;
+}
+
+// The newest sector is the one whose first page has the highest sequence
+// number; the head is its first erased page, or the next sector if full.
+static void tsdb_recover(void)
+{
+    uint32_t sectors = s_page_count / TSDB_PAGES_PER_SECTOR;
+    uint32_t newest = 0, newest_seq = TSDB_ERASED;
+    for (uint32_t sector = 0; sector < sectors; sector++)
+    {
+        uint32_t seq = read_seq(sector * TSDB_PAGES_PER_SECTOR);
+        if (seq != TSDB_ERASED && (newest_seq == TSDB_ERASED || seq > newest_seq))
+        {
+            newest = sector;
+            newest_seq = seq;
+        }
+    }
+    if (newest_seq == TSDB_ERASED)
+    {
+        s_head = 0;
+        s_seq = 0;
+        return;
+    }
+
+    s_head = (newest + 1) * TSDB_PAGES_PER_SECTOR % s_page_count;
+    s_seq = newest_seq + 1;
+    for (uint32_t page = newest * TSDB_PAGES_PER_SECTOR + 1; page < (newest + 1) * TSDB_PAGES_PER_SECTOR; page++)
+    {
+        uint32_t seq = read_seq(page);
+        if (seq == TSDB_ERASED)
+        {
+            s_head = page;
+            break;
+        }
+        s_seq = seq + 1;
+    }
+}
+
+static void export_page(const tsdb_page_t *page, void (*write_line)(const char *line, int len))
+{
+    static const char hex[] = "0123456789abcdef";
+    const uint8_t *bytes = (const uint8_t *)page;
+    int len = sizeof(page->header) + page->header.used;
+    char chunk[64];
+
+    write_line("X:", 2);
+    for (int i = 0; i < len;)
+    {
+        int n = 0;
+        for (; i < len && n < (int)sizeof(chunk); i++)
+        {
+            chunk[n++] = hex[bytes[i] >> 4];
+            chunk[n++] = hex[bytes[i] & 0xf];
+        }
+        write_line(chunk, n);
+    }
+    write_line("\n", 1);
+}
+
+static bool page_overlaps(const tsdb_page_header_t *header, uint32_t from_s, uint32_t to_s)
+{
+    return header->start_s <= to_s && header->end_s >= from_s;
+}
+
+// Send the next page of the export that overlaps its range, or finish it
+// with the page still in RAM and "X:end". Runs on the logger task, so no
+// page is written while it reads.
+static void export_step(tsdb_export_t *x)
+{
+    tsdb_page_t page;
+    if (x->scanned == 0)
+    {
+        x->head = s_head;
+    }
+    while (x->scanned < s_page_count)
+    {
+        uint32_t index = (x->head + x->scanned++) % s_page_count;
+        esp_err_t err = esp_partition_read(s_partition, index * TSDB_PAGE_SIZE, &page, sizeof(page));
+        if (err != ESP_OK || page.header.seq == TSDB_ERASED || page.header.used > sizeof(page.rows) ||
+            !page_overlaps(&page.header, x->from_s, x->to_s))
+        {
+            continue;
+        }
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&page.header, offsetof(tsdb_page_header_t, crc));
+        if (esp_rom_crc32_le(crc, page.rows, page.header.used) != page.header.crc)
+        {
+            continue; // torn by a reset during the write
+        }
+        export_page(&page, x->write_line);
+        x->sent++;
+        return;
+    }
+
+    // The page still in RAM, with the pending run written out
+    if (s_page.header.used != 0)
+    {
+        page = s_page;
+        if (s_run)
+        {
+            page.header.used += put_varint(&page.rows[page.header.used], s_run << 2 | TSDB_RUN);
+        }
+        page.header.seq = s_seq;
+        page_seal(&page);
+        if (page_overlaps(&page.header, x->from_s, x->to_s))
+        {
+            export_page(&page, x->write_line);
+            x->sent++;
+        }
+    }
+
+    char line[32];
+    int n = snprintf(line, sizeof(line), "X:end %lu\n", (unsigned long)x->sent);
+    x->write_line(line, n);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_export.active = false;
+    xSemaphoreGive(s_lock);
+}
+
+// A whole partition is thousands of lines, so "X" only hands the range to
+// the logger task and returns. The pages follow within the next seconds.
+void tsdb_export(uint32_t from_s, uint32_t to_s, void (*write_line)(const char *line, int len))
+{
+    if (s_partition == NULL)
+    {
+        write_line("X:end 0\n", 8);
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool busy = s_export.active;
+    if (!busy)
+    {
+        s_export = (tsdb_export_t){
+            .active = true,
+            .from_s = from_s,
+            .to_s = to_s,
+            .write_line = write_line,
+        };
+    }
+    xSemaphoreGive(s_lock);
+
+    if (busy)
+    {
+        write_line("X:busy\n", 7);
+        return;
+    }
+    xTaskNotifyGive(s_task);
+}
+
+// Appends a row every period. In between, an export in progress sends its
+// pages one at a time, checking before each whether a row is due, so a long
+// export neither delays rows nor blocks the command task.
+static void tsdb_task(void *arg)
+{
+    const TickType_t period = pdMS_TO_TICKS(TSDB_PERIOD_S * 1000);
+    TickType_t next_row = xTaskGetTickCount();
+    while (1)
+    {
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(now - next_row) >= 0)
+        {
+            int32_t q[HYDRO_CHANNEL_COUNT];
+            for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+            {
+                state_sample_t sample;
+                q[ch] = state_read(ch, &sample) ? hydro_channel_fixed(ch, sample.value) : 0;
+            }
+            tsdb_append((uint32_t)time(NULL), q);
+            next_row += period;
+            continue;
+        }
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool exporting = s_export.active;
+        xSemaphoreGive(s_lock);
+        if (exporting)
+        {
+            export_step(&s_export);
+            continue;
+        }
+        ulTaskNotifyTake(pdTRUE, next_row - now);
+    }
+}
+
+void tsdb_start(void)
+{
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TSDB_PARTITION_SUBTYPE, TSDB_PARTITION_NAME);
+    if (s_partition == NULL)
+    {
+        ESP_LOGW(TAG, "no \"%s\" partition, history is not recorded", TSDB_PARTITION_NAME);
+        return;
+    }
+    s_page_count = s_partition->size / TSDB_SECTOR_SIZE * TSDB_PAGES_PER_SECTOR;
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    memset(&s_page, 0xff, sizeof(s_page));
+    s_page.header.used = 0;
+    tsdb_recover();
+    ESP_LOGI(TAG, "%lu pages, resuming at page %lu seq %lu", (unsigned long)s_page_count, (unsigned long)s_head,
+             (unsigned long)s_seq);
+
+    topo_create_task(tsdb_task, "tsdb", MEM_TASK_TSDB, NULL, TOPO_CLASS_BACKGROUND, &s_task);
+}
+
+#endif // CONFIG_HYDRO_TSDB
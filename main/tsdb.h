@@ -0,0 +1,80 @@
+#ifndef TSDB_H
+#define TSDB_H
+
+#include <stdint.h>
+#include "hydro_channels.h"
+#include "sdkconfig.h"
+
+/*
+ * Time-series log in the "tsdb" flash partition (partitions.csv).
+ *
+ * Once per CONFIG_HYDRO_TSDB_PERIOD_S the latest sample of every channel is
+ * converted to fixed point and appended to a 256-byte page in RAM. Full
+ * pages are written to flash whole, round-robin over the partition, so every
+ * sector is erased once per lap and the oldest sector is the one dropped.
+ *
+ * Page layout: tsdb_page_header_t, then rows. Each row starts with a varint
+ * h; h & 3 is the kind:
+ *
+ *   TSDB_ROW  h >> 2 is a mask of changed channels, followed by one zigzag
+ *             varint delta per set bit, lowest channel first
+ *   TSDB_RUN  h >> 2 rows identical to the previous one
+ *   TSDB_GAP  h >> 2 seconds without rows
+ *
+ * Every row but TSDB_GAP takes one period. The first row of a page lists all
+ * channels as deltas from zero, so pages decode on their own.
+ *
+ * Values are stored with the decimals of HYDRO_ROLE_DECIMALS_TABLE.
+ * X(role, deadband): a change of no more than deadband fixed-point units is
+ * stored as unchanged.
+ */
+#define TSDB_ROLE_TABLE(X)                 \
+    X(HYDRO_ROLE_TEMPERATURE, 5)           \
+    X(HYDRO_ROLE_PH, 2)                    \
+    X(HYDRO_ROLE_WATER_LEVEL, 0)           \
+    X(HYDRO_ROLE_LIGHT, 16)                \
+    X(HYDRO_ROLE_PH_UP, 0)                 \
+    X(HYDRO_ROLE_PH_DOWN, 0)               \
+    X(HYDRO_ROLE_PLANT_FOOD, 0)            \
+    X(HYDRO_ROLE_GROW_LIGHT, 0)
+
+#define TSDB_PAGE_SIZE 256
+
+typedef enum
+{
+    TSDB_ROW,
+    TSDB_RUN,
+    TSDB_GAP,
+} tsdb_row_kind_t;
+
+typedef struct
+{
+    uint32_t seq;     // page number since the partition was first used; 0xFFFFFFFF when erased
+    uint32_t start_s; // time of the first row, seconds since the epoch
+    uint32_t end_s;   // time of the last row
+    uint16_t used;    // bytes of rows after the header
+    uint8_t channels; // HYDRO_CHANNEL_COUNT of the writer
+    uint8_t period_s;
+    uint32_t crc; // CRC-32 of the header up to here and the used rows
+} tsdb_page_header_t;
+
+#if CONFIG_HYDRO_TSDB
+
+// Find the partition, resume after the newest page and start the logger
+// task. Logs a warning and does nothing if there is no tsdb partition.
+void tsdb_start(void);
+
+// Send every page that overlaps [from_s, to_s], oldest first, as "X:<hex>"
+// lines, then the page still being filled and "X:end <pages>". Decode with
+// interface/tsdb-export.ts. Returns at once: the logger task streams the
+// pages between its rows. Replies "X:busy" while an export is running.
+void tsdb_export(uint32_t from_s, uint32_t to_s, void (*write_line)(const char *line, int len));
+
+#else
+
+#define tsdb_start() ((void)0)
+#define tsdb_export(from_s, to_s, write_line) ((void)(write_line))
+
+#endif // CONFIG_HYDRO_TSDB
+
+#endif // TSDB_H
@@ -7,442 +7,1075 @@
    CONDITIONS OF ANY KIND, either express or implied.
 */
 #include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/time.h>
 #include "string.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/uart.h"
-#include "driver/gpio.h"
 #include "sdkconfig.h"
 #include "esp_log.h"
-#include "driver/adc.h" // Include ADC driver header
-#include "esp_adc/adc_oneshot.h"
-#include "ds18b20.h"
 #include "onewire_sensor.h"
+#include "hydro_channels.h"
+#include "state_store.h"
+#include "task_topology.h"
+#include "latency_hist.h"
+#include "mem_budget.h"
+#include "dlog.h"
+#include "trace.h"
+#include "tsdb.h"
+#include "rollup.h"
+#include "telemetry.h"
+#include "report_policy.h"
+#include "cmd_proto.h"
+#include "params.h"
+#include "transport.h"
+#include "hydro_io.h"
+#include "ph_control.h"
+#include "ph_settle.h"
+#include "capture.h"
+#include "dosing.h"
+#include "rules.h"
+#include "anomaly.h"
+#include "esp_timer.h"
 
 /**
- * This is an example which echos any data it receives on configured UART back to the sender,
- * with hardware flow control turned off. It does not use UART driver event queue.
- *
- * - Port: configured UART
- * - Receive (Rx) buffer: on
- * - Transmit (Tx) buffer: off
- * - Flow control: off
- * - Event queue: off
- * - Pin assignment: see defines below (See Kconfig)
+ * This is an example which echos any data it receives on the transport back
+ * to the sender (see transport.h).
  */
 
-#define ECHO_TEST_TXD (CONFIG_EXAMPLE_UART_TXD)
-#define ECHO_TEST_RXD (CONFIG_EXAMPLE_UART_RXD)
-#define ECHO_TEST_RTS (UART_PIN_NO_CHANGE)
-#define ECHO_TEST_CTS (UART_PIN_NO_CHANGE)
-
-#define ECHO_UART_PORT_NUM (CONFIG_EXAMPLE_UART_PORT_NUM)
-#define ECHO_UART_BAUD_RATE (CONFIG_EXAMPLE_UART_BAUD_RATE)
 #define ECHO_TASK_STACK_SIZE (CONFIG_EXAMPLE_TASK_STACK_SIZE)
 
-const int LED_BLINK_PIN = 13;
-
-const int TEMP_SENSOR_PIN = 13;
-const int PH_SENSOR_PIN = ADC1_CHANNEL_6;
-
-const int WATER_LEVEL_PIN = 14;
-const int LIGHT_CHECK_PIN = 27;
-const int PH_UP_PIN = 33;
-const int PH_DOWN_PIN = 32;
-
-const int PLANT_FOOD_PIN = 32;
-
-const int FLOW_DURATION = 1000; // 2 seconds
-
-bool should_dispense_ph_up = false;
-bool should_dispense_ph_down = false;
-bool should_auto_ph = false;
-bool should_dispense_plant_food = false;
-bool should_toggle_leds = false;
-
-bool leds_on = false;
-
 #define MIN_VAL 0
 #define MAX_VAL 4095
 
-#define DEFAULT_PERIOD 1000
-
-#define BUF_SIZE (1024)
+#define BUF_SIZE (sizeof(mem_buffer_ECHO_RX))
 
 static uint8_t s_led_state = 1;
-static float PH_VALUE_NOW = 7.0;
-static float set_ph_value = 7.0;
-static float error_ph = 0.20;
 static uint8_t START_VALUE = 0;
-static uint32_t flash_period = DEFAULT_PERIOD;
-static uint32_t flash_period_dec = DEFAULT_PERIOD / 10;
-
-TaskHandle_t getTemperatureHandle = NULL;
-TaskHandle_t getWaterLevelHandle = NULL;
-TaskHandle_t getPHValueHandle = NULL;
-TaskHandle_t autoPHValueHandle = NULL;
-TaskHandle_t dispensePhUpHandle = NULL;
-TaskHandle_t dispensePhDownHandle = NULL;
-TaskHandle_t dispensePlantFoodHandle = NULL;
-TaskHandle_t lightCheckHandle = NULL;
-TaskHandle_t toggleLedsHandle = NULL;
 
-static void get_temperature(void *pvParameters)
-{
-    while (1)
-    {
-        float a = sensor_read();
-        // convert float value to string before sending
-        char buffer[20];
-        snprintf(buffer, sizeof(buffer), "%.2f", a);
+// One task per channel, plus the per-tank controllers
+TaskHandle_t channelTaskHandles[HYDRO_CHANNEL_COUNT];
+TaskHandle_t autoPHValueHandles[HYDRO_TANK_COUNT];
+TaskHandle_t toggleLedsHandles[HYDRO_TANK_COUNT];
+TaskHandle_t uartLoadHandle = NULL;
 
-        char result[50];                             // Ensure the array is large enough to hold the concatenated string
-        strcpy(result, "T:");                        // Copy the initial string into the result
-        char *return_value = strcat(result, buffer); // Append buffer to result and get the return value
+static_assert(HYDRO_CHANNEL_COUNT <= TOPO_JITTER_SLOTS, "one jitter slot per channel");
+static_assert(HYDRO_CHANNEL_COUNT <= HIST_SLOTS, "one histogram slot per channel");
 
-        uart_write_bytes(ECHO_UART_PORT_NUM, return_value, strlen(return_value));
+#define CHANNEL_ARG(ch) ((void *)(intptr_t)(ch))
+#define ARG_CHANNEL(arg) ((int)(intptr_t)(arg))
 
-        vTaskDelay(flash_period / portTICK_PERIOD_MS);
+// Sends "<tag>:<text>", e.g. "PH:6.52" or "PH1:6.52" for the second tank, or
+// adds the value to the compressed stream, and records the time since
+// acquired_us in the channel's latency histogram. Readings the channel's
+// report policy holds back are dropped.
+static void send_reading(int ch, float value, const char *text, int64_t acquired_us)
+{
+    if (!report_due(ch, value, acquired_us))
+    {
+        return;
+    }
+    if (telemetry_compressed())
+    {
+        telemetry_compress(ch, value, acquired_us);
+    }
+    else
+    {
+        char result[50];
+        telemetry_flush(ch);
+        snprintf(result, sizeof(result), "%s:%s", hydro_channel_tag(ch), text);
+        trace_begin(UART_WRITE, ch);
+        transport_write(result, strlen(result));
+        trace_end(UART_WRITE, ch);
     }
+    hist_record(ch, HIST_LATENCY, esp_timer_get_time() - acquired_us);
 }
 
-static void dispense_ph_up(void *arg)
-{
-    ESP_LOGI("Motor", "Dispensing PH_UP");
-    gpio_reset_pin(PH_UP_PIN);
-    gpio_set_direction(PH_UP_PIN, GPIO_MODE_OUTPUT);
+#if !CONFIG_HYDRO_SENSOR_CHECK_OFF
+// Faults of each channel's last reading, only touched by its sampling task
+static uint32_t s_faults[HYDRO_CHANNEL_COUNT];
+#endif
 
-    while (1)
+// Runs the fault detectors of anomaly.h on a reading and sends
+// "F:<channel> <faults> <value>" when the channel's faults change. Returns
+// false if the reading must be dropped before it is published, for a fault
+// in ANOMALY_DROP.
+static bool reading_sound(int ch, float value, int64_t now_us)
+{
+#if CONFIG_HYDRO_SENSOR_CHECK_OFF
+    return true;
+#else
+    uint32_t faults = anomaly_check(ch, value, now_us);
+    if (faults != s_faults[ch])
     {
-        if (should_dispense_ph_up)
-        {
-            ESP_LOGI("Motor", "Activating PH_UP_PIN");
-            gpio_set_level(PH_UP_PIN, 1);
-            vTaskDelay(FLOW_DURATION / portTICK_PERIOD_MS);
-            gpio_set_level(PH_UP_PIN, 0);
-            should_dispense_ph_up = false;
-        }
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        s_faults[ch] = faults;
+        DLOG(SENSOR_FAULT, ch, faults, dlog_f(value));
+        char line[48];
+        int n = snprintf(line, sizeof(line), "F:%s %lu %.2f\n", hydro_channels[ch].name, (unsigned long)faults, value);
+        transport_write(line, n);
     }
+#if CONFIG_HYDRO_SENSOR_CHECK_FLAG
+    return true;
+#else
+    return (faults & ANOMALY_DROP) == 0;
+#endif
+#endif
 }
 
-static void dispense_ph_down(void *arg)
+static void get_temperature(void *pvParameters)
 {
-    ESP_LOGI("Motor", "Dispensing PH_DOWN");
-    gpio_reset_pin(PH_DOWN_PIN);
-    gpio_set_direction(PH_DOWN_PIN, GPIO_MODE_OUTPUT);
-
+    int ch = ARG_CHANNEL(pvParameters);
+    int tank = hydro_channels[ch].tank;
+    topo_period_t period = {0};
     while (1)
     {
-        if (should_dispense_ph_down)
+        topo_period_wait(&period, ch, param_int(PARAM_SAMPLE_MS));
+        trace_begin(SAMPLE, ch);
+        int64_t acquired = esp_timer_get_time();
+        float a;
+        // No sensor, no reading: nothing to check, publish or capture
+        if (sensor_read(tank, &a))
         {
-            ESP_LOGI("Motor", "Activating PH_UP_PIN");
-            gpio_set_level(PH_DOWN_PIN, 1);
-            vTaskDelay(FLOW_DURATION / portTICK_PERIOD_MS);
-            gpio_set_level(PH_DOWN_PIN, 0);
-            should_dispense_ph_down = false;
+            if (reading_sound(ch, a, acquired))
+            {
+                state_publish(ch, a, acquired);
+                rollup_add(ch, a);
+                // convert float value to string before sending
+                char buffer[20];
+                snprintf(buffer, sizeof(buffer), "%.2f", a);
+                send_reading(ch, a, buffer, acquired);
+            }
+            capture_raw(ch, lroundf(a * 16), acquired);
         }
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+
+        trace_end(SAMPLE, ch);
     }
 }
 
-static void dispense_plant_food(void *arg)
+// Switches a pump for dosing_run()
+static void set_pump(int ch, int level)
+{
+    int64_t now = esp_timer_get_time();
+    io_output_set(ch, level);
+    state_publish(ch, level, now);
+    capture_raw(ch, level, now);
+}
+
+// A running dose stops once a rule holds its pump off or it is cancelled
+static bool dose_stopped(int ch)
+{
+    return rules_output(ch) == 0 || state_dispense_cancelled(ch);
+}
+
+// Doses one pump channel for the dose_ms parameter, or the length given
+// with the request, each time it is requested; see dosing.h
+static void dispense(void *arg)
 {
-    ESP_LOGI("Motor", "Dispensing PLANT_FOOD");
+    int ch = ARG_CHANNEL(arg);
 
-    gpio_reset_pin(PLANT_FOOD_PIN);
-    gpio_set_direction(PLANT_FOOD_PIN, GPIO_MODE_OUTPUT);
+    DLOG(MOTOR_READY, ch);
+    io_output_init(ch);
 
     while (1)
     {
-        if (should_dispense_plant_food)
+        if (state_dispense_requested(ch) && rules_output(ch) == 0)
         {
-            ESP_LOGI("Motor", "Activating PLANT_FOOD_PIN");
-            gpio_set_level(PLANT_FOOD_PIN, 1);
-            vTaskDelay(FLOW_DURATION / portTICK_PERIOD_MS);
-            gpio_set_level(PLANT_FOOD_PIN, 0);
-            should_dispense_plant_food = false;
+            // Held off by a rule
+            state_request_dispense(ch, false);
         }
-        vTaskDelay(100 / portTICK_PERIOD_MS); // Add a small delay to prevent busy looping
+        else if (state_dispense_requested(ch))
+        {
+            DLOG(MOTOR_ACTIVATE, ch);
+            trace_begin(DOSE, ch);
+            uint32_t dose_ms = state_dose_ms(ch);
+            dosing_run(ch, dose_ms ? dose_ms : (uint32_t)param_int(PARAM_DOSE_MS), set_pump, dose_stopped);
+            trace_end(DOSE, ch);
+            state_request_dispense(ch, false);
+        }
+        vTaskDelay(DOSING_POLL_MS / portTICK_PERIOD_MS);
     }
 }
 
 static void get_water_level(void *arg)
 {
-    // read the value from pin 5
+    int ch = ARG_CHANNEL(arg);
+    topo_period_t period = {0};
+
     while (1)
     {
-        int water_level = gpio_get_level(WATER_LEVEL_PIN);
+        topo_period_wait(&period, ch, param_int(PARAM_SAMPLE_MS));
+        trace_begin(SAMPLE, ch);
+        int64_t acquired = esp_timer_get_time();
+        int water_level = io_input_get(ch);
+        state_publish(ch, water_level, acquired);
+        capture_raw(ch, water_level, acquired);
+        rollup_add(ch, water_level);
 
         if (water_level == 0)
         {
-            uart_write_bytes(ECHO_UART_PORT_NUM, "WL: LOW", strlen("WL: LOW"));
+            send_reading(ch, water_level, " LOW", acquired);
         }
         else
         {
-            uart_write_bytes(ECHO_UART_PORT_NUM, "WL: HIGH", strlen("WL: HIGH"));
+            send_reading(ch, water_level, " HIGH", acquired);
         }
 
-        vTaskDelay(flash_period / portTICK_PERIOD_MS);
+        trace_end(SAMPLE, ch);
     }
 }
 
-static void get_ph_value(void *arg)
+#if CONFIG_HYDRO_PH_SETTLE
+// Latest prediction of each tank, from get_ph_value to auto_PH
+static struct
 {
-    // Configure ADC1 to read from channel 7 (GPIO25 / A1)
-    adc1_config_width(ADC_WIDTH_BIT_12);                        // Set ADC resolution to 12 bits
-    adc1_config_channel_atten(ADC1_CHANNEL_6, ADC_ATTEN_DB_11); // Set attenuation for full-scale voltage
-    float ph_value = 0;
-    while (1)
+    ph_settle_status_t status;
+    float final;
+} s_settle[HYDRO_TANK_COUNT];
+static portMUX_TYPE s_settle_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Starts the prediction over when a pump of the tank switched since the
+// last reading, adds the reading, and sends
+// "Y:<tank> <status> <final> <ci> <tau s>" while a dose is mixing in, see
+// ph_settle.h. switched_us is the latest switch seen.
+static void settle_update(int tank, ph_settle_t *settle, int64_t *switched_us, float ph, int64_t acquired_us)
+{
+    static const hydro_role_t pumps[] = {HYDRO_ROLE_PH_UP, HYDRO_ROLE_PH_DOWN, HYDRO_ROLE_PLANT_FOOD};
+    for (size_t i = 0; i < sizeof(pumps) / sizeof(pumps[0]); i++)
     {
-        // Read the analog value from GPIO25 (ADC1_CHANNEL_7)
-        ph_value = adc1_get_raw(ADC1_CHANNEL_6);
-
-        float ph_value_calibrated = -0.00476 * ph_value + 15.28; // Calibrate the value to get the pH level
+        state_sample_t pump;
+        int ch = hydro_channel_find(tank, pumps[i]);
+        if (ch >= 0 && state_read(ch, &pump) && pump.timestamp_us > *switched_us)
+        {
+            *switched_us = pump.timestamp_us;
+            ph_settle_start(settle, pump.timestamp_us / 1000);
+        }
+    }
 
-        // convert float value to string before sending
-        char buffer[20];
-        snprintf(buffer, sizeof(buffer), "%.2f", ph_value_calibrated);
+    ph_settle_status_t before = settle->status;
+    ph_settle_status_t status = ph_settle_add(settle, acquired_us / 1000, ph, param_float(PARAM_PH_BAND) / 2);
+    if (status != PH_SETTLE_IDLE || before != PH_SETTLE_IDLE)
+    {
+        char line[48];
+        int n = snprintf(line, sizeof(line), "Y:%d %d %.2f %.2f %.0f\n", tank, status, settle->final, settle->ci,
+                         settle->tau_s);
+        transport_write(line, n);
+    }
 
-        char result[50];                             // Ensure the array is large enough to hold the concatenated string
-        strcpy(result, "PH:");                       // Copy the initial string into the result
-        char *return_value = strcat(result, buffer); // Append buffer to result and get the return value
+    portENTER_CRITICAL(&s_settle_lock);
+    s_settle[tank].status = status;
+    s_settle[tank].final = settle->final;
+    portEXIT_CRITICAL(&s_settle_lock);
+}
+#endif
 
-        uart_write_bytes(ECHO_UART_PORT_NUM, return_value, strlen(return_value));
-        // Delay for 1 second before reading again
+static void get_ph_value(void *arg)
+{
+    int ch = ARG_CHANNEL(arg);
 
-        PH_VALUE_NOW = ph_value_calibrated;
-        vTaskDelay(2200 / portTICK_PERIOD_MS); // Delay for 1 second
+    io_adc_init(ch);
+    float ph_value = 0;
+#if CONFIG_HYDRO_PH_SETTLE
+    ph_settle_t settle;
+    int64_t switched_us = esp_timer_get_time();
+    ph_settle_init(&settle);
+#endif
+    topo_period_t period = {0};
+    while (1)
+    {
+        topo_period_wait(&period, ch, param_int(PARAM_PH_SAMPLE_MS));
+        trace_begin(SAMPLE, ch);
+        int64_t acquired = esp_timer_get_time();
+        trace_begin(ADC_READ, ch);
+        ph_value = io_adc_read(ch);
+        trace_end(ADC_READ, ch);
+
+        float ph_value_calibrated = HYDRO_PH_SLOPE * ph_value + HYDRO_PH_OFFSET; // Calibrate the value to get the pH level
+        if (reading_sound(ch, ph_value_calibrated, acquired))
+        {
+            state_publish(ch, ph_value_calibrated, acquired);
+            rollup_add(ch, ph_value_calibrated);
+
+            // convert float value to string before sending
+            char buffer[20];
+            snprintf(buffer, sizeof(buffer), "%.2f", ph_value_calibrated);
+            send_reading(ch, ph_value_calibrated, buffer, acquired);
+#if CONFIG_HYDRO_PH_SETTLE
+            settle_update(hydro_channels[ch].tank, &settle, &switched_us, ph_value_calibrated, acquired);
+#endif
+        }
+        capture_raw(ch, ph_value, acquired);
+        trace_end(SAMPLE, ch);
     }
 }
 
-static void light_control_led(int val)
+// Drives the grow light and publishes its state on the GROW_LIGHT channel,
+// unless a rule holds it. Called from light_check and toggle_led only.
+static void light_control_led(int tank, int val)
 {
+    int ch = hydro_channel_find(tank, HYDRO_ROLE_GROW_LIGHT);
+
     val = (val < 0) ? 0 : (val > 4096) ? 4096
                                        : val;
-    gpio_reset_pin(LIGHT_CHECK_PIN);
-    gpio_set_direction(LIGHT_CHECK_PIN, GPIO_MODE_OUTPUT);
+    io_output_init(ch);
 
-    if (val > 1000)
-    {
-        leds_on = true;
-        gpio_set_level(LIGHT_CHECK_PIN, 1);
-    }
-    else
-    {
-        leds_on = false;
-        gpio_set_level(LIGHT_CHECK_PIN, 0);
-    }
+    int held = rules_output(ch);
+    int level = held != RULES_FREE ? held : val > param_int(PARAM_LIGHT_THRESHOLD);
+    int64_t now = esp_timer_get_time();
+    io_output_set(ch, level);
+    state_publish(ch, level, now);
+    capture_raw(ch, level, now);
 
     vTaskDelay(10 / portTICK_PERIOD_MS);
 }
 
 static void toggle_led(void *arg)
 {
+    int tank = (int)(intptr_t)arg;
+    int grow_light = hydro_channel_find(tank, HYDRO_ROLE_GROW_LIGHT);
     while (1)
     {
-        if (should_toggle_leds)
+        state_sample_t led;
+        if (state_get_flag(tank, STATE_FLAG_TOGGLE_LEDS))
         {
-            if (leds_on)
+            if (state_read(grow_light, &led) && led.value != 0)
             {
-                light_control_led(0);
+                light_control_led(tank, 0);
             }
             else
             {
-                light_control_led(4000);
+                light_control_led(tank, 4000);
             }
         }
+        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 }
 
 static void light_check(void *arg)
 {
-    // Configure ADC1 to read from channel 3 (GPIO39 / A3)
-    adc1_config_width(ADC_WIDTH_BIT_12);                        // Set ADC resolution to 12 bits
-    adc1_config_channel_atten(ADC1_CHANNEL_3, ADC_ATTEN_DB_11); // Set attenuation for full-scale voltage
+    int ch = ARG_CHANNEL(arg);
+    int tank = hydro_channels[ch].tank;
+
+    io_adc_init(ch);
 
     int light_value = 0;
+    topo_period_t period = {0};
     while (1)
     {
-
-        
-        // Read the analog value from GPIO25 (ADC1_CHANNEL_7)
-        light_value = adc1_get_raw(ADC1_CHANNEL_3);
-
-        // Print the ADC to the console
-        light_control_led(light_value);
+        topo_period_wait(&period, ch, param_int(PARAM_LIGHT_SAMPLE_MS));
+        trace_begin(SAMPLE, ch);
+        int64_t acquired = esp_timer_get_time();
+        trace_begin(ADC_READ, ch);
+        light_value = io_adc_read(ch);
+        trace_end(ADC_READ, ch);
+        state_publish(ch, light_value, acquired);
+        capture_raw(ch, light_value, acquired);
+        rollup_add(ch, light_value);
+
+        light_control_led(tank, light_value);
 
         char buffer[20];
         snprintf(buffer, sizeof(buffer), "%.2d", light_value);
+        send_reading(ch, light_value, buffer, acquired);
 
-        char result[50];                             // Ensure the array is large enough to hold the concatenated string
-        strcpy(result, "L:");                        // Copy the initial string into the result
-        char *return_value = strcat(result, buffer); // Append buffer to result and get the return value
-
-        uart_write_bytes(ECHO_UART_PORT_NUM, return_value, strlen(return_value));
-
-        // Delay for 1 second before reading again
-        vTaskDelay(250 / portTICK_PERIOD_MS); // Delay for 1 second
+        trace_end(SAMPLE, ch);
     }
 }
 
 static void auto_PH(void *arg)
 {
-    set_ph_value = 6.0;
-    int cnt = 1;
+    int tank = (int)(intptr_t)arg;
+    int ph = hydro_channel_find(tank, HYDRO_ROLE_PH);
+    int ph_up = hydro_channel_find(tank, HYDRO_ROLE_PH_UP);
+    int ph_down = hydro_channel_find(tank, HYDRO_ROLE_PH_DOWN);
+
+    ph_control_t control = {0};
     while (1)
     {
-        if (should_auto_ph)
+        if (state_get_flag(tank, STATE_FLAG_AUTO_PH))
         {
-            if (PH_VALUE_NOW < set_ph_value - error_ph)
+            state_sample_t ph_now = {0};
+            int64_t age_ms = INT64_MAX;
+            if (state_read(ph, &ph_now))
             {
-                should_dispense_ph_up = true;
+                age_ms = (esp_timer_get_time() - ph_now.timestamp_us) / 1000;
             }
-            else if (PH_VALUE_NOW > set_ph_value + error_ph)
+            ph_settle_status_t settling = PH_SETTLE_IDLE;
+            float final = 0;
+#if CONFIG_HYDRO_PH_SETTLE
+            portENTER_CRITICAL(&s_settle_lock);
+            settling = s_settle[tank].status;
+            final = s_settle[tank].final;
+            portEXIT_CRITICAL(&s_settle_lock);
+#endif
+            switch (ph_control_check(&control, age_ms, ph_now.value, settling, final, param_float(PARAM_PH_TARGET),
+                                     param_float(PARAM_PH_BAND)))
             {
-                should_dispense_ph_down = true;
+            case PH_ACTION_UP:
+                state_request_dispense(ph_up, true);
+                break;
+            case PH_ACTION_DOWN:
+                state_request_dispense(ph_down, true);
+                break;
+            case PH_ACTION_NONE:
+                state_request_dispense(ph_up, false);
+                state_request_dispense(ph_down, false);
+                break;
             }
-            else
+        }
+        // Also while off, so the task does not spin until AUTOPH
+        vTaskDelay(param_int(PARAM_PH_CHECK_MS) / portTICK_PERIOD_MS);
+    }
+}
+
+// Channels stopped by 'Q' and restarted by 'S'
+static bool is_pausable(int ch)
+{
+    hydro_role_t role = hydro_channels[ch].role;
+    return role != HYDRO_ROLE_PLANT_FOOD && role != HYDRO_ROLE_GROW_LIGHT;
+}
+
+static void set_tasks_running(bool running)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (channelTaskHandles[ch] && is_pausable(ch))
+        {
+            running ? vTaskResume(channelTaskHandles[ch]) : vTaskSuspend(channelTaskHandles[ch]);
+        }
+    }
+    for (int tank = 0; tank < HYDRO_TANK_COUNT; tank++)
+    {
+        if (autoPHValueHandles[tank])
+        {
+            running ? vTaskResume(autoPHValueHandles[tank]) : vTaskSuspend(autoPHValueHandles[tank]);
+        }
+    }
+}
+
+static void write_line(const char *line, int len)
+{
+    transport_write(line, len);
+}
+
+// Floods the transport for the jitter benchmark each time "JL" wakes it
+static void uart_load(void *arg)
+{
+    static const char filler[] = "X:................................................................\n";
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t end = esp_timer_get_time() + CONFIG_HYDRO_JITTER_LOAD_S * 1000000LL;
+        while (esp_timer_get_time() < end)
+        {
+            transport_write(filler, strlen(filler));
+        }
+    }
+}
+
+// "J" dumps the sampling-interval stats, "JR" resets them, "JL" adds transport load
+static void jitter_command(const uint8_t *data, int len)
+{
+    char line[128];
+    switch (len > 1 ? data[1] : 0)
+    {
+    case 'R':
+        topo_jitter_reset();
+        break;
+    case 'L':
+        xTaskNotifyGive(uartLoadHandle);
+        break;
+    default:
+        for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+        {
+            int n = topo_jitter_format(ch, hydro_channels[ch].name, line, sizeof(line));
+            if (n > 0)
             {
-                should_dispense_ph_up = false;
-                should_dispense_ph_down = false;
+                write_line(line, n);
             }
-            cnt += 1;
-            if (cnt == 50)
+        }
+        break;
+    }
+}
+
+// "H" dumps the jitter and latency histograms of every channel, "HR" resets them
+static void histogram_command(const uint8_t *data, int len)
+{
+    char line[HIST_BUCKETS * 16 + 64];
+    if (len > 1 && data[1] == 'R')
+    {
+        hist_reset();
+        return;
+    }
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        for (int kind = 0; kind < HIST_KIND_COUNT; kind++)
+        {
+            int n = hist_format(ch, hydro_channels[ch].name, kind, line, sizeof(line));
+            if (n > 0)
             {
-                cnt = 1;
-                should_dispense_ph_down = false;
-                should_dispense_ph_up = false;
+                write_line(line, n);
             }
-            vTaskDelay(1000 / portTICK_PERIOD_MS); // Delay for 1 second
         }
     }
 }
 
-static void echo_task(void *arg)
+// "X" sends the whole flash log, "X<from>,<to>" the pages overlapping a
+// range of epoch seconds
+static void export_command(const uint8_t *data, int len)
+{
+    char *end;
+    uint32_t from_s = 0, to_s = UINT32_MAX;
+    if (len > 1)
+    {
+        from_s = strtoul((const char *)data + 1, &end, 10);
+        if (*end == ',')
+        {
+            to_s = strtoul(end + 1, NULL, 10);
+        }
+    }
+    tsdb_export(from_s, to_s, write_line);
+}
+
+// "A<tier>" sends the rollups of a tier ("AM" for minutes), "AM10" only the
+// last ten closed buckets
+static void rollup_command(const uint8_t *data, int len)
+{
+    int tier = len > 1 ? rollup_tier(data[1]) : -1;
+    if (tier < 0)
+    {
+        write_line("A:end\n", 6);
+        return;
+    }
+    rollup_dump(tier, atoi((const char *)data + 2), write_line);
+}
+
+// "N" sends how many readings of each channel were sent and held back
+static void report_command(void)
+{
+    char line[64];
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        int n = report_format(ch, line, sizeof(line));
+        if (n > 0)
+        {
+            write_line(line, n);
+        }
+    }
+}
+
+// "C<epoch seconds>" sets the clock the flash log is timestamped with
+static void clock_command(const uint8_t *data, int len)
 {
-    /* Configure parameters of an UART driver,
-     * communication pins and install the driver */
-    uart_config_t uart_config = {
-        .baud_rate = ECHO_UART_BAUD_RATE,
-        .data_bits = UART_DATA_8_BITS,
-        .parity = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
-        .source_clk = UART_SCLK_DEFAULT,
-    };
-    int intr_alloc_flags = 0;
-
-#if CONFIG_UART_ISR_IN_IRAM
-    intr_alloc_flags = ESP_INTR_FLAG_IRAM;
+#if CONFIG_IDF_TARGET_LINUX
+    // The host's clock, which is already set
+    (void)data;
+    (void)len;
+#else
+    struct timeval now = {.tv_sec = strtoul((const char *)data + 1, NULL, 10)};
+    if (len > 1 && now.tv_sec > 0)
+    {
+        settimeofday(&now, NULL);
+    }
 #endif
+}
+
+// Handlers of the sequenced commands, see cmd_proto.h
 
-    ESP_ERROR_CHECK(uart_driver_install(ECHO_UART_PORT_NUM, BUF_SIZE * 2, 0, 0, NULL, intr_alloc_flags));
-    ESP_ERROR_CHECK(uart_param_config(ECHO_UART_PORT_NUM, &uart_config));
-    ESP_ERROR_CHECK(uart_set_pin(ECHO_UART_PORT_NUM, ECHO_TEST_TXD, ECHO_TEST_RXD, ECHO_TEST_RTS, ECHO_TEST_CTS));
+static bool valid_tank(int32_t tank)
+{
+    return tank >= 0 && tank < HYDRO_TANK_COUNT;
+}
+
+static cmd_result_t cmd_ping(const cmd_arg_t *args, char *reply, size_t len)
+{
+    return CMD_OK;
+}
 
-    // Configure a temporary buffer for the incoming data
-    uint8_t *data = (uint8_t *)malloc(BUF_SIZE);
+// F, U or D of the DOSE verbs, HYDRO_ROLE_COUNT for anything else
+static hydro_role_t pump_role(char c)
+{
+    return c == 'F' ? HYDRO_ROLE_PLANT_FOOD
+           : c == 'U' ? HYDRO_ROLE_PH_UP
+           : c == 'D' ? HYDRO_ROLE_PH_DOWN
+                      : HYDRO_ROLE_COUNT;
+}
 
-    uart_write_bytes(ECHO_UART_PORT_NUM, "Commands", strlen("Commands"));
+// Pump channel by HYDRO_CHANNEL_TABLE name, -1 if there is none
+static int pump_named(const char *name)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (HYDRO_ROLE_IS_PUMP(hydro_channels[ch].role) && strcmp(name, hydro_channels[ch].name) == 0)
+        {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+// DOSE <tank> <F|U|D> <ms>
+static cmd_result_t cmd_dose(const cmd_arg_t *args, char *reply, size_t len)
+{
+    hydro_role_t role = pump_role(args[1].c);
+    if (!valid_tank(args[0].i) || role == HYDRO_ROLE_COUNT || args[2].i < 10 || args[2].i > 60000)
+    {
+        return CMD_RANGE;
+    }
+    int ch = hydro_channel_find(args[0].i, role);
+    if (state_dispense_requested(ch))
+    {
+        return CMD_BUSY;
+    }
+    state_request_dose(ch, args[2].i);
+    return CMD_OK;
+}
+
+// DOSEML <tank> <F|U|D> <ml>: a dose by volume, at the pump's calibration.
+// Replies with the pulse length in ms.
+static cmd_result_t cmd_dose_ml(const cmd_arg_t *args, char *reply, size_t len)
+{
+    hydro_role_t role = pump_role(args[1].c);
+    if (!valid_tank(args[0].i) || role == HYDRO_ROLE_COUNT || !(args[2].f > 0))
+    {
+        return CMD_RANGE;
+    }
+    int ch = hydro_channel_find(args[0].i, role);
+    uint32_t ms = dosing_ms(ch, args[2].f);
+    if (ms < 10)
+    {
+        return CMD_RANGE;
+    }
+    if (state_dispense_requested(ch))
+    {
+        return CMD_BUSY;
+    }
+    state_request_dose(ch, ms);
+    snprintf(reply, len, "%lu", (unsigned long)ms);
+    return CMD_OK;
+}
+
+// CAL <pump> <ml/s>: the flow of a pump, e.g. CAL T0_PH_UP 1.42
+static cmd_result_t cmd_cal(const cmd_arg_t *args, char *reply, size_t len)
+{
+    int ch = pump_named(args[0].s);
+    if (ch < 0 || !(args[1].f >= DOSING_ML_S_MIN && args[1].f <= DOSING_ML_S_MAX))
+    {
+        return CMD_RANGE;
+    }
+    dosing_calibrate(ch, args[1].f);
+    return CMD_OK;
+}
+
+// USAGE: one "O:" line per pump, see dosing.h, then OK with the count
+static cmd_result_t cmd_usage(const cmd_arg_t *args, char *reply, size_t len)
+{
+    snprintf(reply, len, "%d", dosing_list(write_line));
+    return CMD_OK;
+}
+
+// REFILL <pump>: start the pump's total over, after refilling its reagent
+static cmd_result_t cmd_refill(const cmd_arg_t *args, char *reply, size_t len)
+{
+    int ch = pump_named(args[0].s);
+    if (ch < 0)
+    {
+        return CMD_RANGE;
+    }
+    dosing_reset_total(ch);
+    return CMD_OK;
+}
+
+// CANCEL <tank>: drop pending pH doses and stop running ones
+static cmd_result_t cmd_cancel(const cmd_arg_t *args, char *reply, size_t len)
+{
+    if (!valid_tank(args[0].i))
+    {
+        return CMD_RANGE;
+    }
+    state_cancel_dispense(hydro_channel_find(args[0].i, HYDRO_ROLE_PH_UP));
+    state_cancel_dispense(hydro_channel_find(args[0].i, HYDRO_ROLE_PH_DOWN));
+    return CMD_OK;
+}
+
+// AUTOPH <tank> <0|1>
+static cmd_result_t cmd_auto_ph(const cmd_arg_t *args, char *reply, size_t len)
+{
+    if (!valid_tank(args[0].i))
+    {
+        return CMD_RANGE;
+    }
+    state_set_flag(args[0].i, STATE_FLAG_AUTO_PH, args[1].i != 0);
+    return CMD_OK;
+}
+
+// SETPH <target> <band>: the pH controller doses outside target +- band.
+// Shorthand for setting ph_target and ph_band.
+static cmd_result_t cmd_set_ph(const cmd_arg_t *args, char *reply, size_t len)
+{
+    float target = param_float(PARAM_PH_TARGET);
+    if (!param_set_value(PARAM_PH_TARGET, args[0].f))
+    {
+        return CMD_RANGE;
+    }
+    if (!param_set_value(PARAM_PH_BAND, args[1].f))
+    {
+        param_set_value(PARAM_PH_TARGET, target);
+        return CMD_RANGE;
+    }
+    return CMD_OK;
+}
+
+// PERIOD <ms>: sampling period of the temperature and water level tasks,
+// the sample_ms parameter
+static cmd_result_t cmd_period(const cmd_arg_t *args, char *reply, size_t len)
+{
+    return param_set_value(PARAM_SAMPLE_MS, args[0].i) ? CMD_OK : CMD_RANGE;
+}
+
+// LIGHT <tank> <0|1>: blink the grow light
+static cmd_result_t cmd_light(const cmd_arg_t *args, char *reply, size_t len)
+{
+    if (!valid_tank(args[0].i))
+    {
+        return CMD_RANGE;
+    }
+    state_set_flag(args[0].i, STATE_FLAG_TOGGLE_LEDS, args[1].i != 0);
+    return CMD_OK;
+}
+
+// RUN <0|1>: resume or pause the sensing and dosing tasks
+static cmd_result_t cmd_run(const cmd_arg_t *args, char *reply, size_t len)
+{
+    set_tasks_running(args[0].i != 0);
+    return CMD_OK;
+}
+
+// READ <channel name>: replies "<value> <age ms>"
+static cmd_result_t cmd_read(const cmd_arg_t *args, char *reply, size_t len)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (strcmp(args[0].s, hydro_channels[ch].name) == 0)
+        {
+            state_sample_t sample;
+            if (!state_read(ch, &sample))
+            {
+                return CMD_BUSY;
+            }
+            snprintf(reply, len, "%.*f %lld", hydro_role_decimals(hydro_channels[ch].role), sample.value,
+                     (long long)((esp_timer_get_time() - sample.timestamp_us) / 1000));
+            return CMD_OK;
+        }
+    }
+    return CMD_RANGE;
+}
+
+// GET <key>: replies with the parameter's value, min and max
+static cmd_result_t cmd_get(const cmd_arg_t *args, char *reply, size_t len)
+{
+    int id = param_find(args[0].s);
+    if (id < 0)
+    {
+        return CMD_RANGE;
+    }
+    // Skip the key
+    char line[64];
+    param_format(id, line, sizeof(line));
+    snprintf(reply, len, "%s", line + strlen(args[0].s) + 1);
+    return CMD_OK;
+}
+
+// SET <key> <value>
+static cmd_result_t cmd_set(const cmd_arg_t *args, char *reply, size_t len)
+{
+    int id = param_find(args[0].s);
+    if (id < 0)
+    {
+        return CMD_RANGE;
+    }
+    return param_set(id, args[1].s) ? CMD_OK : CMD_ARGS;
+}
+
+// LIST: one "K:<key> <value> <min> <max>" line per parameter, then OK with
+// the count
+static cmd_result_t cmd_list(const cmd_arg_t *args, char *reply, size_t len)
+{
+    char line[72];
+    for (int id = 0; id < PARAM_COUNT; id++)
+    {
+        int n = snprintf(line, sizeof(line), "K:");
+        n += param_format(id, line + n, sizeof(line) - n - 1);
+        line[n++] = '\n';
+        write_line(line, n);
+    }
+    snprintf(reply, len, "%d", PARAM_COUNT);
+    return CMD_OK;
+}
+
+// SAVE: write changed parameters and pump totals to NVS now
+static cmd_result_t cmd_save(const cmd_arg_t *args, char *reply, size_t len)
+{
+    params_save();
+    dosing_save();
+    return CMD_OK;
+}
+
+// CAPTURE <0|1>: raw sensor input capture for tools/replay, see capture.h
+static cmd_result_t cmd_capture(const cmd_arg_t *args, char *reply, size_t len)
+{
+    capture_set(args[0].i != 0);
+    return CMD_OK;
+}
+
+#if CONFIG_HYDRO_RULES
+// RULE <slot> <rule...>: compile a rule into a slot, see rule_vm.h. Replies
+// with the size of its bytecode.
+static cmd_result_t cmd_rule(const cmd_arg_t *args, char *reply, size_t len)
+{
+    if (args[0].i < 0 || args[0].i >= RULES_COUNT)
+    {
+        return CMD_RANGE;
+    }
+    int bytes = rules_set(args[0].i, args[1].s);
+    if (bytes < 0)
+    {
+        return CMD_ARGS;
+    }
+    snprintf(reply, len, "%d", bytes);
+    return CMD_OK;
+}
+
+// RULEDEL <slot>
+static cmd_result_t cmd_rule_del(const cmd_arg_t *args, char *reply, size_t len)
+{
+    if (args[0].i < 0 || args[0].i >= RULES_COUNT)
+    {
+        return CMD_RANGE;
+    }
+    rules_clear(args[0].i);
+    return CMD_OK;
+}
+
+// RULES: one "U:" line per rule, see rules.h, then OK with the count
+static cmd_result_t cmd_rules(const cmd_arg_t *args, char *reply, size_t len)
+{
+    snprintf(reply, len, "%d", rules_list(write_line));
+    return CMD_OK;
+}
+#endif
+
+static const cmd_verb_t s_verbs[] = {
+    {"PING", "", cmd_ping},
+    {"DOSE", "ici", cmd_dose},
+    {"DOSEML", "icf", cmd_dose_ml},
+    {"CAL", "sf", cmd_cal},
+    {"USAGE", "", cmd_usage},
+    {"REFILL", "s", cmd_refill},
+    {"CANCEL", "i", cmd_cancel},
+    {"AUTOPH", "ii", cmd_auto_ph},
+    {"SETPH", "ff", cmd_set_ph},
+    {"PERIOD", "i", cmd_period},
+    {"LIGHT", "ii", cmd_light},
+    {"RUN", "i", cmd_run},
+    {"READ", "s", cmd_read},
+    {"GET", "s", cmd_get},
+    {"SET", "ss", cmd_set},
+    {"LIST", "", cmd_list},
+    {"SAVE", "", cmd_save},
+    {"CAPTURE", "i", cmd_capture},
+#if CONFIG_HYDRO_RULES
+    {"RULE", "ir", cmd_rule},
+    {"RULEDEL", "i", cmd_rule_del},
+    {"RULES", "", cmd_rules},
+#endif
+};
+
+static void echo_task(void *arg)
+{
+    // Buffer for the incoming data, sized in MEM_BUFFER_TABLE
+    uint8_t *data = mem_buffer_ECHO_RX;
+
+    transport_write("Commands", strlen("Commands"));
     while (1)
     {
-        // Read data from the UART
-        int len = uart_read_bytes(ECHO_UART_PORT_NUM, data, (BUF_SIZE - 1), 20 / portTICK_PERIOD_MS);
-        // Write data back to the UART
-        uart_write_bytes(ECHO_UART_PORT_NUM, (const char *)data, len);
-        if (len)
+        // Read data from the transport
+        int len = transport_read(data, BUF_SIZE - 1, 20);
+        params_poll();
+        dosing_poll();
+        if (len > 0 && cmd_feed(data, len))
+        {
+            continue;
+        }
+        // Write data back, except link commands, whose reply may be followed
+        // by a rate change
+        if (len > 0 && data[0] != 'B')
+        {
+            transport_write((const char *)data, len);
+        }
+        if (len > 0)
         {
             data[len] = '\0';
+
+            // An optional tank digit follows the command letter ("U1")
+            int tank = (len > 1 && data[1] >= '0' && data[1] < '0' + HYDRO_TANK_COUNT) ? data[1] - '0' : 0;
+            int ph_up = hydro_channel_find(tank, HYDRO_ROLE_PH_UP);
+            int ph_down = hydro_channel_find(tank, HYDRO_ROLE_PH_DOWN);
+
+            trace_begin(COMMAND, data[0]);
             switch (data[0])
             {
             case 'I':
-                uart_write_bytes(ECHO_UART_PORT_NUM, "ESP32-Hydroponic garden system", strlen("ESP32-Hydroponic garden system"));
+                transport_write("ESP32-Hydroponic garden system", strlen("ESP32-Hydroponic garden system"));
                 break;
             case 'F':
-                should_dispense_plant_food = true;
+                state_request_dispense(hydro_channel_find(tank, HYDRO_ROLE_PLANT_FOOD), true);
                 break;
             case 'U':
-                should_dispense_ph_up = true;
+                state_request_dispense(ph_up, true);
                 break;
             case 'D':
-                should_dispense_ph_down = true;
+                state_request_dispense(ph_down, true);
                 break;
             case 'R':
-                should_dispense_ph_up = false;
-                should_dispense_ph_down = false;
+                state_request_dispense(ph_up, false);
+                state_request_dispense(ph_down, false);
                 break;
             case 'P':
-                should_auto_ph = true;
-                if (should_dispense_ph_down == false && should_dispense_ph_up == false)
-                {
-                    should_auto_ph = false;
-                }
+                state_set_flag(tank, STATE_FLAG_AUTO_PH, true);
                 break;
             case 'L':
             {
-                should_toggle_leds = true;
+                state_set_flag(tank, STATE_FLAG_TOGGLE_LEDS, true);
             }
             break;
             case 'S':
-                vTaskResume(getPHValueHandle);
-                vTaskResume(lightCheckHandle);
-                vTaskResume(getWaterLevelHandle);
-                vTaskResume(getTemperatureHandle);
-                vTaskResume(dispensePhUpHandle);
-                vTaskResume(dispensePhDownHandle);
-                vTaskResume(autoPHValueHandle);
+                set_tasks_running(true);
                 break;
             case 'Q':
-                vTaskSuspend(getPHValueHandle);
-                vTaskSuspend(lightCheckHandle);
-                vTaskSuspend(getWaterLevelHandle);
-                vTaskSuspend(getTemperatureHandle);
-                vTaskSuspend(dispensePhUpHandle);
-                vTaskSuspend(dispensePhDownHandle);
-                vTaskSuspend(autoPHValueHandle);
+                set_tasks_running(false);
+                break;
+            case 'J':
+                jitter_command(data, len);
+                break;
+            case 'H':
+                histogram_command(data, len);
+                break;
+            case 'M':
+                mem_report(write_line);
+                break;
+            case 'X':
+                export_command(data, len);
+                break;
+            case 'C':
+                clock_command(data, len);
+                break;
+            case 'A':
+                rollup_command(data, len);
+                break;
+            case 'Z':
+                telemetry_set_compressed(len < 2 || data[1] != '0');
+                break;
+            case 'N':
+                report_command();
+                break;
+            case 'B':
+                transport_link_command(data, len);
+                break;
+            case 'T':
+                if (len > 1 && data[1] == 'C')
+                {
+                    trace_clear();
+                }
+                else
+                {
+                    trace_dump(write_line);
+                }
                 break;
             default:
                 break;
             }
+            trace_end(COMMAND, data[0]);
         }
     }
 }
 
 void app_main(void)
 {
+    // The UART, ADC, RMT, 1-Wire and DS18B20 drivers allocate their objects
+    // here, once, and never free them
+    size_t heap_before = mem_heap_free();
+    transport_init();
+    io_init();
+    params_init();
+    trace_init();
+    rollup_init();
+    dlog_start(write_line);
+    telemetry_init(write_line);
+    capture_init(write_line);
+    dosing_init(write_line);
+    rules_start(write_line);
+    cmd_init(s_verbs, sizeof(s_verbs) / sizeof(s_verbs[0]), write_line);
+
+    // Detect the DS18B20 sensors, one bus per tank
+    sensor_self_test();
+    for (int tank = 0; tank < HYDRO_TANK_COUNT; tank++)
+    {
+        sensor_detect(tank, hydro_channels[hydro_channel_find(tank, HYDRO_ROLE_TEMPERATURE)].io);
+    }
+    mem_note_driver_heap(heap_before, mem_heap_free());
 
-    // // LED Blinking
-    // gpio_set_direction(LED_BLINK_PIN, GPIO_MODE_OUTPUT);
-
-    // // GPIO for temp sensor, water level
-    // gpio_set_direction(TEMP_SENSOR_PIN, GPIO_MODE_INPUT);
-    // gpio_set_direction(WATER_LEVEL_PIN, GPIO_MODE_INPUT);
-
-    // Plant_Food dispense
-
-    // blink_led();
-    // printf("LED Blinking\n");
-
-    // Detect the DS18B20 sensor in the bus
-    sensor_detect();
-
-    xTaskCreate(echo_task, "uart_echo_task", ECHO_TASK_STACK_SIZE, NULL, 10, NULL);
-
-    // Start task to read the temperature from DS18B20 sensor
-    xTaskCreate(get_temperature, "temperature_detect", 4096, NULL, 5, &getTemperatureHandle);
-    xTaskCreate(get_water_level, "get_water_level", 2000, NULL, 5, &getWaterLevelHandle);
-
-    // Create the get_ph_value task
-    xTaskCreate(get_ph_value, "get_ph_value", 2000, NULL, 5, &getPHValueHandle);
-
-    xTaskCreate(dispense_ph_up, "dispense_ph_up", 4096, NULL, 5, &dispensePhUpHandle);
-
-    xTaskCreate(dispense_ph_down, "dispense_ph_down", 4096, NULL, 5, &dispensePhDownHandle);
+    topo_create_task(echo_task, "uart_echo_task", MEM_TASK_ECHO, NULL, TOPO_CLASS_COMMS, NULL);
+    topo_create_task(uart_load, "uart_load", MEM_TASK_UART_LOAD, NULL, TOPO_CLASS_COMMS, &uartLoadHandle);
 
-    xTaskCreate(light_check, "light_check", 4096, NULL, 5, &lightCheckHandle);
+    // One task per channel, picked by role
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        TaskFunction_t fn = NULL;
+        mem_task_t mem = MEM_TASK_DISPENSE;
+        topo_class_t cls = TOPO_CLASS_ACTUATE;
+        switch (hydro_channels[ch].role)
+        {
+        case HYDRO_ROLE_TEMPERATURE:
+            fn = get_temperature;
+            mem = MEM_TASK_TEMPERATURE;
+            cls = TOPO_CLASS_SENSE_TEMP;
+            break;
+        case HYDRO_ROLE_WATER_LEVEL:
+            fn = get_water_level;
+            mem = MEM_TASK_WATER_LEVEL;
+            cls = TOPO_CLASS_SENSE_LEVEL;
+            break;
+        case HYDRO_ROLE_PH:
+            fn = get_ph_value;
+            mem = MEM_TASK_PH;
+            cls = TOPO_CLASS_SENSE_PH;
+            break;
+        case HYDRO_ROLE_LIGHT:
+            fn = light_check;
+            mem = MEM_TASK_LIGHT;
+            cls = TOPO_CLASS_SENSE_LIGHT;
+            break;
+        case HYDRO_ROLE_PH_UP:
+        case HYDRO_ROLE_PH_DOWN:
+        case HYDRO_ROLE_PLANT_FOOD:
+            fn = dispense;
+            break;
+        default:
+            break; // grow light is driven by light_check and toggle_led
+        }
+        if (fn)
+        {
+            topo_create_task(fn, hydro_channels[ch].name, mem, CHANNEL_ARG(ch), cls, &channelTaskHandles[ch]);
+        }
+    }
 
-    xTaskCreate(toggle_led, "toggle_led", 4096, NULL, 5, &toggleLedsHandle);
+    for (int tank = 0; tank < HYDRO_TANK_COUNT; tank++)
+    {
+        topo_create_task(toggle_led, "toggle_led", MEM_TASK_TOGGLE_LED, (void *)(intptr_t)tank, TOPO_CLASS_CONTROL, &toggleLedsHandles[tank]);
+        topo_create_task(auto_PH, "auto_PH", MEM_TASK_AUTO_PH, (void *)(intptr_t)tank, TOPO_CLASS_CONTROL, &autoPHValueHandles[tank]);
+    }
 
-    // xTaskCreate(auto_PH, "auto_PH", 2000, NULL, 5, &autoPHValueHandle);
-}
\ No newline at end of file
+    tsdb_start();
+}
@@ -0,0 +1,244 @@
+#include "ph_loop.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "anomaly.h"
+
+static const char *s_keys[PARAM_COUNT] = {
+#define PARAM_KEY(id, key, type, def, min, max) [PARAM_##id] = key,
+    PARAM_TABLE(PARAM_KEY)
+#undef PARAM_KEY
+};
+
+static const float s_min[PARAM_COUNT] = {
+#define PARAM_MIN(id, key, type, def, min, max) [PARAM_##id] = min,
+    PARAM_TABLE(PARAM_MIN)
+#undef PARAM_MIN
+};
+
+static const float s_max[PARAM_COUNT] = {
+#define PARAM_MAX(id, key, type, def, min, max) [PARAM_##id] = max,
+    PARAM_TABLE(PARAM_MAX)
+#undef PARAM_MAX
+};
+
+static const float s_defaults[PARAM_COUNT] = {
+#define PARAM_DEFAULT(id, key, type, def, min, max) [PARAM_##id] = def,
+    PARAM_TABLE(PARAM_DEFAULT)
+#undef PARAM_DEFAULT
+};
+
+void ph_loop_defaults(float params[PARAM_COUNT])
+{
+    memcpy(params, s_defaults, sizeof(s_defaults));
+}
+
+bool ph_loop_param_set(float params[PARAM_COUNT], const char *arg)
+{
+    const char *eq = strchr(arg, '=');
+    if (eq == NULL)
+    {
+        return false;
+    }
+    for (int id = 0; id < PARAM_COUNT; id++)
+    {
+        if (strlen(s_keys[id]) == (size_t)(eq - arg) && strncmp(arg, s_keys[id], eq - arg) == 0)
+        {
+            float value = atof(eq + 1);
+            if (value < s_min[id] || value > s_max[id])
+            {
+                return false;
+            }
+            params[id] = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ph_loop_init(ph_loop_t *l, const float params[PARAM_COUNT], int64_t start_ms,
+                  void (*set_pump)(void *ctx, ph_loop_pump_t pump, bool on, int64_t now_ms), void *ctx)
+{
+    memset(l, 0, sizeof(*l));
+    l->target = params[PARAM_PH_TARGET];
+    l->band = params[PARAM_PH_BAND];
+    l->check_ms = params[PARAM_PH_CHECK_MS];
+    l->dose_ms = params[PARAM_DOSE_MS];
+    l->sampled_ms = INT64_MIN / 2;
+    l->next_check_ms = start_ms;
+    for (int pump = 0; pump < PH_LOOP_PUMP_COUNT; pump++)
+    {
+        l->pumps[pump].next_ms = start_ms;
+        l->pumps[pump].switched_ms = INT64_MIN / 2;
+    }
+    l->set_pump = set_pump;
+    l->ctx = ctx;
+#if CONFIG_HYDRO_PH_SETTLE
+    ph_settle_init(&l->settle);
+    l->switched_ms = INT64_MIN / 2;
+#endif
+}
+
+static void check(ph_loop_t *l)
+{
+    ph_settle_status_t settling = PH_SETTLE_IDLE;
+    float final = 0;
+#if CONFIG_HYDRO_PH_SETTLE
+    settling = l->settle.status;
+    final = l->settle.final;
+#endif
+    switch (ph_control_check(&l->control, l->next_check_ms - l->sampled_ms, l->ph, settling, final, l->target,
+                             l->band))
+    {
+    case PH_ACTION_UP:
+        l->pumps[PH_LOOP_UP].requested = true;
+        break;
+    case PH_ACTION_DOWN:
+        l->pumps[PH_LOOP_DOWN].requested = true;
+        break;
+    case PH_ACTION_NONE:
+        l->pumps[PH_LOOP_UP].requested = false;
+        l->pumps[PH_LOOP_DOWN].requested = false;
+        break;
+    }
+    l->next_check_ms += l->check_ms;
+}
+
+static void dispense(ph_loop_t *l, ph_loop_pump_t pump)
+{
+    ph_loop_dispenser_t *d = &l->pumps[pump];
+    int64_t now = d->next_ms;
+    if (d->on)
+    {
+        d->on = false;
+        d->switched_ms = now;
+        if (l->set_pump)
+        {
+            l->set_pump(l->ctx, pump, false, now);
+        }
+        if (++d->pulse < dosing_pulse_count(l->dose_ms))
+        {
+            d->next_ms = now + DOSING_REST_MS;
+            return;
+        }
+        d->pulse = 0;
+        d->requested = false;
+        d->next_ms = now + DOSING_POLL_MS;
+    }
+    else if (d->requested || d->pulse > 0)
+    {
+        d->on = true;
+        d->doses += d->pulse == 0;
+        d->next_ms = now + dosing_pulse_ms(l->dose_ms, d->pulse);
+        d->switched_ms = now;
+        if (l->set_pump)
+        {
+            l->set_pump(l->ctx, pump, true, now);
+        }
+    }
+    else
+    {
+        d->next_ms = now + DOSING_POLL_MS;
+    }
+}
+
+void ph_loop_run(ph_loop_t *l, int64_t until_ms)
+{
+    for (;;)
+    {
+        // Earliest task due; the controller goes first on a tie
+        int task = -1;
+        int64_t at = until_ms;
+        if (l->next_check_ms < at)
+        {
+            at = l->next_check_ms;
+            task = PH_LOOP_PUMP_COUNT;
+        }
+        for (int pump = 0; pump < PH_LOOP_PUMP_COUNT; pump++)
+        {
+            if (l->pumps[pump].next_ms < at)
+            {
+                at = l->pumps[pump].next_ms;
+                task = pump;
+            }
+        }
+        if (task < 0)
+        {
+            return;
+        }
+        if (task == PH_LOOP_PUMP_COUNT)
+        {
+            check(l);
+        }
+        else
+        {
+            dispense(l, task);
+        }
+    }
+}
+
+bool ph_loop_sound(int ch, float value, int64_t now_ms)
+{
+#if CONFIG_HYDRO_SENSOR_CHECK_OFF
+    return true;
+#else
+    uint32_t faults = anomaly_check(ch, value, now_ms * 1000);
+#if CONFIG_HYDRO_SENSOR_CHECK_FLAG
+    (void)faults;
+    return true;
+#else
+    return (faults & ANOMALY_DROP) == 0;
+#endif
+#endif
+}
+
+void ph_loop_reading(ph_loop_t *l, int64_t now_ms, float ph)
+{
+    l->ph = ph;
+    l->sampled_ms = now_ms;
+#if CONFIG_HYDRO_PH_SETTLE
+    // get_ph_value starts over from the latest pump switch it sees
+    for (int pump = 0; pump < PH_LOOP_PUMP_COUNT; pump++)
+    {
+        ph_loop_dispenser_t *d = &l->pumps[pump];
+        if (d->switched_ms > l->switched_ms && d->switched_ms <= now_ms)
+        {
+            l->switched_ms = d->switched_ms;
+            ph_settle_start(&l->settle, d->switched_ms);
+        }
+    }
+    ph_settle_add(&l->settle, now_ms, ph, l->band / 2);
+#endif
+}
+
+void ph_band_init(ph_band_stats_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->start_ms = -1;
+    s->settle_ms = -1;
+}
+
+void ph_band_add(ph_band_stats_t *s, int64_t now_ms, float ph, float target, float band)
+{
+    float outside = fabsf(ph - target) - band;
+    if (s->start_ms < 0)
+    {
+        s->start_ms = now_ms;
+    }
+    if (s->settle_ms < 0)
+    {
+        if (outside > 0)
+        {
+            return;
+        }
+        s->settle_ms = now_ms;
+    }
+    else
+    {
+        s->span_ms += now_ms - s->last_ms;
+        s->in_band_ms += s->last_in_band ? now_ms - s->last_ms : 0;
+        s->overshoot = fmaxf(s->overshoot, outside);
+    }
+    s->last_ms = now_ms;
+    s->last_in_band = outside <= 0;
+}
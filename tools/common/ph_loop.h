@@ -0,0 +1,98 @@
+#ifndef PH_LOOP_H
+#define PH_LOOP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dosing.h"
+#include "params.h"
+#include "ph_control.h"
+#include "ph_settle.h"
+#include "sdkconfig.h"
+
+/*
+ * The firmware's pH control tasks on a simulated clock, shared by the host
+ * tools. auto_PH runs ph_control_check() every ph_check_ms on the latest
+ * reading, and each dispense task polls every DOSING_POLL_MS and runs a
+ * requested pump for dose_ms, in the pulses of dosing.h. With
+ * CONFIG_HYDRO_PH_SETTLE, while a dose mixes in auto_PH doses on the
+ * prediction get_ph_value makes of where the pH settles. Readings come from
+ * the caller, which drops those ph_loop_sound() rejects, as the sampling
+ * tasks do before they publish; time only moves forward.
+ */
+
+typedef enum
+{
+    PH_LOOP_UP,
+    PH_LOOP_DOWN,
+    PH_LOOP_PUMP_COUNT,
+} ph_loop_pump_t;
+
+typedef struct
+{
+    bool requested;
+    bool on;
+    uint32_t pulse;  // of the dose running, 0 between doses
+    int64_t next_ms; // next poll, end of the pulse while on, or end of the rest
+    int64_t switched_ms;
+    int doses;
+} ph_loop_dispenser_t;
+
+typedef struct
+{
+    float target;
+    float band;
+    int32_t check_ms;
+    int32_t dose_ms;
+    ph_control_t control;
+    float ph;
+    int64_t sampled_ms;
+    int64_t next_check_ms;
+    ph_loop_dispenser_t pumps[PH_LOOP_PUMP_COUNT];
+#if CONFIG_HYDRO_PH_SETTLE
+    ph_settle_t settle;
+    int64_t switched_ms; // latest pump switch the prediction started from
+#endif
+    // Called as a pump switches, with the time it does; NULL if nothing
+    // responds to the pumps
+    void (*set_pump)(void *ctx, ph_loop_pump_t pump, bool on, int64_t now_ms);
+    void *ctx;
+} ph_loop_t;
+
+// Time a pH series spent in the band, counted from when it first got there
+typedef struct
+{
+    int64_t start_ms;  // first reading, -1 if none yet
+    int64_t settle_ms; // first reading in band, -1 if none yet
+    int64_t span_ms;   // from settling to the last reading
+    int64_t in_band_ms;
+    float overshoot; // furthest outside the band once settled
+    int64_t last_ms;
+    bool last_in_band;
+} ph_band_stats_t;
+
+// Parameters at their params.h defaults
+void ph_loop_defaults(float params[PARAM_COUNT]);
+
+// Set "<key>=<value>" by params.h key. Returns false if unknown or out of
+// range.
+bool ph_loop_param_set(float params[PARAM_COUNT], const char *arg);
+
+// The tasks start at start_ms
+void ph_loop_init(ph_loop_t *l, const float params[PARAM_COUNT], int64_t start_ms,
+                  void (*set_pump)(void *ctx, ph_loop_pump_t pump, bool on, int64_t now_ms), void *ctx);
+
+// Run the tasks for everything due before until_ms
+void ph_loop_run(ph_loop_t *l, int64_t until_ms);
+
+// reading_sound() of the firmware without its "F:" lines: runs a sensor
+// reading taken at now_ms through anomaly_check() and returns false if the
+// firmware would drop it. anomaly_reset() starts a channel over.
+bool ph_loop_sound(int ch, float value, int64_t now_ms);
+
+// A pH reading published at now_ms
+void ph_loop_reading(ph_loop_t *l, int64_t now_ms, float ph);
+
+void ph_band_init(ph_band_stats_t *s);
+void ph_band_add(ph_band_stats_t *s, int64_t now_ms, float ph, float target, float band);
+
+#endif // PH_LOOP_H
@@ -0,0 +1,10 @@
+// Firmware options for the host tools: the channel table of two tanks,
+// which also covers captures from one, and the report policy, sensor checks
+// and pH settling prediction as built by default
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_HYDRO_TANK_COUNT 2
+#define CONFIG_HYDRO_REPORT_POLICY 1
+#define CONFIG_HYDRO_SENSOR_CHECK_DROP 1
+#define CONFIG_HYDRO_PH_SETTLE 1
+// Kconfig default of the auto_PH reading age limit
+#define CONFIG_HYDRO_PH_MAX_AGE_MS 5000
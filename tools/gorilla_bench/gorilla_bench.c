@@ -0,0 +1,199 @@
+/*
+ * Compression ratio and encode time of main/gorilla.c on recorded telemetry.
+ *
+ *   gorilla_bench [-b block_bytes] [-f flush_ms] trace.csv...
+ *
+ * A trace has one "<ms>,<tag>,<value>" line per reading, as written by the
+ * bridge with RECORD=trace.csv. Blocks are cut as on the device: when full
+ * or flush_ms after their first sample.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gorilla.h"
+
+#define MAX_TAGS 32
+#define MAX_SAMPLES 2000000
+#define REPEAT 20
+
+typedef struct
+{
+    char tag[16];
+    int decimals;
+    size_t count;
+    size_t text_bytes; // "<tag>:<value>" as sent uncompressed
+    uint32_t *ms;
+    int32_t *values;
+} series_t;
+
+static series_t s_series[MAX_TAGS];
+static int s_series_count;
+
+static series_t *series_for(const char *tag, int decimals)
+{
+    for (int i = 0; i < s_series_count; i++)
+    {
+        if (strcmp(s_series[i].tag, tag) == 0)
+        {
+            return &s_series[i];
+        }
+    }
+    if (s_series_count == MAX_TAGS)
+    {
+        return NULL;
+    }
+    series_t *s = &s_series[s_series_count++];
+    // load() reads at most 15 characters of tag
+    snprintf(s->tag, sizeof(s->tag), "%.*s", (int)sizeof(s->tag) - 1, tag);
+    s->decimals = decimals;
+    s->ms = malloc(MAX_SAMPLES * sizeof(*s->ms));
+    s->values = malloc(MAX_SAMPLES * sizeof(*s->values));
+    return s;
+}
+
+static void load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[128];
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        char tag[16], text[32];
+        unsigned long ms;
+        if (sscanf(line, "%lu,%15[^,],%31s", &ms, tag, text) != 3)
+        {
+            continue;
+        }
+        const char *dot = strchr(text, '.');
+        int decimals = dot ? (int)strlen(dot + 1) : 0;
+        double scale = decimals == 2 ? 100 : decimals == 1 ? 10 : 1;
+        series_t *s = series_for(tag, decimals);
+        if (!s || s->count == MAX_SAMPLES)
+        {
+            continue;
+        }
+        s->ms[s->count] = (uint32_t)ms;
+        s->values[s->count] = (int32_t)(atof(text) * scale + (text[0] == '-' ? -0.5 : 0.5));
+        s->text_bytes += strlen(tag) + 1 + strlen(text);
+        s->count++;
+    }
+    fclose(f);
+}
+
+// Encode a series as the device would. Returns the bytes on the wire: one
+// "Z:<tag>:<base64>\n" line per block.
+static size_t encode(const series_t *s, size_t block_bytes, uint32_t flush_ms, size_t *raw_bytes)
+{
+    uint8_t buf[1024];
+    gorilla_block_t b;
+    size_t wire = 0, raw = 0;
+    uint32_t opened = 0;
+    int open = 0;
+
+    for (size_t i = 0; i < s->count; i++)
+    {
+        if (open && !gorilla_append(&b, s->ms[i], s->values[i]))
+        {
+            size_t n = gorilla_finish(&b);
+            raw += n;
+            wire += 4 + strlen(s->tag) + (n + 2) / 3 * 4;
+            open = 0;
+        }
+        if (!open)
+        {
+            gorilla_begin(&b, buf, block_bytes, s->decimals, s->ms[i], s->values[i]);
+            opened = s->ms[i];
+            open = 1;
+        }
+        if (s->ms[i] - opened >= flush_ms)
+        {
+            size_t n = gorilla_finish(&b);
+            raw += n;
+            wire += 4 + strlen(s->tag) + (n + 2) / 3 * 4;
+            open = 0;
+        }
+    }
+    if (open)
+    {
+        size_t n = gorilla_finish(&b);
+        raw += n;
+        wire += 4 + strlen(s->tag) + (n + 2) / 3 * 4;
+    }
+    *raw_bytes = raw;
+    return wire;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    size_t block_bytes = 48;
+    uint32_t flush_ms = 30000;
+    int opt = 1;
+
+    for (; opt < argc && argv[opt][0] == '-'; opt += 2)
+    {
+        if (opt + 1 >= argc)
+        {
+            break;
+        }
+        if (strcmp(argv[opt], "-b") == 0)
+        {
+            block_bytes = strtoul(argv[opt + 1], NULL, 10);
+        }
+        else if (strcmp(argv[opt], "-f") == 0)
+        {
+            flush_ms = strtoul(argv[opt + 1], NULL, 10);
+        }
+    }
+    if (opt >= argc || block_bytes < GORILLA_HEADER_BYTES + 1 || block_bytes > 1024)
+    {
+        fprintf(stderr, "usage: %s [-b block_bytes] [-f flush_ms] trace.csv...\n", argv[0]);
+        return 2;
+    }
+    for (; opt < argc; opt++)
+    {
+        load(argv[opt]);
+    }
+
+    printf("%-6s %9s %10s %10s %10s %7s %8s %9s\n", "tag", "samples", "text", "blocks", "wire", "ratio",
+           "bits/smp", "ns/sample");
+    size_t total_samples = 0, total_text = 0, total_raw = 0, total_wire = 0;
+    double total_ns = 0;
+    for (int i = 0; i < s_series_count; i++)
+    {
+        const series_t *s = &s_series[i];
+        size_t raw, wire = 0;
+        double start = now_ns();
+        for (int r = 0; r < REPEAT; r++)
+        {
+            wire = encode(s, block_bytes, flush_ms, &raw);
+        }
+        double ns = (now_ns() - start) / REPEAT;
+
+        printf("%-6s %9zu %10zu %10zu %10zu %7.1f %8.2f %9.1f\n", s->tag, s->count, s->text_bytes, raw, wire,
+               (double)s->text_bytes / wire, 8.0 * raw / s->count, ns / s->count);
+        total_samples += s->count;
+        total_text += s->text_bytes;
+        total_raw += raw;
+        total_wire += wire;
+        total_ns += ns;
+    }
+    if (total_samples)
+    {
+        printf("%-6s %9zu %10zu %10zu %10zu %7.1f %8.2f %9.1f\n", "all", total_samples, total_text, total_raw,
+               total_wire, (double)total_text / total_wire, 8.0 * total_raw / total_samples,
+               total_ns / total_samples);
+    }
+    return 0;
+}
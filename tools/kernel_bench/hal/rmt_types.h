@@ -0,0 +1,17 @@
+// rmt_symbol_word_t as in the IDF's hal/rmt_types.h, for
+// onewire_rmt_decode.h on the host
+#pragma once
+
+#include <stdint.h>
+
+typedef union
+{
+    struct
+    {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
@@ -0,0 +1,455 @@
+/*
+ * Time per call of the firmware's hot kernels on the host.
+ *
+ *   kernel_bench [-o baseline.json] [-b baseline.json] [kernel...]
+ *
+ * Each kernel runs RUNS times, each run long enough to take at least
+ * RUN_NS; the median, minimum and interquartile spread of the runs are
+ * printed in ns per call, with the bytes each call consumes. -o saves the
+ * results as JSON and -b prints the change of each median against a saved
+ * baseline, so a kernel change can be compared on the same machine. Host
+ * numbers rank variants; they are not ESP32 cycle counts.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "anomaly.h"
+#include "gorilla.h"
+#include "hydro_channels.h"
+#include "hydro_io.h"
+#include "onewire_crc.h"
+#include "onewire_rmt_decode.h"
+#include "ph_control.h"
+#include "ph_settle.h"
+#include "report_policy.h"
+#include "rule_vm.h"
+
+#define RUNS 21
+#define RUN_NS 5e6
+#define MAX_KERNELS 32
+
+// Inputs shared by the kernels, filled by setup()
+#define SCRATCHPAD_BYTES 9
+#define SERIES_LEN 4096
+
+// A DS18B20 scratchpad at 85 C, its power-on value; the CRC is set by setup()
+static uint8_t s_scratchpad[SCRATCHPAD_BYTES] = {0x50, 0x05, 0x4b, 0x46, 0x7f, 0xff, 0x0c, 0x10};
+static uint8_t s_block[64];
+static rmt_symbol_word_t s_symbols[SCRATCHPAD_BYTES * 8];
+static int s_counts[SERIES_LEN];
+static float s_ph[SERIES_LEN];
+static uint32_t s_ms[SERIES_LEN];
+static int32_t s_fixed[SERIES_LEN];
+static float s_values[HYDRO_CHANNEL_COUNT];
+static rule_program_t s_rule;
+
+static void setup(void)
+{
+    s_scratchpad[8] = onewire_crc8(0, s_scratchpad, 8);
+    // A read slot is held low for about 30 us by a 0 and released after the
+    // master's start pulse for a 1
+    for (int i = 0; i < SCRATCHPAD_BYTES * 8; i++)
+    {
+        int bit = s_scratchpad[i / 8] >> (i % 8) & 1;
+        s_symbols[i].duration0 = bit ? 6 : 30;
+        s_symbols[i].level0 = 0;
+        s_symbols[i].duration1 = bit ? 60 : 36;
+        s_symbols[i].level1 = 1;
+    }
+    // A pH probe around 6.0 with a few counts of noise
+    uint32_t seed = 1;
+    uint32_t ms = 0;
+    for (int i = 0; i < SERIES_LEN; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        s_block[i % sizeof(s_block)] = seed >> 24;
+        s_counts[i] = 1950 + (int)(seed >> 16) % 7 - 3;
+        s_ph[i] = HYDRO_PH_SLOPE * s_counts[i] + HYDRO_PH_OFFSET;
+        s_fixed[i] = hydro_channel_fixed(HYDRO_CH_T0_PH, s_ph[i]);
+        ms += 2200 + (int)(seed >> 20) % 5 - 2;
+        s_ms[i] = ms;
+    }
+    // A pH alarm of the size users write, with every kind of operator
+    const char *error = rule_compile("(T0_PH < 5.5 or T0_PH > 6.5) and not T0_WATER_LEVEL == 0 and T0_TEMP <= 28 "
+                                     "for 60 then off T0_PH_UP, off T0_PH_DOWN",
+                                     &s_rule);
+    if (error)
+    {
+        fprintf(stderr, "rule does not compile at \"%s\"\n", error);
+        exit(1);
+    }
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        s_values[ch] = 1;
+    }
+}
+
+/*
+ * Kernels. Each runs n calls and returns a value depending on all of them,
+ * so none can be optimised away.
+ */
+// A CRC-8 variant over a scratchpad, and over a 64-byte buffer where
+// slicing has whole blocks to work on
+#define CRC8_BENCH(variant)                                           \
+    static uint32_t bench_crc8_##variant(uint32_t n)                  \
+    {                                                                 \
+        uint32_t acc = 0;                                             \
+        for (uint32_t i = 0; i < n; i++)                              \
+        {                                                             \
+            s_scratchpad[0] = i;                                      \
+            acc += onewire_crc8_##variant(0, s_scratchpad, 8);        \
+        }                                                             \
+        return acc;                                                   \
+    }                                                                 \
+    static uint32_t bench_crc8_##variant##_64(uint32_t n)             \
+    {                                                                 \
+        uint32_t acc = 0;                                             \
+        for (uint32_t i = 0; i < n; i++)                              \
+        {                                                             \
+            s_block[0] = i;                                           \
+            acc += onewire_crc8_##variant(0, s_block, sizeof(s_block)); \
+        }                                                             \
+        return acc;                                                   \
+    }
+
+CRC8_BENCH(bitwise)
+CRC8_BENCH(table)
+CRC8_BENCH(nibble)
+CRC8_BENCH(slice4)
+CRC8_BENCH(slice8)
+
+// One byte at a time, as a decoder feeding the CRC would
+static uint32_t bench_crc8_update(uint32_t n)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        s_scratchpad[0] = i;
+        uint8_t crc = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            crc = onewire_crc8_update(crc, s_scratchpad[k]);
+        }
+        acc += crc;
+    }
+    return acc;
+}
+
+// Decode of a scratchpad read with its CRC check, as the RMT receive
+// callback does it for ds18b20_get_temperature()
+static uint32_t bench_rmt_decode_crc(uint32_t n)
+{
+    uint8_t buf[SCRATCHPAD_BYTES];
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        s_symbols[i & 7].duration0 = i & 1 ? 6 : 30;
+        acc += onewire_rmt_decode_bytes(s_symbols, SCRATCHPAD_BYTES * 8, buf, sizeof(buf), 0) == 0;
+    }
+    return acc;
+}
+
+// get_ph_value: counts to pH
+static uint32_t bench_ph_convert(uint32_t n)
+{
+    float acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        acc += HYDRO_PH_SLOPE * s_counts[i % SERIES_LEN] + HYDRO_PH_OFFSET;
+    }
+    return (uint32_t)acc;
+}
+
+// get_ph_value and send_reading: "%.2f", then "<tag>:<text>"
+static uint32_t bench_format_reading(uint32_t n)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        char buffer[20];
+        char result[50];
+        snprintf(buffer, sizeof(buffer), "%.2f", s_ph[i % SERIES_LEN]);
+        acc += snprintf(result, sizeof(result), "%s:%s", hydro_channel_tag(HYDRO_CH_T0_PH), buffer);
+    }
+    return acc;
+}
+
+static uint32_t bench_report_due(uint32_t n)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        acc += report_due(HYDRO_CH_T0_PH, s_ph[i % SERIES_LEN], (int64_t)i * 2200000);
+    }
+    return acc;
+}
+
+static uint32_t bench_gorilla_append(uint32_t n)
+{
+    uint8_t buf[48];
+    gorilla_block_t b;
+    uint32_t acc = 0;
+    gorilla_begin(&b, buf, sizeof(buf), 2, s_ms[0], s_fixed[0]);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int k = i % SERIES_LEN;
+        if (!gorilla_append(&b, s_ms[k], s_fixed[k]))
+        {
+            acc += gorilla_finish(&b);
+            gorilla_begin(&b, buf, sizeof(buf), 2, s_ms[k], s_fixed[k]);
+        }
+    }
+    return acc + gorilla_finish(&b);
+}
+
+static uint32_t bench_ph_control(uint32_t n)
+{
+    ph_control_t c = {0};
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        acc += ph_control_step(&c, true, s_ph[i % SERIES_LEN], 6.0f, 0.2f);
+    }
+    return acc;
+}
+
+// get_ph_value after a dose: the readings of s_ph 2.2 s apart, starting
+// over every 100 so the fit never settles
+static uint32_t bench_ph_settle(uint32_t n)
+{
+    ph_settle_t s;
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (i % 100 == 0)
+        {
+            ph_settle_start(&s, 0);
+        }
+        acc += ph_settle_add(&s, (i % 100 + 1) * 2200, s_ph[i % SERIES_LEN], 0.1f);
+    }
+    return acc;
+}
+
+// What the rule task runs for a rule when a channel it reads changes
+static uint32_t bench_rule_eval(uint32_t n)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        s_values[HYDRO_CH_T0_PH] = s_ph[i % SERIES_LEN];
+        acc += rule_eval(&s_rule, s_values);
+    }
+    return acc;
+}
+
+// get_ph_value's fault check of each reading, on the noisy probe of s_ph
+static uint32_t bench_anomaly_check(uint32_t n)
+{
+    uint32_t acc = 0;
+    int64_t base_us = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int k = i % SERIES_LEN;
+        if (k == 0 && i > 0)
+        {
+            base_us += s_ms[SERIES_LEN - 1] * 1000LL;
+        }
+        acc += anomaly_check(HYDRO_CH_T0_PH, s_ph[k], base_us + s_ms[k] * 1000LL);
+    }
+    return acc;
+}
+
+// X(name, function, bytes consumed per call)
+#define KERNEL_TABLE(X)                                               \
+    X(crc8_bitwise, bench_crc8_bitwise, 8)                            \
+    X(crc8_table, bench_crc8_table, 8)                                \
+    X(crc8_nibble, bench_crc8_nibble, 8)                              \
+    X(crc8_slice4, bench_crc8_slice4, 8)                              \
+    X(crc8_slice8, bench_crc8_slice8, 8)                              \
+    X(crc8_update, bench_crc8_update, 8)                              \
+    X(crc8_bitwise_64, bench_crc8_bitwise_64, 64)                     \
+    X(crc8_table_64, bench_crc8_table_64, 64)                         \
+    X(crc8_nibble_64, bench_crc8_nibble_64, 64)                       \
+    X(crc8_slice4_64, bench_crc8_slice4_64, 64)                       \
+    X(crc8_slice8_64, bench_crc8_slice8_64, 64)                       \
+    X(rmt_decode_crc, bench_rmt_decode_crc, SCRATCHPAD_BYTES * 8 * 4) \
+    X(ph_convert, bench_ph_convert, 2)                                \
+    X(format_reading, bench_format_reading, 4)                        \
+    X(report_due, bench_report_due, 4)                                \
+    X(gorilla_append, bench_gorilla_append, 8)                        \
+    X(ph_control, bench_ph_control, 4)                                \
+    X(ph_settle, bench_ph_settle, 4)                                  \
+    X(rule_eval, bench_rule_eval, 4)                                  \
+    X(anomaly_check, bench_anomaly_check, 4)
+
+typedef struct
+{
+    const char *name;
+    uint32_t (*fn)(uint32_t n);
+    int bytes;
+} kernel_t;
+
+static const kernel_t s_kernels[] = {
+#define KERNEL_ROW(name, fn, bytes) {#name, fn, bytes},
+    KERNEL_TABLE(KERNEL_ROW)
+#undef KERNEL_ROW
+};
+
+#define KERNEL_COUNT (sizeof(s_kernels) / sizeof(s_kernels[0]))
+
+typedef struct
+{
+    double median;
+    double min;
+    double spread; // interquartile range over the median, in percent
+} result_t;
+
+static volatile uint32_t s_sink;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static result_t measure(const kernel_t *k)
+{
+    // Grow the call count until one run takes RUN_NS, which also warms up
+    uint32_t n = 16;
+    for (;;)
+    {
+        double start = now_ns();
+        s_sink += k->fn(n);
+        if (now_ns() - start >= RUN_NS || n >= (1u << 30))
+        {
+            break;
+        }
+        n *= 2;
+    }
+    double runs[RUNS];
+    for (int r = 0; r < RUNS; r++)
+    {
+        double start = now_ns();
+        s_sink += k->fn(n);
+        runs[r] = (now_ns() - start) / n;
+    }
+    qsort(runs, RUNS, sizeof(runs[0]), compare_double);
+    result_t res = {runs[RUNS / 2], runs[0], 0};
+    res.spread = 100.0 * (runs[RUNS * 3 / 4] - runs[RUNS / 4]) / res.median;
+    return res;
+}
+
+// Median of a kernel in a baseline written by -o, or 0
+static double baseline_median(const char *path, const char *name)
+{
+    FILE *f = fopen(path, "r");
+    char line[160];
+    double median = 0;
+    if (!f)
+    {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        char key[40];
+        double value;
+        if (sscanf(line, " \"%39[^\"]\": {\"ns_op\": %lf", key, &value) == 2 && strcmp(key, name) == 0)
+        {
+            median = value;
+            break;
+        }
+    }
+    fclose(f);
+    return median;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = NULL;
+    const char *baseline = NULL;
+    int opt = 1;
+
+    for (; opt + 1 < argc && argv[opt][0] == '-'; opt += 2)
+    {
+        if (strcmp(argv[opt], "-o") == 0)
+        {
+            out = argv[opt + 1];
+        }
+        else if (strcmp(argv[opt], "-b") == 0)
+        {
+            baseline = argv[opt + 1];
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (opt < argc && argv[opt][0] == '-')
+    {
+        fprintf(stderr, "usage: %s [-o baseline.json] [-b baseline.json] [kernel...]\n", argv[0]);
+        return 2;
+    }
+    setup();
+
+    result_t results[MAX_KERNELS];
+    bool ran[MAX_KERNELS] = {false};
+    printf("%-16s %10s %10s %8s %9s %10s%s\n", "kernel", "ns/op", "min", "spread", "bytes/op", "MB/s",
+           baseline ? "   vs base" : "");
+    for (size_t i = 0; i < KERNEL_COUNT; i++)
+    {
+        const kernel_t *k = &s_kernels[i];
+        bool wanted = opt == argc;
+        for (int a = opt; a < argc; a++)
+        {
+            wanted |= strcmp(argv[a], k->name) == 0;
+        }
+        if (!wanted)
+        {
+            continue;
+        }
+        results[i] = measure(k);
+        ran[i] = true;
+        printf("%-16s %10.2f %10.2f %7.1f%% %9d %10.1f", k->name, results[i].median, results[i].min,
+               results[i].spread, k->bytes, k->bytes / results[i].median * 1e3);
+        double base = baseline ? baseline_median(baseline, k->name) : 0;
+        if (base > 0)
+        {
+            printf(" %+9.1f%%", 100.0 * (results[i].median - base) / base);
+        }
+        printf("\n");
+    }
+
+    if (out)
+    {
+        FILE *f = fopen(out, "w");
+        if (!f)
+        {
+            perror(out);
+            return 1;
+        }
+        fprintf(f, "{\n");
+        const char *sep = "";
+        for (size_t i = 0; i < KERNEL_COUNT; i++)
+        {
+            if (!ran[i])
+            {
+                continue;
+            }
+            fprintf(f, "%s  \"%s\": {\"ns_op\": %.3f, \"min\": %.3f, \"spread_pct\": %.2f, \"bytes_op\": %d}", sep,
+                    s_kernels[i].name, results[i].median, results[i].min, results[i].spread, s_kernels[i].bytes);
+            sep = ",\n";
+        }
+        fprintf(f, "\n}\n");
+        fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * Replays raw inputs captured from the device (main/capture.h, saved by the
+ * bridge with CAPTURE=capture.csv) through the firmware's pH calibration,
+ * sensor checks, report filter and pH controller, and prints per tank what
+ * the controller would have done next to what the device did. Readings the
+ * checks drop reach neither the filter nor the controller, as on the device.
+ *
+ *   replay [-p key=value]... capture.csv...
+ *
+ * Lines are "<ms>,<channel>,<raw>" in time order, a "W:" prefix allowed.
+ * Time going backwards is taken as a reboot, which starts the sensor checks
+ * over, and continues from the line before. -p sets a firmware parameter by its params.h key, to compare
+ * settings on the same trace. The replay is deterministic: the same trace
+ * and parameters always give the same result.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "anomaly.h"
+#include "hydro_channels.h"
+#include "hydro_io.h"
+#include "ph_loop.h"
+#include "report_policy.h"
+
+typedef struct
+{
+    ph_loop_t loop;
+    ph_band_stats_t band;
+    bool started;
+    int device_doses[PH_LOOP_PUMP_COUNT];
+} tank_t;
+
+static float s_params[PARAM_COUNT];
+static tank_t s_tanks[HYDRO_TANK_COUNT];
+static int32_t s_level[HYDRO_CHANNEL_COUNT];
+static unsigned long s_readings[HYDRO_CHANNEL_COUNT];
+static unsigned long s_dropped[HYDRO_CHANNEL_COUNT];
+static int64_t s_first_ms = -1, s_last_ms;
+
+static int find_channel(const char *name, size_t len)
+{
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (strlen(hydro_channels[ch].name) == len && strncmp(name, hydro_channels[ch].name, len) == 0)
+        {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+// Value as the task of the channel computes it from the raw input
+static float value_of(int ch, int32_t raw)
+{
+    switch (hydro_channels[ch].role)
+    {
+    case HYDRO_ROLE_TEMPERATURE:
+        return raw / 16.0f;
+    case HYDRO_ROLE_PH:
+        return HYDRO_PH_SLOPE * raw + HYDRO_PH_OFFSET;
+    default:
+        return raw;
+    }
+}
+
+static void input(int64_t ms, int ch, int32_t raw)
+{
+    const hydro_channel_t *c = &hydro_channels[ch];
+    tank_t *t = &s_tanks[c->tank];
+    if (!t->started)
+    {
+        // The recorded readings do not respond to the replayed doses
+        ph_loop_init(&t->loop, s_params, ms, NULL, NULL);
+        ph_band_init(&t->band);
+        t->started = true;
+    }
+    ph_loop_run(&t->loop, ms);
+    s_readings[ch]++;
+
+    if (!HYDRO_ROLE_IS_SENSOR(c->role))
+    {
+        if (raw && !s_level[ch])
+        {
+            t->device_doses[PH_LOOP_UP] += c->role == HYDRO_ROLE_PH_UP;
+            t->device_doses[PH_LOOP_DOWN] += c->role == HYDRO_ROLE_PH_DOWN;
+        }
+        s_level[ch] = raw;
+        return;
+    }
+    float value = value_of(ch, raw);
+    if (!ph_loop_sound(ch, value, ms))
+    {
+        s_dropped[ch]++;
+        return;
+    }
+    report_due(ch, value, ms * 1000);
+    if (c->role == HYDRO_ROLE_PH)
+    {
+        ph_loop_reading(&t->loop, ms, value);
+        ph_band_add(&t->band, ms, value, t->loop.target, t->loop.band);
+    }
+}
+
+static void load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[96];
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    int64_t base = 0, prev = -1;
+    while (fgets(line, sizeof(line), f))
+    {
+        char *p = line[0] == 'W' && line[1] == ':' ? line + 2 : line;
+        char *end;
+        int64_t ms = strtoll(p, &end, 10);
+        if (end == p || *end != ',')
+        {
+            continue;
+        }
+        char *name = end + 1;
+        char *comma = strchr(name, ',');
+        if (comma == NULL)
+        {
+            continue;
+        }
+        int ch = find_channel(name, comma - name);
+        if (ch < 0)
+        {
+            continue;
+        }
+        int32_t raw = strtol(comma + 1, NULL, 10);
+
+        if (ms < prev)
+        {
+            base = s_last_ms;
+            for (int c = 0; c < HYDRO_CHANNEL_COUNT; c++)
+            {
+                anomaly_reset(c);
+            }
+        }
+        prev = ms;
+        s_last_ms = base + ms;
+        if (s_first_ms < 0)
+        {
+            s_first_ms = s_last_ms;
+        }
+        input(s_last_ms, ch, raw);
+    }
+    fclose(f);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    int opt = 1;
+    int ok = 1;
+
+    ph_loop_defaults(s_params);
+    for (; ok && opt + 1 < argc && strcmp(argv[opt], "-p") == 0; opt += 2)
+    {
+        ok = ph_loop_param_set(s_params, argv[opt + 1]);
+    }
+    if (!ok || opt >= argc)
+    {
+        fprintf(stderr, "usage: %s [-p key=value]... capture.csv...\n", argv[0]);
+        return 2;
+    }
+    double start = now_ns();
+    for (; opt < argc; opt++)
+    {
+        load(argv[opt]);
+    }
+
+    printf("%-4s %8s %8s %7s %8s %7s %9s %7s %7s %9s %9s\n", "tank", "hours", "ph_reads", "ph_drop", "settle_h",
+           "in_band", "overshoot", "up", "down", "device_up", "device_dn");
+    for (int tank = 0; tank < HYDRO_TANK_COUNT; tank++)
+    {
+        tank_t *t = &s_tanks[tank];
+        int ph = hydro_channel_find(tank, HYDRO_ROLE_PH);
+        if (!t->started || s_readings[ph] == 0)
+        {
+            continue;
+        }
+        ph_loop_run(&t->loop, s_last_ms);
+        const ph_band_stats_t *b = &t->band;
+        printf("%-4d %8.2f %8lu %7lu", tank, (s_last_ms - s_first_ms) / 3600e3, s_readings[ph], s_dropped[ph]);
+        if (b->settle_ms < 0)
+        {
+            printf(" %8s %7s %9s", "never", "-", "-");
+        }
+        else
+        {
+            printf(" %8.2f %6.1f%% %9.2f", (b->settle_ms - b->start_ms) / 3600e3,
+                   b->span_ms ? 100.0 * b->in_band_ms / b->span_ms : 100.0, b->overshoot);
+        }
+        printf(" %7d %7d %9d %9d\n", t->loop.pumps[PH_LOOP_UP].doses, t->loop.pumps[PH_LOOP_DOWN].doses,
+               t->device_doses[PH_LOOP_UP], t->device_doses[PH_LOOP_DOWN]);
+    }
+
+    // What the report filter would have sent
+    char line[64];
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        if (report_format(ch, line, sizeof(line)) > 0)
+        {
+            printf("%s", line);
+        }
+    }
+    unsigned long total = 0;
+    unsigned long dropped = 0;
+    for (int ch = 0; ch < HYDRO_CHANNEL_COUNT; ch++)
+    {
+        total += s_readings[ch];
+        dropped += s_dropped[ch];
+    }
+    double wall_s = (now_ns() - start) / 1e9;
+    printf("%lu inputs, %lu dropped by the sensor checks, in %.2f s, %.0fx real time\n", total, dropped, wall_s,
+           (s_last_ms - s_first_ms) / 1e3 / wall_s);
+    return 0;
+}
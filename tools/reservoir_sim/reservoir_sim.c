@@ -0,0 +1,195 @@
+/*
+ * Runs the pH controller of main/ph_control.c against the reservoir model
+ * of main/reservoir.c, far faster than real time, and compares scenarios by
+ * settling time and reagent use.
+ *
+ *   reservoir_sim [-d days] [-p key=value]... [-r field=value]... [scenario...]
+ *
+ * -p sets a firmware parameter by its params.h key (ph_target, ph_band,
+ * ph_check_ms, ph_sample_ms, dose_ms), -r a reservoir.h model field for
+ * every scenario. get_ph_value reads the probe through the 12-bit ADC every
+ * ph_sample_ms and drops the readings the sensor checks reject; auto_PH and
+ * the dispense tasks are tools/common/ph_loop.c.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "anomaly.h"
+#include "hydro_channels.h"
+#include "hydro_io.h"
+#include "ph_loop.h"
+#include "reservoir.h"
+
+// X(name, start_ph, field, value): starting pH and one model field that
+// differs from reservoir_defaults
+#define SCENARIO_TABLE(X)                        \
+    X("high", 7.2, volume_l, 40.0)               \
+    X("low", 5.0, volume_l, 40.0)                \
+    X("small", 7.2, volume_l, 10.0)              \
+    X("soft", 7.2, buffer_mmol_l, 0.5)           \
+    X("hard", 7.2, buffer_mmol_l, 8.0)           \
+    X("slowmix", 7.2, mix_s, 600.0)              \
+    X("acidic", 6.0, drift_ph, 5.0)
+
+typedef struct
+{
+    const char *name;
+    double start_ph;
+    const char *field;
+    double value;
+} scenario_t;
+
+static const scenario_t s_scenarios[] = {
+#define SCENARIO_ROW(name, start_ph, field, value) {name, start_ph, #field, value},
+    SCENARIO_TABLE(SCENARIO_ROW)
+#undef SCENARIO_ROW
+};
+
+static float s_params[PARAM_COUNT];
+
+static void set_pump(void *ctx, ph_loop_pump_t pump, bool on, int64_t now_ms)
+{
+    reservoir_t *r = ctx;
+    reservoir_run(r, now_ms / 1000.0);
+    reservoir_set_pump(r, pump == PH_LOOP_UP ? RESERVOIR_PUMP_UP : RESERVOIR_PUMP_DOWN, on);
+}
+
+// Probe reading as get_ph_value calibrates it
+static float read_ph(const reservoir_t *r)
+{
+    double counts = round((r->ph - HYDRO_PH_OFFSET) / HYDRO_PH_SLOPE);
+    counts = counts < 0 ? 0 : counts > 4095 ? 4095 : counts;
+    return HYDRO_PH_SLOPE * (float)counts + HYDRO_PH_OFFSET;
+}
+
+// Returns the number of readings the sensor checks dropped
+static int run(reservoir_t *r, int64_t end_ms, ph_loop_t *l, ph_band_stats_t *stats)
+{
+    int dropped = 0;
+    ph_loop_init(l, s_params, 0, set_pump, r);
+    ph_band_init(stats);
+    anomaly_reset(HYDRO_CH_T0_PH);
+    for (int64_t now = 0; now < end_ms; now += (int64_t)s_params[PARAM_PH_SAMPLE_MS])
+    {
+        ph_loop_run(l, now);
+        reservoir_run(r, now / 1000.0);
+        float ph = read_ph(r);
+        if (ph_loop_sound(HYDRO_CH_T0_PH, ph, now))
+        {
+            ph_loop_reading(l, now, ph);
+        }
+        else
+        {
+            dropped++;
+        }
+        ph_band_add(stats, now, r->ph, l->target, l->band);
+    }
+    ph_loop_run(l, end_ms);
+    reservoir_run(r, end_ms / 1000.0);
+    return dropped;
+}
+
+static int set_model(reservoir_params_t *p, const char *arg)
+{
+    char name[32];
+    const char *eq = strchr(arg, '=');
+    if (eq == NULL || eq - arg >= (int)sizeof(name))
+    {
+        return 0;
+    }
+    memcpy(name, arg, eq - arg);
+    name[eq - arg] = 0;
+    return reservoir_param_set(p, name, atof(eq + 1));
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    double days = 7;
+    reservoir_params_t model = reservoir_defaults;
+    int opt = 1;
+    int ok = 1;
+
+    ph_loop_defaults(s_params);
+    for (; ok && opt < argc && argv[opt][0] == '-'; opt += 2)
+    {
+        if (opt + 1 >= argc)
+        {
+            ok = 0;
+        }
+        else if (strcmp(argv[opt], "-d") == 0)
+        {
+            days = atof(argv[opt + 1]);
+        }
+        else if (strcmp(argv[opt], "-p") == 0)
+        {
+            ok = ph_loop_param_set(s_params, argv[opt + 1]);
+        }
+        else if (strcmp(argv[opt], "-r") == 0)
+        {
+            ok = set_model(&model, argv[opt + 1]);
+        }
+        else
+        {
+            ok = 0;
+        }
+    }
+    if (!ok || days <= 0)
+    {
+        fprintf(stderr, "usage: %s [-d days] [-p key=value]... [-r field=value]... [scenario...]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-8s %5s %8s %7s %9s %6s %8s %8s %7s %7s\n", "scenario", "start", "settle_h", "in_band", "overshoot",
+           "doses", "up_ml", "down_ml", "vol_l", "dropped");
+    int64_t end_ms = (int64_t)(days * 86400e3);
+    double simulated_s = 0;
+    double start = now_ns();
+    for (size_t i = 0; i < sizeof(s_scenarios) / sizeof(s_scenarios[0]); i++)
+    {
+        const scenario_t *sc = &s_scenarios[i];
+        int wanted = opt == argc;
+        for (int a = opt; a < argc; a++)
+        {
+            wanted |= strcmp(argv[a], sc->name) == 0;
+        }
+        if (!wanted)
+        {
+            continue;
+        }
+
+        reservoir_params_t p = model;
+        reservoir_param_set(&p, sc->field, sc->value);
+        reservoir_t r;
+        reservoir_init(&r, &p, sc->start_ph);
+        ph_loop_t l;
+        ph_band_stats_t stats;
+        int dropped = run(&r, end_ms, &l, &stats);
+        simulated_s += end_ms / 1000.0;
+
+        if (stats.settle_ms < 0)
+        {
+            printf("%-8s %5.2f %8s %7s %9s", sc->name, sc->start_ph, "never", "-", "-");
+        }
+        else
+        {
+            printf("%-8s %5.2f %8.2f %6.1f%% %9.2f", sc->name, sc->start_ph, stats.settle_ms / 3600e3,
+                   stats.span_ms ? 100.0 * stats.in_band_ms / stats.span_ms : 100.0, stats.overshoot);
+        }
+        printf(" %6d %8.1f %8.1f %7.2f %7d\n", l.pumps[PH_LOOP_UP].doses + l.pumps[PH_LOOP_DOWN].doses,
+               r.pumped_ml[RESERVOIR_PUMP_UP], r.pumped_ml[RESERVOIR_PUMP_DOWN], r.volume_l, dropped);
+    }
+    double wall_s = (now_ns() - start) / 1e9;
+    printf("%.0f simulated hours in %.2f s, %.0fx real time\n", simulated_s / 3600.0, wall_s,
+           simulated_s / wall_s);
+    return 0;
+}